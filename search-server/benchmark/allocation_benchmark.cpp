@@ -0,0 +1,163 @@
+// Heap allocations per call of the search operations on a synthetic Zipf
+// corpus, counted by replacing the global operator new. Printed as JSON
+// like search_server_benchmark, with the allocations and bytes per call
+// next to the timings.
+//
+// The optional argument scales the number of documents and queries.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <new>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../search_server.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// parallel searches allocate from several threads
+std::atomic<uint64_t> allocation_count{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+void* Allocate(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* AllocateAligned(size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+// Sum that the benchmarks feed their results into, so that nothing is
+// optimized away
+size_t sink = 0;
+
+// Runs function on every query once to warm the buffers of the thread up,
+// then counts the allocations of a second pass
+template <typename Function>
+BenchmarkResult MeasureAllocations(const std::string& name, const std::vector<std::string>& queries,
+                                   Function function) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+        function(i);
+    }
+    const uint64_t count_before = allocation_count.load();
+    const uint64_t bytes_before = allocated_bytes.load();
+    BenchmarkResult result = Measure(name, queries.size(), 1, [&] {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            function(i);
+        }
+    });
+    const double call_count = static_cast<double>(queries.size());
+    result.values.push_back({"allocations_per_call"s, (allocation_count.load() - count_before) / call_count});
+    result.values.push_back({"bytes_per_call"s, (allocated_bytes.load() - bytes_before) / call_count});
+    return result;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    if (!ScaleCorpusOptions(argc, argv, options)) {
+        std::cerr << "usage: "s << argv[0] << " [scale]"s << std::endl;
+        return 1;
+    }
+    CorpusGenerator generator(options);
+    const std::vector<std::string> texts = generator.MakeDocumentTexts();
+    const std::vector<DocumentInput> documents = generator.MakeDocuments(texts);
+    const std::vector<std::string> queries = generator.MakeQueries();
+    SearchServer search_server(generator.GetStopWords());
+    search_server.AddDocuments(documents);
+
+    std::vector<BenchmarkResult> results;
+    results.push_back(MeasureAllocations("FindTopDocuments.seq.status"s, queries, [&](size_t i) {
+        sink += search_server.FindTopDocuments(std::execution::seq, queries[i], DocumentStatus::ACTUAL).size();
+    }));
+    results.push_back(MeasureAllocations("FindTopDocuments.seq.lambda"s, queries, [&](size_t i) {
+        sink += search_server.FindTopDocuments(std::execution::seq, queries[i], [](int, DocumentStatus, int rating) {
+            return rating > 0;
+        }).size();
+    }));
+    results.push_back(MeasureAllocations("FindTopDocuments.par.status"s, queries, [&](size_t i) {
+        sink += search_server.FindTopDocuments(std::execution::par, queries[i], DocumentStatus::ACTUAL).size();
+    }));
+    results.push_back(MeasureAllocations("MatchDocument"s, queries, [&](size_t i) {
+        sink += std::get<0>(search_server.MatchDocument(queries[i], documents[i % documents.size()].id)).size();
+    }));
+    // the warm-up pass fills the cache, the counted one only has hits
+    search_server.SetResultCacheLimit(size_t{64} << 20);
+    results.push_back(MeasureAllocations("FindTopDocuments.cached"s, queries, [&](size_t i) {
+        sink += search_server.FindTopDocuments(queries[i]).size();
+    }));
+
+    std::cout << ToJson(options, results) << std::endl;
+    if (sink == 0) {
+        std::cerr << "no results"s << std::endl;
+    }
+}
@@ -0,0 +1,39 @@
+#include "benchmark_report.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+bool ScaleCorpusOptions(int argc, char* argv[], CorpusOptions& options) {
+    if (argc <= 1) {
+        return true;
+    }
+    const double scale = std::atof(argv[1]);
+    if (scale <= 0.0) {
+        return false;
+    }
+    options.document_count = std::max<size_t>(1, static_cast<size_t>(options.document_count * scale));
+    options.query_count = std::max<size_t>(1, static_cast<size_t>(options.query_count * scale));
+    return true;
+}
+
+std::string ToJson(const CorpusOptions& options, const std::vector<BenchmarkResult>& results) {
+    std::ostringstream out;
+    out << "{\n  \"corpus\": {\"seed\": " << options.seed << ", \"vocabulary_size\": " << options.vocabulary_size
+        << ", \"zipf_exponent\": " << options.zipf_exponent << ", \"stop_word_count\": " << options.stop_word_count
+        << ", \"document_count\": " << options.document_count << ", \"query_count\": " << options.query_count
+        << "},\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operation_count
+            << ", \"seconds\": " << result.seconds
+            << ", \"ns_per_operation\": " << result.seconds * 1e9 / std::max<size_t>(result.operation_count, 1);
+        for (const auto& [key, value] : result.values) {
+            out << ", \"" << key << "\": " << value;
+        }
+        out << (i + 1 < results.size() ? "},\n" : "}\n");
+    }
+    out << "  ]\n}";
+    return out.str();
+}
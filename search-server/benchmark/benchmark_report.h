@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "corpus_generator.h"
+
+struct BenchmarkResult {
+    std::string name;
+    size_t operation_count;
+    double seconds;
+    // more figures of the benchmark, printed after the timing
+    std::vector<std::pair<std::string, double>> values = {};
+};
+
+// Read only benchmarks keep the best of the runs
+const int REPEAT_COUNT = 3;
+
+// The best time of repeat_count calls of function
+template <typename Function>
+BenchmarkResult Measure(const std::string& name, size_t operation_count, int repeat_count, Function function) {
+    double best_seconds = 0.0;
+    for (int repeat = 0; repeat < repeat_count; ++repeat) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (repeat == 0 || seconds.count() < best_seconds) {
+            best_seconds = seconds.count();
+        }
+    }
+    return {name, operation_count, best_seconds};
+}
+
+// Scales the document and query counts of options by the first argument,
+// if there is one. Returns false when the argument is not a positive number.
+bool ScaleCorpusOptions(int argc, char* argv[], CorpusOptions& options);
+
+// The corpus, the hardware and every result, one per line
+std::string ToJson(const CorpusOptions& options, const std::vector<BenchmarkResult>& results);
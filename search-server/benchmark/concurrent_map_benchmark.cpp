@@ -0,0 +1,89 @@
+// Contention benchmark of ConcurrentMap: every thread adds to random keys
+// of a shared map. Compares Access, FetchAdd and the previous design of a
+// mutex and a std::map per bucket, for 1 to 64 threads.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_map.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const size_t BUCKET_COUNT = 100;
+const int KEY_COUNT = 10000;
+const int OPERATIONS_PER_THREAD = 200000;
+
+// The map ConcurrentMap replaced
+class MutexMap {
+public:
+    explicit MutexMap(size_t bucket_count)
+        : buckets_(bucket_count) {
+    }
+
+    void Add(int key, int64_t delta) {
+        Bucket& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+        std::lock_guard guard(bucket.mutex);
+        bucket.map[key] += delta;
+    }
+
+private:
+    struct Bucket {
+        std::mutex mutex;
+        std::map<int, int64_t> map;
+    };
+
+    std::vector<Bucket> buckets_;
+};
+
+template <typename Function>
+double MeasureMillionOpsPerSecond(int thread_count, Function add) {
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int thread = 0; thread < thread_count; ++thread) {
+        threads.emplace_back([thread, &add] {
+            std::mt19937 generator(thread);
+            std::uniform_int_distribution<int> keys(0, KEY_COUNT - 1);
+            for (int i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+                add(keys(generator));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    return thread_count * static_cast<double>(OPERATIONS_PER_THREAD) / seconds.count() / 1e6;
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "threads  mutex+map  Access  FetchAdd  (million adds per second)"s << std::endl;
+    for (int thread_count = 1; thread_count <= 64; thread_count *= 2) {
+        MutexMap mutex_map(BUCKET_COUNT);
+        ConcurrentMap<int, int64_t> access_map(BUCKET_COUNT);
+        ConcurrentMap<int, int64_t> fetch_add_map(BUCKET_COUNT);
+        const double mutex_rate = MeasureMillionOpsPerSecond(thread_count, [&](int key) {
+            mutex_map.Add(key, 1);
+        });
+        const double access_rate = MeasureMillionOpsPerSecond(thread_count, [&](int key) {
+            access_map[key].ref_to_value += 1;
+        });
+        const double fetch_add_rate = MeasureMillionOpsPerSecond(thread_count, [&](int key) {
+            fetch_add_map.FetchAdd(key, 1);
+        });
+        std::cout << std::setw(7) << thread_count << std::fixed << std::setprecision(2)
+                  << std::setw(11) << mutex_rate << std::setw(8) << access_rate
+                  << std::setw(10) << fetch_add_rate << std::endl;
+    }
+}
@@ -0,0 +1,133 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace {
+
+// Distinct lowercase word for every rank, at least three letters long
+std::string MakeWord(size_t rank) {
+    std::string word;
+    do {
+        word += static_cast<char>('a' + rank % 26);
+        rank /= 26;
+    } while (rank > 0 || word.size() < 3);
+    return word;
+}
+
+}  // namespace
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+    : options_(options)
+    , generator_(options.seed) {
+    if (options.vocabulary_size <= options.stop_word_count || options.min_document_words == 0
+        || options.min_document_words > options.max_document_words || options.min_query_words == 0
+        || options.min_query_words > options.max_query_words) {
+        throw std::invalid_argument("Invalid corpus options"s);
+    }
+    vocabulary_.reserve(options.vocabulary_size);
+    cumulative_weights_.reserve(options.vocabulary_size);
+    double total_weight = 0.0;
+    for (size_t rank = 0; rank < options.vocabulary_size; ++rank) {
+        vocabulary_.push_back(MakeWord(rank));
+        total_weight += 1.0 / std::pow(static_cast<double>(rank + 1), options.zipf_exponent);
+        cumulative_weights_.push_back(total_weight);
+    }
+    for (double& weight : cumulative_weights_) {
+        weight /= total_weight;
+    }
+}
+
+const CorpusOptions& CorpusGenerator::GetOptions() const {
+    return options_;
+}
+
+const std::vector<std::string>& CorpusGenerator::GetVocabulary() const {
+    return vocabulary_;
+}
+
+std::string CorpusGenerator::GetStopWords() const {
+    std::string stop_words;
+    for (size_t rank = 0; rank < options_.stop_word_count; ++rank) {
+        stop_words += (rank > 0 ? " "s : ""s) + vocabulary_[rank];
+    }
+    return stop_words;
+}
+
+std::vector<std::string> CorpusGenerator::MakeDocumentTexts() {
+    std::vector<std::string> texts;
+    texts.reserve(options_.document_count);
+    std::vector<std::string> words;
+    for (size_t i = 0; i < options_.document_count; ++i) {
+        words.clear();
+        if (i > 0 && DrawReal() < options_.duplicate_share) {
+            // the words of an earlier document, rotated
+            const std::string& original = texts[DrawIndex(i)];
+            const size_t space = original.find(' ');
+            texts.push_back(space == std::string::npos
+                            ? original : original.substr(space + 1) + ' ' + original.substr(0, space));
+            continue;
+        }
+        const size_t word_count = options_.min_document_words
+            + DrawIndex(options_.max_document_words - options_.min_document_words + 1);
+        std::string text;
+        for (size_t j = 0; j < word_count; ++j) {
+            text += (j > 0 ? " "s : ""s) + DrawWord();
+        }
+        texts.push_back(std::move(text));
+    }
+    return texts;
+}
+
+std::vector<DocumentInput> CorpusGenerator::MakeDocuments(const std::vector<std::string>& texts) {
+    std::vector<DocumentInput> documents;
+    documents.reserve(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const size_t status_draw = DrawIndex(100);
+        const DocumentStatus status = status_draw < 85 ? DocumentStatus::ACTUAL
+                                    : status_draw < 93 ? DocumentStatus::IRRELEVANT
+                                    : status_draw < 98 ? DocumentStatus::BANNED
+                                                       : DocumentStatus::REMOVED;
+        std::vector<int> ratings(1 + DrawIndex(4));
+        for (int& rating : ratings) {
+            rating = static_cast<int>(DrawIndex(21)) - 10;
+        }
+        documents.push_back({static_cast<int>(i), texts[i], status, std::move(ratings)});
+    }
+    return documents;
+}
+
+std::vector<std::string> CorpusGenerator::MakeQueries() {
+    std::vector<std::string> queries;
+    queries.reserve(options_.query_count);
+    for (size_t i = 0; i < options_.query_count; ++i) {
+        const size_t word_count = options_.min_query_words
+            + DrawIndex(options_.max_query_words - options_.min_query_words + 1);
+        std::string query;
+        for (size_t j = 0; j < word_count; ++j) {
+            // the first word is always a plus word, so no query is minus words only
+            const bool is_minus = j > 0 && DrawReal() < options_.minus_word_share;
+            query += (j > 0 ? " "s : ""s) + (is_minus ? "-"s : ""s) + DrawWord();
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+size_t CorpusGenerator::DrawIndex(size_t size) {
+    return static_cast<size_t>(generator_() % size);
+}
+
+double CorpusGenerator::DrawReal() {
+    return static_cast<double>(generator_() >> 11) * 0x1.0p-53;
+}
+
+const std::string& CorpusGenerator::DrawWord() {
+    const double draw = DrawReal();
+    const size_t rank = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), draw)
+        - cumulative_weights_.begin();
+    return vocabulary_[std::min(rank, vocabulary_.size() - 1)];
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../document.h"
+
+struct CorpusOptions {
+    uint64_t seed = 1;
+    size_t vocabulary_size = 50000;
+    // word of rank r is drawn with weight 1 / r^zipf_exponent
+    double zipf_exponent = 1.0;
+    // the most frequent words, which the server gets as stop words
+    size_t stop_word_count = 20;
+    size_t document_count = 20000;
+    size_t min_document_words = 10;
+    size_t max_document_words = 120;
+    // documents repeating the words of an earlier one in another order
+    double duplicate_share = 0.05;
+    size_t query_count = 2000;
+    size_t min_query_words = 1;
+    size_t max_query_words = 5;
+    // chance of every query word to be a minus word
+    double minus_word_share = 0.1;
+};
+
+// Vocabulary, documents and queries drawn from a Zipf distribution of
+// word ranks. Equal options give the same corpus on every platform: the
+// draws use std::mt19937_64 directly, not the standard distributions,
+// whose results are up to the library.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusOptions& options);
+
+    const CorpusOptions& GetOptions() const;
+
+    // Words by decreasing frequency
+    const std::vector<std::string>& GetVocabulary() const;
+
+    // The stop_word_count most frequent words separated by spaces
+    std::string GetStopWords() const;
+
+    // Texts of document_count documents, with duplicates among them
+    std::vector<std::string> MakeDocumentTexts();
+
+    // Documents with ids 0, 1, ... for the texts, which have to outlive them.
+    // Most are ACTUAL, ratings are from -10 to 10.
+    std::vector<DocumentInput> MakeDocuments(const std::vector<std::string>& texts);
+
+    // query_count queries with stop words and minus words among their words
+    std::vector<std::string> MakeQueries();
+
+private:
+    CorpusOptions options_;
+    std::mt19937_64 generator_;
+    std::vector<std::string> vocabulary_;
+    // cumulative_weights_[r] is the weight of ranks up to r, the last is 1
+    std::vector<double> cumulative_weights_;
+
+    // Uniform in [0, size)
+    size_t DrawIndex(size_t size);
+
+    // Uniform in [0, 1)
+    double DrawReal();
+
+    const std::string& DrawWord();
+};
@@ -0,0 +1,161 @@
+// Size and decode speed of the compressed posting lists: the postings of
+// every word of a synthetic Zipf corpus are encoded into PostingLists,
+// then walked by cursors with the decoder limited to each kernel the CPU
+// has in turn. Runs of a few lengths are decoded on their own too, to show
+// the kernel picked for each length. Printed as JSON like
+// search_server_benchmark.
+//
+// The optional argument scales the number of documents.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../posting_codec.h"
+#include "../posting_list.h"
+#include "../string_processing.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// values of every run length that MeasureRunDecode decodes
+const size_t RUN_DECODE_VALUE_COUNT = 1 << 20;
+
+// Sum that the benchmarks feed their results into, so that nothing is
+// optimized away
+uint64_t sink = 0;
+
+// Postings of every word, the slot of a document is its index
+std::vector<PostingList> BuildPostingLists(const std::vector<std::string>& texts) {
+    std::unordered_map<std::string_view, size_t> word_lists;
+    std::vector<PostingList> posting_lists;
+    std::map<std::string_view, uint32_t> document_counts;
+    for (size_t slot = 0; slot < texts.size(); ++slot) {
+        document_counts.clear();
+        size_t word_count = 0;
+        ForEachWord(texts[slot], [&](std::string_view word) {
+            ++document_counts[word];
+            ++word_count;
+        });
+        for (const auto& [word, count] : document_counts) {
+            const auto [it, is_new] = word_lists.emplace(word, posting_lists.size());
+            if (is_new) {
+                posting_lists.emplace_back();
+            }
+            posting_lists[it->second].Add(static_cast<int>(slot), count, static_cast<double>(count) / word_count);
+        }
+    }
+    for (PostingList& postings : posting_lists) {
+        postings.Flush();
+    }
+    return posting_lists;
+}
+
+BenchmarkResult MeasureDecode(DecodeKernel kernel, const std::string& name, const std::vector<PostingList>& lists,
+                              size_t posting_count) {
+    SetDecodeKernel(kernel);
+    BenchmarkResult result = Measure(name, posting_count, REPEAT_COUNT, [&] {
+        for (const PostingList& postings : lists) {
+            const PostingListView view = postings.GetView();
+            for (auto cursor = view.GetCursor(0, std::numeric_limits<int>::max()); !cursor.IsEnd(); cursor.Next()) {
+                sink += cursor.GetCount();
+            }
+        }
+    });
+    result.values.push_back({"postings_per_second"s, posting_count / result.seconds});
+    return result;
+}
+
+// Decodes runs of length slot gaps and counts, like posting blocks of
+// that size, with the decoder limited to kernel
+BenchmarkResult MeasureRunDecode(DecodeKernel kernel, const std::string& kernel_name, size_t length) {
+    // mostly one byte values, some of two and three bytes
+    std::mt19937 generator(5);
+    const size_t run_count = RUN_DECODE_VALUE_COUNT / length + 1;
+    std::vector<std::vector<uint8_t>> runs(run_count);
+    std::vector<uint32_t> values(length);
+    for (std::vector<uint8_t>& run : runs) {
+        for (uint32_t& value : values) {
+            value = generator() % 10 < 7 ? generator() % 200 : generator() % 70000;
+        }
+        EncodeStreamVByte(values.data(), length, run);
+        EncodeStreamVByte(values.data(), length, run);
+    }
+    SetDecodeKernel(kernel);
+    std::vector<uint32_t> decoded(length);
+    BenchmarkResult result = Measure("StreamVByte.decode."s + std::to_string(length) + "."s + kernel_name,
+                                     run_count * length, REPEAT_COUNT, [&] {
+        for (const std::vector<uint8_t>& run : runs) {
+            const size_t gaps_length = DecodeStreamVByteDelta(run.data(), run.size(), length, 0, decoded.data());
+            DecodeStreamVByte(run.data() + gaps_length, run.size() - gaps_length, length, decoded.data());
+            sink += decoded[length - 1];
+        }
+    });
+    result.values.push_back({"postings_per_second"s, result.operation_count / result.seconds});
+    // 0 scalar, 1 SSSE3, 2 AVX2
+    result.values.push_back({"kernel_used"s, static_cast<double>(GetDecodeKernel(length))});
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    if (!ScaleCorpusOptions(argc, argv, options)) {
+        std::cerr << "usage: "s << argv[0] << " [scale]"s << std::endl;
+        return 1;
+    }
+    CorpusGenerator generator(options);
+    const std::vector<std::string> texts = generator.MakeDocumentTexts();
+
+    std::vector<BenchmarkResult> results;
+    std::vector<PostingList> lists;
+    results.push_back(Measure("PostingList.Add"s, texts.size(), 1, [&] {
+        lists = BuildPostingLists(texts);
+    }));
+    size_t posting_count = 0;
+    size_t encoded_size = 0;
+    for (const PostingList& postings : lists) {
+        posting_count += postings.size();
+        encoded_size += postings.GetEncodedSize();
+    }
+    BenchmarkResult size_result{"PostingList.size"s, posting_count, 0.0};
+    size_result.values.push_back({"lists"s, static_cast<double>(lists.size())});
+    size_result.values.push_back({"bytes_per_posting"s, static_cast<double>(encoded_size) / posting_count});
+    size_result.values.push_back({"plain_bytes_per_posting"s, static_cast<double>(sizeof(Posting))});
+    results.push_back(size_result);
+
+    const DecodeKernel best_kernel = GetDecodeKernel();
+    std::vector<std::pair<DecodeKernel, std::string>> kernels = {{DecodeKernel::SCALAR, "scalar"s}};
+    if (best_kernel >= DecodeKernel::SSSE3) {
+        kernels.push_back({DecodeKernel::SSSE3, "ssse3"s});
+    }
+    if (best_kernel >= DecodeKernel::AVX2) {
+        kernels.push_back({DecodeKernel::AVX2, "avx2"s});
+    }
+    for (const auto& [kernel, kernel_name] : kernels) {
+        results.push_back(MeasureDecode(kernel, "PostingList.decode."s + kernel_name, lists, posting_count));
+    }
+    for (const size_t length : {3, 12, 40, 128}) {
+        for (const auto& [kernel, kernel_name] : kernels) {
+            results.push_back(MeasureRunDecode(kernel, kernel_name, length));
+        }
+    }
+    SetDecodeKernel(best_kernel);
+
+    std::cout << ToJson(options, results) << std::endl;
+    if (sink == 0) {
+        std::cerr << "no results"s << std::endl;
+    }
+}
@@ -0,0 +1,141 @@
+// Postings scanned per second by FindTopDocuments under both execution
+// policies, and the throughput of the score accumulator on its own, dense
+// and sparse. Printed as JSON like search_server_benchmark.
+//
+// The postings of a query are those of its plus words, counted by the
+// benchmark from the documents of the server, so both policies are
+// measured on the same work and the figure does not depend on the
+// metrics. The optional argument scales the number of documents and
+// queries.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../score_accumulator.h"
+#include "../search_server.h"
+#include "../string_processing.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// slots of the range the accumulator benchmarks score, a large segment
+const int ACCUMULATOR_SLOT_COUNT = 1 << 20;
+
+// Sum that the benchmarks feed their results into, so that nothing is
+// optimized away
+double sink = 0.0;
+
+// Postings of the plus words of all queries. Stop words are not in the
+// index and count nothing, a word repeated in a query counts once.
+uint64_t CountQueryPostings(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    std::unordered_map<std::string, uint64_t> document_freqs;
+    for (const int document_id : search_server) {
+        for (const auto& [word, _] : search_server.GetWordFrequencies(document_id)) {
+            ++document_freqs[std::string(word)];
+        }
+    }
+    uint64_t postings = 0;
+    for (const std::string& query : queries) {
+        std::vector<std::string_view> plus_words;
+        for (const std::string_view word : SplitIntoWordsView(query)) {
+            if (!word.empty() && word[0] != '-') {
+                plus_words.push_back(word);
+            }
+        }
+        std::sort(plus_words.begin(), plus_words.end());
+        plus_words.erase(std::unique(plus_words.begin(), plus_words.end()), plus_words.end());
+        for (const std::string_view word : plus_words) {
+            const auto it = document_freqs.find(std::string(word));
+            postings += it == document_freqs.end() ? 0 : it->second;
+        }
+    }
+    return postings;
+}
+
+template <typename ExecutionPolicy>
+BenchmarkResult MeasurePostingsScanned(const std::string& name, ExecutionPolicy policy,
+                                       const SearchServer& search_server, const std::vector<std::string>& queries,
+                                       uint64_t query_postings) {
+    BenchmarkResult result = Measure(name, queries.size(), REPEAT_COUNT, [&] {
+        for (const std::string& query : queries) {
+            sink += search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL).size();
+        }
+    });
+    const double postings = static_cast<double>(query_postings);
+    result.values.push_back({"postings_per_query"s, postings / queries.size()});
+    result.values.push_back({"postings_per_second"s, postings / result.seconds});
+    return result;
+}
+
+// Adds two terms of postings over a range of slot_count slots, a share of
+// which match, then reads the scores out
+BenchmarkResult MeasureAccumulator(const std::string& name, int slot_count, double match_share) {
+    std::mt19937_64 generator(7);
+    const size_t match_count = static_cast<size_t>(slot_count * match_share);
+    std::vector<int> slots(match_count);
+    for (int& slot : slots) {
+        slot = static_cast<int>(generator() % slot_count);
+    }
+    bool is_dense = false;
+    size_t size = 0;
+    BenchmarkResult result = Measure(name, slots.size() * 2, REPEAT_COUNT, [&] {
+        ScoreAccumulator accumulator(0, slot_count, slots.size());
+        for (int term = 0; term < 2; ++term) {
+            for (const int slot : slots) {
+                accumulator.Add(slot, 0.5);
+            }
+        }
+        accumulator.ForEach([](int, double score) {
+            sink += score;
+        });
+        is_dense = accumulator.IsDense();
+        size = accumulator.size();
+    });
+    result.values.push_back({"dense"s, is_dense ? 1.0 : 0.0});
+    result.values.push_back({"distinct_slots"s, static_cast<double>(size)});
+    result.values.push_back({"postings_per_second"s, result.operation_count / result.seconds});
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    if (!ScaleCorpusOptions(argc, argv, options)) {
+        std::cerr << "usage: "s << argv[0] << " [scale]"s << std::endl;
+        return 1;
+    }
+    CorpusGenerator generator(options);
+    const std::vector<std::string> texts = generator.MakeDocumentTexts();
+    const std::vector<DocumentInput> documents = generator.MakeDocuments(texts);
+    const std::vector<std::string> queries = generator.MakeQueries();
+    SearchServer search_server(generator.GetStopWords());
+    search_server.AddDocuments(documents);
+
+    const uint64_t query_postings = CountQueryPostings(search_server, queries);
+
+    std::vector<BenchmarkResult> results;
+    results.push_back(MeasurePostingsScanned("FindTopDocuments.seq"s, std::execution::seq, search_server, queries,
+                                             query_postings));
+    results.push_back(MeasurePostingsScanned("FindTopDocuments.par"s, std::execution::par, search_server, queries,
+                                             query_postings));
+    results.push_back(MeasureAccumulator("ScoreAccumulator.half"s, ACCUMULATOR_SLOT_COUNT, 0.5));
+    results.push_back(MeasureAccumulator("ScoreAccumulator.twentieth"s, ACCUMULATOR_SLOT_COUNT, 0.05));
+    results.push_back(MeasureAccumulator("ScoreAccumulator.thousandth"s, ACCUMULATOR_SLOT_COUNT, 0.001));
+
+    std::cout << ToJson(options, results) << std::endl;
+    if (sink == 0.0) {
+        std::cerr << "no results"s << std::endl;
+    }
+}
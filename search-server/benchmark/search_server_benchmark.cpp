@@ -0,0 +1,186 @@
+// Benchmarks of the SearchServer operations on a synthetic Zipf corpus,
+// printed as JSON so that runs on two commits can be compared.
+//
+// The optional argument scales the number of documents and queries.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../concurrent_map.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../search_server.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// Sum that the benchmarks feed their results into, so that nothing is
+// optimized away
+size_t sink = 0;
+
+void AddDocuments(SearchServer& search_server, const std::vector<DocumentInput>& documents) {
+    for (const DocumentInput& document : documents) {
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+}
+
+template <typename ExecutionPolicy>
+BenchmarkResult MeasureFindTop(const std::string& name, ExecutionPolicy policy, const SearchServer& search_server,
+                               const std::vector<std::string>& queries, bool is_status_predicate) {
+    return Measure(name, queries.size(), REPEAT_COUNT, [&] {
+        for (const std::string& query : queries) {
+            if (is_status_predicate) {
+                sink += search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL).size();
+            } else {
+                sink += search_server.FindTopDocuments(policy, query, [](int, DocumentStatus status, int rating) {
+                    return status == DocumentStatus::ACTUAL && rating > 0;
+                }).size();
+            }
+        }
+    });
+}
+
+// Queries per second of a stream and the latency of its queries, from
+// the time the stream reads a query to the time its results are consumed.
+// The percentiles are of the last run.
+BenchmarkResult MeasureQueryStream(const std::string& name, const SearchServer& search_server,
+                                   const std::vector<std::string>& queries, const QueryStreamOptions& options) {
+    std::vector<std::chrono::steady_clock::time_point> read_times(queries.size());
+    std::vector<double> latencies;
+    latencies.reserve(queries.size());
+    BenchmarkResult result = Measure(name, queries.size(), REPEAT_COUNT, [&] {
+        size_t read_count = 0;
+        latencies.clear();
+        ProcessQueriesStream(search_server, [&](std::string& query) {
+            if (read_count == queries.size()) {
+                return false;
+            }
+            read_times[read_count] = std::chrono::steady_clock::now();
+            query = queries[read_count++];
+            return true;
+        }, [&](const std::string&, std::vector<Document> documents) {
+            const std::chrono::duration<double, std::micro> latency =
+                std::chrono::steady_clock::now() - read_times[latencies.size()];
+            latencies.push_back(latency.count());
+            sink += documents.size();
+        }, options);
+    });
+    std::sort(latencies.begin(), latencies.end());
+    for (const auto& [percentile_name, percentile] : {std::pair{"latency_p50_us"s, 0.5}, std::pair{"latency_p90_us"s, 0.9},
+                                                      std::pair{"latency_p99_us"s, 0.99}}) {
+        const size_t index = std::min(latencies.size() - 1, static_cast<size_t>(percentile * latencies.size()));
+        result.values.push_back({percentile_name, latencies.empty() ? 0.0 : latencies[index]});
+    }
+    result.values.push_back({"latency_max_us"s, latencies.empty() ? 0.0 : latencies.back()});
+    return result;
+}
+
+// Removes every other document from a fresh server
+template <typename ExecutionPolicy>
+BenchmarkResult MeasureRemove(const std::string& name, ExecutionPolicy policy, const std::string& stop_words,
+                              const std::vector<DocumentInput>& documents) {
+    SearchServer search_server(stop_words);
+    search_server.AddDocuments(documents);
+    return Measure(name, (documents.size() + 1) / 2, 1, [&] {
+        for (size_t i = 0; i < documents.size(); i += 2) {
+            search_server.RemoveDocument(policy, documents[i].id);
+        }
+    });
+}
+
+BenchmarkResult MeasureConcurrentMap(const std::vector<std::string>& texts) {
+    // word lengths of all documents counted from every thread, the short
+    // frequent words contend for the same keys
+    const size_t thread_count = std::max(2u, std::thread::hardware_concurrency());
+    size_t word_count = 0;
+    for (const std::string& text : texts) {
+        ForEachWord(text, [&word_count](std::string_view) {
+            ++word_count;
+        });
+    }
+    return Measure("ConcurrentMap.FetchAdd"s, word_count, REPEAT_COUNT, [&] {
+        ConcurrentMap<int, int64_t> word_lengths(100);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; i < texts.size(); i += thread_count) {
+                    ForEachWord(texts[i], [&](std::string_view word) {
+                        word_lengths.FetchAdd(static_cast<int>(word.size()), 1);
+                    });
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        sink += word_lengths.BuildOrdinaryMap().size();
+    });
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    if (!ScaleCorpusOptions(argc, argv, options)) {
+        std::cerr << "usage: "s << argv[0] << " [scale]"s << std::endl;
+        return 1;
+    }
+    CorpusGenerator generator(options);
+    const std::string stop_words = generator.GetStopWords();
+    const std::vector<std::string> texts = generator.MakeDocumentTexts();
+    const std::vector<DocumentInput> documents = generator.MakeDocuments(texts);
+    const std::vector<std::string> queries = generator.MakeQueries();
+
+    std::vector<BenchmarkResult> results;
+    SearchServer search_server(stop_words);
+    results.push_back(Measure("AddDocument"s, documents.size(), 1, [&] {
+        AddDocuments(search_server, documents);
+    }));
+    results.push_back(MeasureFindTop("FindTopDocuments.seq.status"s, std::execution::seq, search_server, queries, true));
+    results.push_back(MeasureFindTop("FindTopDocuments.seq.lambda"s, std::execution::seq, search_server, queries, false));
+    results.push_back(MeasureFindTop("FindTopDocuments.par.status"s, std::execution::par, search_server, queries, true));
+    results.push_back(MeasureFindTop("FindTopDocuments.par.lambda"s, std::execution::par, search_server, queries, false));
+    results.push_back(Measure("MatchDocument"s, queries.size(), REPEAT_COUNT, [&] {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            sink += std::get<0>(search_server.MatchDocument(queries[i], documents[i % documents.size()].id)).size();
+        }
+    }));
+    results.push_back(Measure("ProcessQueries"s, queries.size(), REPEAT_COUNT, [&] {
+        sink += ProcessQueries(search_server, queries).size();
+    }));
+    results.push_back(Measure("ProcessQueriesJoined"s, queries.size(), REPEAT_COUNT, [&] {
+        sink += ProcessQueriesJoined(search_server, queries).size();
+    }));
+    results.push_back(MeasureQueryStream("ProcessQueriesStream"s, search_server, queries, {}));
+    QueryStreamOptions small_window;
+    small_window.max_pending_queries = 64;
+    results.push_back(MeasureQueryStream("ProcessQueriesStream.window64"s, search_server, queries, small_window));
+    results.push_back(MeasureRemove("RemoveDocument.seq"s, std::execution::seq, stop_words, documents));
+    results.push_back(MeasureRemove("RemoveDocument.par"s, std::execution::par, stop_words, documents));
+    {
+        SearchServer duplicates_server(stop_words);
+        duplicates_server.AddDocuments(documents);
+        results.push_back(Measure("RemoveDuplicates"s, documents.size(), 1, [&] {
+            RemoveDuplicates(duplicates_server, false);
+        }));
+        sink += duplicates_server.GetDocumentCount();
+    }
+    results.push_back(MeasureConcurrentMap(texts));
+
+    std::cout << ToJson(options, results) << std::endl;
+    // keeps the work from being optimized away
+    if (sink == 0) {
+        std::cerr << "no results"s << std::endl;
+    }
+}
@@ -0,0 +1,122 @@
+// Throughput of splitting text into words, in GB/s of input. Compares the
+// character by character SplitIntoWords that Tokenizer replaced, the
+// find based word loop, and Tokenizer with the default table and with the
+// text table and case folding, on short and long words.
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../string_processing.h"
+#include "../tokenizer.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const size_t TEXT_SIZE = 64 << 20;
+const int REPEAT_COUNT = 5;
+
+// Words of random letters from the given lengths, separated by spaces and
+// now and then by punctuation
+std::string MakeText(size_t min_length, size_t max_length) {
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<size_t> lengths(min_length, max_length);
+    std::uniform_int_distribution<int> letters('a', 'z');
+    std::uniform_int_distribution<int> percents(0, 99);
+    std::string text;
+    text.reserve(TEXT_SIZE + max_length + 2);
+    while (text.size() < TEXT_SIZE) {
+        const size_t length = lengths(generator);
+        for (size_t i = 0; i < length; ++i) {
+            text += static_cast<char>(percents(generator) < 5 ? letters(generator) - 'a' + 'A' : letters(generator));
+        }
+        if (percents(generator) < 10) {
+            text += ',';
+        }
+        text += ' ';
+    }
+    return text;
+}
+
+// The SplitIntoWords that Tokenizer replaced
+std::vector<std::string> SplitByCharacters(std::string_view text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (const char c : text) {
+        if (c == ' ') {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+        } else {
+            word += c;
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+// Best of REPEAT_COUNT runs, split returns the number of words
+template <typename Function>
+double MeasureGigabytesPerSecond(const std::string& text, Function split) {
+    double best_seconds = 0.0;
+    size_t word_count = 0;
+    for (int repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+        const auto start = std::chrono::steady_clock::now();
+        word_count += split(text);
+        const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (repeat == 0 || seconds.count() < best_seconds) {
+            best_seconds = seconds.count();
+        }
+    }
+    // keeps the work from being optimized away
+    if (word_count == 0) {
+        std::cerr << "no words"s << std::endl;
+    }
+    return text.size() / best_seconds / 1e9;
+}
+
+}  // namespace
+
+int main() {
+    const Tokenizer space_tokenizer;
+    const Tokenizer text_tokenizer = Tokenizer::MakeTextTokenizer();
+    std::cout << "words    characters  find  Tokenizer  Tokenizer+text+fold  (GB/s)"s << std::endl;
+    for (const auto& [min_length, max_length] : {std::pair<size_t, size_t>{2, 8}, {4, 16}, {16, 64}}) {
+        const std::string text = MakeText(min_length, max_length);
+        std::vector<std::string_view> words;
+        std::string folded;
+        words.reserve(text.size() / min_length);
+        const double characters_rate = MeasureGigabytesPerSecond(text, [](const std::string& text) {
+            return SplitByCharacters(text).size();
+        });
+        const double find_rate = MeasureGigabytesPerSecond(text, [&](const std::string& text) {
+            words.clear();
+            ForEachWord(text, [&](std::string_view word) {
+                words.push_back(word);
+            });
+            return words.size();
+        });
+        const double space_rate = MeasureGigabytesPerSecond(text, [&](const std::string& text) {
+            words.clear();
+            space_tokenizer.Split(text, folded, words);
+            return words.size();
+        });
+        const double text_rate = MeasureGigabytesPerSecond(text, [&](const std::string& text) {
+            words.clear();
+            text_tokenizer.Split(text, folded, words);
+            return words.size();
+        });
+        std::cout << std::setw(2) << min_length << '-' << std::setw(2) << max_length << std::fixed
+                  << std::setprecision(2) << std::setw(15) << characters_rate << std::setw(6) << find_rate
+                  << std::setw(11) << space_rate << std::setw(21) << text_rate << std::endl;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "flat_array.h"
+
+// Fixed set of bits that grows on demand, new bits are clear. A bitmap
+// over words owned elsewhere, such as a mapped index file, reads them in
+// place and copies them on the first change.
+class Bitmap {
+public:
+    Bitmap() = default;
+
+    // size bits read in place from the first (size + 63) / 64 words, 64 per
+    // word starting from the lowest bit. The words must outlive the bitmap
+    // and its copies.
+    Bitmap(ArrayView<uint64_t> words, size_t size)
+        : view_(words.data(), (size + 63) / 64)
+        , size_(size)
+        , is_mapped_(true) {
+    }
+
+    Bitmap(const Bitmap& other)
+        : words_(other.words_)
+        , view_(other.is_mapped_ ? other.view_ : ArrayView<uint64_t>(words_.data(), words_.size()))
+        , size_(other.size_)
+        , is_mapped_(other.is_mapped_) {
+    }
+
+    Bitmap& operator=(const Bitmap& other) {
+        if (this != &other) {
+            words_ = other.words_;
+            view_ = other.is_mapped_ ? other.view_ : ArrayView<uint64_t>(words_.data(), words_.size());
+            size_ = other.size_;
+            is_mapped_ = other.is_mapped_;
+        }
+        return *this;
+    }
+
+    // Moving a vector keeps its buffer, so the view stays valid
+    Bitmap(Bitmap&& other) noexcept
+        : words_(std::move(other.words_))
+        , view_(std::exchange(other.view_, {}))
+        , size_(std::exchange(other.size_, 0))
+        , is_mapped_(std::exchange(other.is_mapped_, false)) {
+    }
+
+    Bitmap& operator=(Bitmap&& other) noexcept {
+        if (this != &other) {
+            words_ = std::move(other.words_);
+            view_ = std::exchange(other.view_, {});
+            size_ = std::exchange(other.size_, 0);
+            is_mapped_ = std::exchange(other.is_mapped_, false);
+        }
+        return *this;
+    }
+
+    void Resize(size_t size) {
+        Own();
+        words_.resize((size + 63) / 64, 0);
+        view_ = ArrayView<uint64_t>(words_.data(), words_.size());
+        size_ = size;
+    }
+
+    void Set(size_t index) {
+        Own();
+        words_[index / 64] |= uint64_t{1} << (index % 64);
+    }
+
+    bool Test(size_t index) const {
+        return (view_[index / 64] >> (index % 64)) & 1;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Number of set bits
+    size_t Count() const {
+        size_t count = 0;
+        for (const uint64_t word : view_) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    ArrayView<uint64_t> GetWords() const {
+        return view_;
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    // the words the bits are read from, words_ unless the bitmap is mapped
+    ArrayView<uint64_t> view_;
+    size_t size_ = 0;
+    bool is_mapped_ = false;
+
+    void Own() {
+        if (is_mapped_) {
+            words_.assign(view_.begin(), view_.end());
+            view_ = ArrayView<uint64_t>(words_.data(), words_.size());
+            is_mapped_ = false;
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "boolean_query.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "metrics.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::string_view AND_OPERATOR = "AND";
+const std::string_view OR_OPERATOR = "OR";
+const std::string_view NEAR_OPERATOR = "NEAR/";
+
+bool IsSeparator(char c) {
+    return c == ' ' || c == '(' || c == ')' || c == '"';
+}
+
+bool IsOperator(std::string_view word) {
+    return word == AND_OPERATOR || word == OR_OPERATOR || word.substr(0, NEAR_OPERATOR.size()) == NEAR_OPERATOR;
+}
+
+// Copies the operators of text back over normalized, which has the same
+// length. Normalizing replaces delimiters by spaces, and a tokenizer that
+// splits on '/' would turn NEAR/3 into the words NEAR and 3.
+void RestoreOperators(std::string_view text, const Tokenizer& tokenizer, std::string& normalized) {
+    const auto is_token_end = [&tokenizer](char c) {
+        return IsSeparator(c) || (tokenizer.IsDelimiter(c) && c != '/');
+    };
+    size_t start = 0;
+    while (start < text.size()) {
+        if (is_token_end(text[start])) {
+            ++start;
+            continue;
+        }
+        size_t end = start;
+        while (end < text.size() && !is_token_end(text[end])) {
+            ++end;
+        }
+        if (IsOperator(text.substr(start, end - start))) {
+            normalized.replace(start, end - start, text.substr(start, end - start));
+        }
+        start = end;
+    }
+}
+
+class QueryParser {
+public:
+    // Parses the text of query, folding its words in place
+    QueryParser(BooleanQuery& query, const FlatStringSet& stop_words, const Tokenizer& tokenizer)
+        : query_(query)
+        , text_(query.text.data(), query.text.size())
+        , stop_words_(stop_words)
+        , tokenizer_(tokenizer) {
+    }
+
+    void Parse() {
+        BooleanQuery& query = query_;
+        if (std::optional<QueryNode> root = ParseOr()) {
+            query.root = std::move(*root);
+        }
+        if (Peek().kind != Token::Kind::END) {
+            throw std::invalid_argument("Unbalanced parenthesis in query"s);
+        }
+        std::sort(minus_words_.begin(), minus_words_.end());
+        minus_words_.erase(std::unique(minus_words_.begin(), minus_words_.end()), minus_words_.end());
+        query.minus_words = std::move(minus_words_);
+    }
+
+private:
+    struct Token {
+        enum class Kind {
+            WORD,
+            OPEN,
+            CLOSE,
+            QUOTE,
+            END,
+        };
+
+        Kind kind;
+        std::string_view text;
+    };
+
+    BooleanQuery& query_;
+    std::string_view text_;
+    const FlatStringSet& stop_words_;
+    const Tokenizer& tokenizer_;
+    size_t position_ = 0;
+    // parentheses open at the current position
+    size_t depth_ = 0;
+    std::vector<std::string_view> minus_words_;
+
+    Token Peek() {
+        while (position_ < text_.size() && text_[position_] == ' ') {
+            ++position_;
+        }
+        if (position_ == text_.size()) {
+            return {Token::Kind::END, {}};
+        }
+        switch (text_[position_]) {
+        case '(':
+            return {Token::Kind::OPEN, text_.substr(position_, 1)};
+        case ')':
+            return {Token::Kind::CLOSE, text_.substr(position_, 1)};
+        case '"':
+            return {Token::Kind::QUOTE, text_.substr(position_, 1)};
+        }
+        size_t end = position_;
+        while (end < text_.size() && !IsSeparator(text_[end])) {
+            ++end;
+        }
+        return {Token::Kind::WORD, text_.substr(position_, end - position_)};
+    }
+
+    Token Take() {
+        const Token token = Peek();
+        position_ += token.text.size();
+        return token;
+    }
+
+    bool PeekOperator(std::string_view name) {
+        const Token token = Peek();
+        return token.kind == Token::Kind::WORD && token.text == name;
+    }
+
+    // Operands that only had stop words or minus words are nullopt
+    std::optional<QueryNode> ParseOr() {
+        std::vector<QueryNode> children;
+        AddOperand(children, ParseAnd(), QueryNode::Type::OR);
+        while (Peek().kind != Token::Kind::END && Peek().kind != Token::Kind::CLOSE) {
+            if (PeekOperator(OR_OPERATOR)) {
+                Take();
+            }
+            AddOperand(children, ParseAnd(), QueryNode::Type::OR);
+        }
+        return Combine(QueryNode::Type::OR, std::move(children));
+    }
+
+    std::optional<QueryNode> ParseAnd() {
+        std::vector<QueryNode> children;
+        AddOperand(children, ParseNear(), QueryNode::Type::AND);
+        while (PeekOperator(AND_OPERATOR)) {
+            Take();
+            AddOperand(children, ParseNear(), QueryNode::Type::AND);
+        }
+        return Combine(QueryNode::Type::AND, std::move(children));
+    }
+
+    std::optional<QueryNode> ParseNear() {
+        std::optional<QueryNode> left = ParsePrimary();
+        const Token token = Peek();
+        if (token.kind != Token::Kind::WORD || token.text.substr(0, NEAR_OPERATOR.size()) != NEAR_OPERATOR) {
+            return left;
+        }
+        Take();
+        const std::string_view digits = token.text.substr(NEAR_OPERATOR.size());
+        if (digits.empty() || digits.size() > 9
+            || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            throw std::invalid_argument("Operator "s + std::string(token.text) + " is invalid"s);
+        }
+        std::optional<QueryNode> right = ParsePrimary();
+        for (const std::optional<QueryNode>* operand : {&left, &right}) {
+            if (*operand && (*operand)->type != QueryNode::Type::WORD && (*operand)->type != QueryNode::Type::PHRASE) {
+                throw std::invalid_argument("NEAR joins words and phrases only"s);
+            }
+        }
+        if (!left || !right) {
+            return left ? std::move(left) : std::move(right);
+        }
+        QueryNode node{QueryNode::Type::NEAR, {}, {}, static_cast<uint32_t>(std::stoul(std::string(digits))), {}};
+        node.children.push_back(std::move(*left));
+        node.children.push_back(std::move(*right));
+        return node;
+    }
+
+    std::optional<QueryNode> ParsePrimary() {
+        const Token token = Take();
+        switch (token.kind) {
+        case Token::Kind::OPEN: {
+            if (++depth_ > MAX_QUERY_DEPTH) {
+                throw std::invalid_argument("Query is nested too deeply"s);
+            }
+            std::optional<QueryNode> node = ParseOr();
+            if (Take().kind != Token::Kind::CLOSE) {
+                throw std::invalid_argument("Unbalanced parenthesis in query"s);
+            }
+            --depth_;
+            return node;
+        }
+        case Token::Kind::QUOTE:
+            return ParsePhrase();
+        case Token::Kind::WORD:
+            break;
+        default:
+            throw std::invalid_argument("Query operand is missing"s);
+        }
+        if (IsOperator(token.text)) {
+            throw std::invalid_argument("Operator "s + std::string(token.text) + " has no operand"s);
+        }
+        if (token.text[0] == '-') {
+            const std::string_view word = Fold(CheckWord(token.text.substr(1), token.text));
+            if (!stop_words_.Contains(word)) {
+                minus_words_.push_back(word);
+            }
+            return std::nullopt;
+        }
+        const std::string_view word = Fold(CheckWord(token.text, token.text));
+        if (stop_words_.Contains(word)) {
+            return std::nullopt;
+        }
+        return QueryNode{QueryNode::Type::WORD, {word}, {0}, 0, {}};
+    }
+
+    // After the opening quote
+    std::optional<QueryNode> ParsePhrase() {
+        QueryNode node{QueryNode::Type::PHRASE, {}, {}, 0, {}};
+        uint32_t offset = 0;
+        while (true) {
+            const Token token = Take();
+            if (token.kind == Token::Kind::QUOTE) {
+                break;
+            }
+            if (token.kind != Token::Kind::WORD) {
+                throw std::invalid_argument("Unbalanced quotes in query"s);
+            }
+            const std::string_view word = Fold(CheckWord(token.text, token.text));
+            if (!stop_words_.Contains(word)) {
+                node.words.push_back(word);
+                node.offsets.push_back(offset);
+            }
+            ++offset;
+        }
+        if (node.words.empty()) {
+            return std::nullopt;
+        }
+        // positions are counted from the first word that is kept
+        for (uint32_t& word_offset : node.offsets) {
+            word_offset -= node.offsets.front();
+        }
+        if (node.words.size() == 1) {
+            node.type = QueryNode::Type::WORD;
+        }
+        return node;
+    }
+
+    // Operators are recognized before their case could be folded
+    std::string_view Fold(std::string_view word) {
+        tokenizer_.FoldCase(query_.text.data() + (word.data() - text_.data()), word.size());
+        return word;
+    }
+
+    // The same rules as for the words of plain queries
+    static std::string_view CheckWord(std::string_view word, std::string_view token) {
+        if (word.empty() || word[0] == '-'
+            || std::any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+            throw std::invalid_argument("Query word "s + std::string(token) + " is invalid"s);
+        }
+        return word;
+    }
+
+    static void AddOperand(std::vector<QueryNode>& children, std::optional<QueryNode> operand, QueryNode::Type type) {
+        if (!operand) {
+            return;
+        }
+        // (a OR b) OR c is a OR b OR c
+        if (operand->type == type) {
+            std::move(operand->children.begin(), operand->children.end(), std::back_inserter(children));
+            return;
+        }
+        children.push_back(std::move(*operand));
+    }
+
+    static std::optional<QueryNode> Combine(QueryNode::Type type, std::vector<QueryNode> children) {
+        if (children.empty()) {
+            return std::nullopt;
+        }
+        if (children.size() == 1) {
+            return std::move(children.front());
+        }
+        return QueryNode{type, {}, {}, 0, std::move(children)};
+    }
+};
+
+void CollectWords(const QueryNode& node, std::vector<std::string_view>& words) {
+    words.insert(words.end(), node.words.begin(), node.words.end());
+    for (const QueryNode& child : node.children) {
+        CollectWords(child, words);
+    }
+}
+
+}  // namespace
+
+bool IsBooleanQuery(std::string_view text) {
+    if (text.find_first_of("()\"") != std::string_view::npos) {
+        return true;
+    }
+    size_t position = text.find_first_not_of(' ');
+    while (position != std::string_view::npos) {
+        const size_t space = text.find(' ', position);
+        if (IsOperator(text.substr(position, space - position))) {
+            return true;
+        }
+        position = text.find_first_not_of(' ', space);
+    }
+    return false;
+}
+
+BooleanQuery ParseBooleanQuery(std::string_view text, const FlatStringSet& stop_words, const Tokenizer& tokenizer) {
+    METRICS_SCOPED_TIMER(QUERY_PARSE);
+    BooleanQuery query;
+    std::string normalized;
+    tokenizer.Normalize(text, "()\"", normalized, false);
+    RestoreOperators(text, tokenizer, normalized);
+    query.text.assign(normalized.begin(), normalized.end());
+    QueryParser(query, stop_words, tokenizer).Parse();
+    return query;
+}
+
+bool NeedsWordPositions(const QueryNode& node) {
+    if (node.type == QueryNode::Type::PHRASE || node.type == QueryNode::Type::NEAR) {
+        return true;
+    }
+    return std::any_of(node.children.begin(), node.children.end(), [](const QueryNode& child) {
+        return NeedsWordPositions(child);
+    });
+}
+
+std::vector<std::string_view> GetQueryWords(const QueryNode& node) {
+    std::vector<std::string_view> words;
+    CollectWords(node, words);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "flat_string_set.h"
+#include "tokenizer.h"
+
+// Query language on top of the plain bag of words:
+//
+//     cat dog             either word, as in a plain query
+//     cat AND dog         both words
+//     cat OR dog          either word, OR binds looser than AND
+//     (cat OR dog) AND hat
+//     "curly cat"         the words next to each other in this order
+//     cat NEAR/3 dog      the words at most 3 positions apart, either order
+//     -collar             no document with the word, wherever it appears
+//
+// NEAR joins two words or phrases, which have to match words that do not
+// overlap, so "cat NEAR/2 cat" needs two cats. Positions count stop words
+// too, so a stop word inside a phrase has to be there, though any word will do.
+
+// Parentheses nested deeper are rejected, the parser and the walks over
+// the query tree recurse once per level
+const size_t MAX_QUERY_DEPTH = 64;
+
+struct QueryNode {
+    enum class Type {
+        WORD,
+        PHRASE,
+        NEAR,
+        AND,
+        OR,
+    };
+
+    Type type;
+    // WORD has one, PHRASE several, with offsets[i] the position of
+    // words[i] counted from the first word
+    std::vector<std::string_view> words;
+    std::vector<uint32_t> offsets;
+    // NEAR: the most positions between its two children
+    uint32_t distance = 0;
+    std::vector<QueryNode> children;
+};
+
+struct BooleanQuery {
+    BooleanQuery() = default;
+    // the words point into text, a copy would point into the original
+    BooleanQuery(const BooleanQuery&) = delete;
+    BooleanQuery& operator=(const BooleanQuery&) = delete;
+    BooleanQuery(BooleanQuery&&) = default;
+    BooleanQuery& operator=(BooleanQuery&&) = default;
+
+    // the query with delimiters replaced by spaces and the words folded
+    std::vector<char> text;
+    // OR without children when the query has no words to match
+    QueryNode root{QueryNode::Type::OR, {}, {}, 0, {}};
+    // sorted and unique
+    std::vector<std::string_view> minus_words;
+};
+
+// Whether the text uses quotes, parentheses or an operator, plain queries
+// keep their own parser
+bool IsBooleanQuery(std::string_view text);
+
+// Words are split and folded by the tokenizer, except that parentheses and
+// quotes keep their meaning even when they are delimiters. Stop words are
+// left out, an operand that only has stop words disappears. Throws
+// std::invalid_argument on syntax errors, on invalid words and on
+// parentheses nested deeper than MAX_QUERY_DEPTH.
+BooleanQuery ParseBooleanQuery(std::string_view text, const FlatStringSet& stop_words, const Tokenizer& tokenizer);
+
+// Whether the node or one of its children is a phrase or NEAR
+bool NeedsWordPositions(const QueryNode& node);
+
+// Every word of the node and its children, sorted and unique
+std::vector<std::string_view> GetQueryWords(const QueryNode& node);
@@ -0,0 +1,117 @@
+// Checks of boolean queries under the text tokenizer, which splits on
+// punctuation: operators keep their meaning, NEAR still needs word
+// positions and never pairs a word with itself, stop words are split like
+// the documents, and deep nesting is rejected. Run it without arguments, it exits with 1 if a check fails.
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+std::vector<int> FindIds(const SearchServer& search_server, const std::string& query) {
+    std::vector<int> ids;
+    for (const Document& document : search_server.FindTopDocuments(query)) {
+        ids.push_back(document.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void AddNearDocuments(SearchServer& search_server) {
+    search_server.AddDocument(1, "cat a b c d e f g h dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat, x dog."s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "Dog y z cat!"s, DocumentStatus::ACTUAL, {1});
+}
+
+void CheckNear() {
+    SearchServer search_server(""s, Tokenizer::MakeTextTokenizer());
+    search_server.EnableWordPositions();
+    search_server.EnableBooleanQueries();
+    AddNearDocuments(search_server);
+    Check(FindIds(search_server, "cat NEAR/3 dog"s) == std::vector<int>{2, 3}, "NEAR/3"s);
+    Check(FindIds(search_server, "cat NEAR/0 dog"s).empty(), "NEAR/0"s);
+    Check(FindIds(search_server, "(a AND cat) OR y"s) == std::vector<int>{1, 3}, "AND and OR"s);
+    Check(FindIds(search_server, "\"x dog\""s) == std::vector<int>{2}, "phrase"s);
+}
+
+// Operands that share words have to match different occurrences
+void CheckNearOverlap() {
+    SearchServer search_server(""s, Tokenizer::MakeTextTokenizer());
+    search_server.EnableWordPositions();
+    search_server.EnableBooleanQueries();
+    search_server.AddDocument(1, "cat a b"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat x cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "a b b"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "b a b"s, DocumentStatus::ACTUAL, {1});
+    Check(FindIds(search_server, "cat NEAR/0 cat"s).empty(), "cat NEAR/0 cat"s);
+    Check(FindIds(search_server, "cat NEAR/1 cat"s).empty(), "cat NEAR/1 cat"s);
+    Check(FindIds(search_server, "cat NEAR/2 cat"s) == std::vector<int>{2}, "cat NEAR/2 cat"s);
+    Check(FindIds(search_server, "\"a b\" NEAR/0 b"s).empty(), "\"a b\" NEAR/0 b"s);
+    Check(FindIds(search_server, "\"a b\" NEAR/1 b"s) == std::vector<int>{3, 4}, "\"a b\" NEAR/1 b"s);
+    Check(FindIds(search_server, "b NEAR/1 \"a b\""s) == std::vector<int>{3, 4}, "b NEAR/1 \"a b\""s);
+}
+
+void CheckNearNeedsPositions() {
+    SearchServer search_server(""s, Tokenizer::MakeTextTokenizer());
+    search_server.EnableBooleanQueries();
+    AddNearDocuments(search_server);
+    bool is_thrown = false;
+    try {
+        search_server.FindTopDocuments("cat NEAR/3 dog"s);
+    } catch (const std::invalid_argument&) {
+        is_thrown = true;
+    }
+    Check(is_thrown, "NEAR without word positions has to throw"s);
+}
+
+void CheckStopWords() {
+    SearchServer search_server("and, with;"s, Tokenizer::MakeTextTokenizer());
+    search_server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    Check(search_server.FindTopDocuments("and"s).empty(), "stop word and, is and"s);
+    Check(search_server.FindTopDocuments("With"s).empty(), "stop word with; is folded"s);
+    Check(search_server.FindTopDocuments("cat"s).size() == 1, "other words are found"s);
+}
+
+bool IsRejected(const SearchServer& search_server, const std::string& query) {
+    try {
+        search_server.FindTopDocuments(query);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+// Parentheses up to MAX_QUERY_DEPTH deep parse, deeper ones are rejected
+// before the recursion can run out of stack
+void CheckNesting() {
+    SearchServer search_server(""s, Tokenizer::MakeTextTokenizer());
+    search_server.EnableWordPositions();
+    search_server.EnableBooleanQueries();
+    AddNearDocuments(search_server);
+    const auto nest = [](size_t depth, const std::string& query) {
+        return std::string(depth, '(') + query + std::string(depth, ')');
+    };
+    Check(FindIds(search_server, nest(MAX_QUERY_DEPTH, "cat NEAR/3 dog"s)) == std::vector<int>{2, 3},
+          "parentheses MAX_QUERY_DEPTH deep"s);
+    Check(IsRejected(search_server, nest(MAX_QUERY_DEPTH + 1, "cat"s)), "parentheses too deep"s);
+    Check(IsRejected(search_server, nest(200000, "cat"s)), "200000 parentheses"s);
+    Check(IsRejected(search_server, std::string(200000, '(') + "cat"s), "200000 unclosed parentheses"s);
+}
+
+}  // namespace
+
+int main() {
+    CheckNear();
+    CheckNearOverlap();
+    CheckNearNeedsPositions();
+    CheckStopWords();
+    CheckNesting();
+    return FinishChecks();
+}
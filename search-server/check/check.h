@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+// Failure reporting shared by the check programs. Check can be called from
+// several threads at once, failed checks are counted and printed to
+// std::cerr and the program keeps running.
+
+inline std::atomic<int> check_failure_count{0};
+inline std::mutex check_output_mutex;
+
+inline void Check(bool condition, const std::string& hint) {
+    if (!condition) {
+        ++check_failure_count;
+        std::lock_guard guard(check_output_mutex);
+        std::cerr << "FAILED: " << hint << std::endl;
+    }
+}
+
+// Exit code of a check program: prints summary and returns 0 if no check
+// failed, returns 1 otherwise
+inline int FinishChecks(const std::string& summary = "OK") {
+    if (check_failure_count > 0) {
+        return 1;
+    }
+    std::cout << summary << std::endl;
+    return 0;
+}
@@ -0,0 +1,209 @@
+// Stress check of searches that run while documents are added and removed:
+// reader threads call ProcessQueries and ProcessQueriesJoined in a loop
+// while a writer thread keeps adding documents, removing every other one
+// it added and so causing segment merges, and another one adds batches
+// with AddDocuments(std::execution::par). Then a batch runs alongside
+// EnableWordPositions on an empty server.
+//
+// The optional argument is the number of documents the writer adds. It
+// exits with 1 if a check fails; building it with -fsanitize=thread also
+// looks for data races.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../process_queries.h"
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// documents that stay in the index the whole time
+const int BASE_DOCUMENT_COUNT = 100;
+const int FIRST_ADDED_ID = 1000;
+// ids of the documents the batch writer adds, which are never removed
+const int FIRST_BATCH_ID = 100000000;
+const int BATCH_SIZE = 250;
+
+std::string MakeText(int id) {
+    return "cat dog word"s + std::to_string(id % 37) + (id % 3 == 0 ? " parrot"s : ""s);
+}
+
+// Results of a query seen while the writer ran: no more than the top, the
+// best first, and only ids that were added before the search ended. A
+// document is visible before AddDocument returns, so the id after the
+// last one the writer reported may be there too.
+void CheckResults(const std::string& query, ArrayView<Document> documents, int last_added_id) {
+    Check(documents.size() <= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), query + ": too many results"s);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const Document& document = documents[i];
+        Check(i == 0 || documents[i - 1].relevance >= document.relevance - EPSILON, query + ": unsorted results"s);
+        Check(document.id < BASE_DOCUMENT_COUNT || (document.id >= FIRST_ADDED_ID && document.id <= last_added_id + 1)
+              || document.id >= FIRST_BATCH_ID, query + ": unknown document "s + std::to_string(document.id));
+    }
+    if (query == "anchor"s) {
+        // the base documents are never removed, so the top is always full
+        Check(documents.size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), "anchor: missing base documents"s);
+    }
+}
+
+// A parallel batch races EnableWordPositions on an empty server. One of
+// them may fail, not both, and if both succeed the batch keeps the word
+// positions its phrases need. Returns the number of batches that failed
+// because word positions were enabled while they were built.
+int CheckBatchWithWordPositions() {
+    const int round_count = 100;
+    const int document_count = 2000;
+    std::vector<std::string> texts;
+    for (int id = 0; id < document_count; ++id) {
+        texts.push_back("alpha beta word"s + std::to_string(id % 37));
+    }
+    std::vector<DocumentInput> batch;
+    for (int id = 0; id < document_count; ++id) {
+        batch.push_back({id, texts[id], DocumentStatus::ACTUAL, {1}});
+    }
+    // The delay before EnableWordPositions is bisected towards the moment
+    // the batch publishes its segments, which ends the time the segments
+    // are built in, and widened a little every round to follow the noise.
+    const auto start = std::chrono::steady_clock::now();
+    SearchServer(""s).AddDocuments(std::execution::par, batch);
+    std::chrono::duration<double, std::micro> early_delay{0.0};
+    std::chrono::duration<double, std::micro> late_delay = std::chrono::steady_clock::now() - start;
+    int failed_batch_count = 0;
+    for (int round = 0; round < round_count; ++round) {
+        SearchServer search_server(""s);
+        search_server.EnableBooleanQueries();
+        std::atomic<bool> is_started{false};
+        bool is_batch_added = true;
+        bool is_enabled = true;
+        std::thread batch_writer([&] {
+            is_started = true;
+            try {
+                search_server.AddDocuments(std::execution::par, batch);
+            } catch (const std::logic_error&) {
+                is_batch_added = false;
+            }
+        });
+        while (!is_started) {
+            std::this_thread::yield();
+        }
+        const auto delay = (early_delay + late_delay) / 2;
+        std::this_thread::sleep_for(delay);
+        try {
+            search_server.EnableWordPositions();
+        } catch (const std::logic_error&) {
+            is_enabled = false;
+        }
+        batch_writer.join();
+        (is_enabled ? early_delay : late_delay) = delay;
+        early_delay *= 0.9;
+        late_delay *= 1.1;
+
+        const std::string hint = "batch with word positions, round "s + std::to_string(round);
+        failed_batch_count += is_batch_added ? 0 : 1;
+        Check(is_batch_added || is_enabled, hint + ": both failed"s);
+        Check(search_server.HasWordPositions() == is_enabled, hint + ": word positions"s);
+        Check(search_server.GetDocumentCount() == (is_batch_added ? document_count : 0), hint + ": document count"s);
+        if (is_batch_added && is_enabled) {
+            Check(search_server.FindTopDocuments("\"alpha beta\""s).size()
+                  == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), hint + ": phrase"s);
+        }
+    }
+    return failed_batch_count;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const int added_count = argc > 1 ? std::atoi(argv[1]) : 5000;
+    if (added_count <= 0) {
+        std::cerr << "usage: "s << argv[0] << " [added document count]"s << std::endl;
+        return 1;
+    }
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < BASE_DOCUMENT_COUNT; ++id) {
+        search_server.AddDocument(id, "anchor cat with collar"s, DocumentStatus::ACTUAL, {id % 10});
+    }
+    const std::vector<std::string> queries = {"anchor"s, "cat"s, "dog -parrot"s, "parrot word5 and"s,
+                                              "word1 word2 word3"s, "cat -anchor"s, "missing"s};
+
+    std::atomic<int> last_added_id{FIRST_ADDED_ID - 1};
+    std::atomic<int> writer_count{2};
+    int removed_count = 0;
+    std::thread writer([&] {
+        for (int id = FIRST_ADDED_ID; id < FIRST_ADDED_ID + added_count; ++id) {
+            search_server.AddDocument(id, MakeText(id), DocumentStatus::ACTUAL, {id % 7});
+            last_added_id.store(id, std::memory_order_release);
+            if (id % 2 == 1 && id - 10 >= FIRST_ADDED_ID) {
+                search_server.RemoveDocument(id - 10);
+                ++removed_count;
+            }
+        }
+        --writer_count;
+    });
+    // a parallel batch runs its tasks in the pool the parallel searches use
+    int batch_document_count = 0;
+    std::thread batch_writer([&] {
+        for (int first_id = FIRST_BATCH_ID; first_id < FIRST_BATCH_ID + added_count; first_id += BATCH_SIZE) {
+            std::vector<std::string> texts;
+            std::vector<DocumentInput> batch;
+            for (int id = first_id; id < std::min(first_id + BATCH_SIZE, FIRST_BATCH_ID + added_count); ++id) {
+                texts.push_back(MakeText(id));
+            }
+            for (size_t i = 0; i < texts.size(); ++i) {
+                batch.push_back({first_id + static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1}});
+            }
+            search_server.AddDocuments(std::execution::par, batch);
+            batch_document_count += static_cast<int>(batch.size());
+        }
+        --writer_count;
+    });
+
+    std::atomic<size_t> search_count{0};
+    const size_t reader_count = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < reader_count; ++r) {
+        readers.emplace_back([&, r] {
+            while (writer_count > 0) {
+                if (r % 2 == 0) {
+                    const std::vector<std::vector<Document>> results = ProcessQueries(search_server, queries);
+                    const int last_id = last_added_id.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < queries.size(); ++i) {
+                        CheckResults(queries[i], {results[i].data(), results[i].size()}, last_id);
+                    }
+                } else {
+                    const JoinedDocuments joined = ProcessQueriesJoined(search_server, queries);
+                    const int last_id = last_added_id.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < queries.size(); ++i) {
+                        CheckResults(queries[i], joined.GetQueryDocuments(i), last_id);
+                    }
+                }
+                search_count += queries.size();
+            }
+        });
+    }
+    writer.join();
+    batch_writer.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    Check(search_server.GetDocumentCount() == BASE_DOCUMENT_COUNT + added_count - removed_count + batch_document_count,
+          "document count after the writer"s);
+    Check(search_server.FindTopDocuments("word5"s).size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT),
+          "added documents are found"s);
+
+    const int failed_batch_count = CheckBatchWithWordPositions();
+    return FinishChecks("OK "s + std::to_string(search_count) + " searches, "s + std::to_string(failed_batch_count)
+                        + " batches raced EnableWordPositions"s);
+}
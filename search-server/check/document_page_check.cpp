@@ -0,0 +1,145 @@
+// Checks of FindDocumentPage: paging a result set full of ties in
+// relevance and rating to the end returns every document of the full
+// ranking once, in its order, under both policies, with the result cache
+// on and off and by predicate. Malformed cursors are rejected. Run it
+// without arguments, it exits with 1 if a check fails.
+
+#include <cmath>
+#include <cstddef>
+#include <execution>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// more than a segment, so pages span sealed segments and the open one
+const int DOCUMENT_COUNT = SEGMENT_DOCUMENT_COUNT + 1000;
+// ranks every match of the queries below
+const size_t FULL_TOP_SIZE = DOCUMENT_COUNT;
+
+// Four texts and three ratings, so most documents tie with many others
+void AddDocuments(SearchServer& search_server) {
+    const std::vector<std::string> texts = {"cat"s, "cat dog"s, "dog"s, "cat cat parrot"s};
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        const DocumentStatus status = id % 10 == 9 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        search_server.AddDocument(id, texts[id % texts.size()], status, {id % 3});
+    }
+}
+
+using PageFunction = std::function<DocumentPage(const std::string& query, size_t page_size,
+                                                const std::string& search_after)>;
+
+// Follows next_cursor to the end and compares the pages with the full ranking
+void CheckPaging(const std::string& name, const PageFunction& find_page, const std::string& query,
+                 size_t page_size, const std::vector<Document>& ranking) {
+    const std::string hint = name + ", "s + query + ", pages of "s + std::to_string(page_size);
+    std::vector<Document> paged;
+    std::set<int> paged_ids;
+    std::string cursor;
+    for (size_t page_count = 0;; ++page_count) {
+        if (page_count > ranking.size() / page_size + 1) {
+            Check(false, hint + ": the pages do not end"s);
+            break;
+        }
+        const DocumentPage page = find_page(query, page_size, cursor);
+        Check(page.documents.size() <= page_size, hint + ": page too large"s);
+        for (const Document& document : page.documents) {
+            Check(paged_ids.insert(document.id).second, hint + ": document "s + std::to_string(document.id)
+                  + " is on two pages"s);
+            paged.push_back(document);
+        }
+        if (page.next_cursor.empty()) {
+            Check(page.documents.size() < page_size, hint + ": a full page without a cursor"s);
+            break;
+        }
+        Check(page.documents.size() == page_size, hint + ": a cursor after a page that is not full"s);
+        cursor = page.next_cursor;
+    }
+    Check(paged.size() == ranking.size(), hint + ": "s + std::to_string(paged.size()) + " documents paged of "s
+          + std::to_string(ranking.size()));
+    bool is_same_order = paged.size() == ranking.size();
+    for (size_t i = 0; is_same_order && i < paged.size(); ++i) {
+        is_same_order = paged[i].id == ranking[i].id && paged[i].rating == ranking[i].rating
+                        && std::abs(paged[i].relevance - ranking[i].relevance) < EPSILON;
+    }
+    Check(is_same_order, hint + ": the pages differ from the full ranking"s);
+}
+
+void CheckPages(const SearchServer& search_server, const std::string& name) {
+    const PageFunction find_seq_page = [&](const std::string& query, size_t page_size, const std::string& cursor) {
+        return search_server.FindDocumentPage(std::execution::seq, query, DocumentStatus::ACTUAL, page_size, cursor);
+    };
+    const PageFunction find_par_page = [&](const std::string& query, size_t page_size, const std::string& cursor) {
+        return search_server.FindDocumentPage(std::execution::par, query, DocumentStatus::ACTUAL, page_size, cursor);
+    };
+    const PageFunction find_predicate_page = [&](const std::string& query, size_t page_size,
+                                                 const std::string& cursor) {
+        return search_server.FindDocumentPage(query, [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::ACTUAL;
+        }, page_size, cursor);
+    };
+    for (const std::string& query : {"cat"s, "cat dog -parrot"s, "parrot"s, "missing"s}) {
+        const std::vector<Document> ranking = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL,
+                                                                             FULL_TOP_SIZE);
+        for (const size_t page_size : {1, 7, 100, 1000}) {
+            // one document per page costs a search per document
+            if (page_size == 1 && ranking.size() > 1000) {
+                continue;
+            }
+            CheckPaging(name + ", seq"s, find_seq_page, query, page_size, ranking);
+            CheckPaging(name + ", par"s, find_par_page, query, page_size, ranking);
+            CheckPaging(name + ", predicate"s, find_predicate_page, query, page_size, ranking);
+        }
+    }
+}
+
+void CheckMalformedCursors(const SearchServer& search_server) {
+    const std::string valid_cursor = search_server.FindDocumentPage("cat"s, DocumentStatus::ACTUAL, 3).next_cursor;
+    Check(valid_cursor.size() == 32, "a cursor is 32 hex digits"s);
+    std::string upper_case_cursor = valid_cursor;
+    upper_case_cursor[0] = 'A';
+    const std::vector<std::string> cursors = {
+        "0"s, valid_cursor.substr(1), valid_cursor + "0"s, std::string(32, 'g'), "0x"s + valid_cursor.substr(2),
+        valid_cursor.substr(0, 31) + " "s, upper_case_cursor,
+        // a NaN relevance and a negative id
+        "7ff8000000000000"s + valid_cursor.substr(16), valid_cursor.substr(0, 24) + "ffffffff"s};
+    for (const std::string& cursor : cursors) {
+        for (int way = 0; way < 3; ++way) {
+            bool is_thrown = false;
+            try {
+                if (way == 0) {
+                    search_server.FindDocumentPage(std::execution::seq, "cat"s, DocumentStatus::ACTUAL, 3, cursor);
+                } else if (way == 1) {
+                    search_server.FindDocumentPage(std::execution::par, "cat"s, DocumentStatus::ACTUAL, 3, cursor);
+                } else {
+                    search_server.FindDocumentPage("cat"s, [](int, DocumentStatus, int) {
+                        return true;
+                    }, 3, cursor);
+                }
+            } catch (const std::invalid_argument&) {
+                is_thrown = true;
+            }
+            Check(is_thrown, "cursor \""s + cursor + "\" is rejected, way "s + std::to_string(way));
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    SearchServer search_server("and with"s);
+    AddDocuments(search_server);
+    CheckPages(search_server, "no cache"s);
+    search_server.SetResultCacheLimit(1 << 20);
+    CheckPages(search_server, "cache"s);
+    CheckMalformedCursors(search_server);
+    return FinishChecks();
+}
@@ -0,0 +1,317 @@
+// Checks that damaged index files are rejected by SearchServer::Open or
+// by Verify, and that the searches and lookups in between only throw
+// std::invalid_argument. Also checks that an opened index keeps the
+// documents added and removed after Open apart from the saved ones. Run
+// it without arguments, it writes its files to the current directory and
+// exits with 1 if a check fails.
+
+#include <cstdio>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../index_file.h"
+#include "../posting_list.h"
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::string INDEX_PATH = "index_file_check.idx"s;
+const std::string DAMAGED_PATH = "index_file_check_damaged.idx"s;
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+template <typename T>
+T* GetRecords(std::string& file, FileArray array) {
+    return reinterpret_cast<T*>(file.data() + array.offset);
+}
+
+const int DOCUMENT_COUNT = 300;
+
+void WriteDamaged(const std::function<void(std::string&, IndexFileHeader&)>& damage) {
+    std::string file = ReadFile(INDEX_PATH);
+    damage(file, *reinterpret_cast<IndexFileHeader*>(file.data()));
+    std::ofstream(DAMAGED_PATH, std::ios::binary) << file;
+}
+
+// Whether the call throws std::invalid_argument, other exceptions fail the check
+bool IsRejected(const std::function<void()>& use) {
+    try {
+        use();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+// Reads every document and every word of the index the way a client does
+void UseIndex(SearchServer& search_server) {
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        IsRejected([&] {
+            search_server.GetWordFrequencies(id);
+        });
+        IsRejected([&] {
+            try {
+                search_server.MatchDocument("cat dog number"s, id);
+            } catch (const std::out_of_range&) {
+                // a damaged location can hide its document
+            }
+        });
+    }
+    for (const std::string& query : {"cat"s, "dog -cat"s, "number 0 1 2 3 4 5 6"s, "missing"s}) {
+        IsRejected([&] {
+            search_server.FindTopDocuments(query);
+        });
+    }
+    IsRejected([&] {
+        std::vector<int>(search_server.begin(), search_server.end());
+    });
+    for (int id = 0; id < DOCUMENT_COUNT; id += 2) {
+        IsRejected([&] {
+            search_server.RemoveDocument(id);
+        });
+    }
+}
+
+// Writes a copy of the saved index changed by damage and checks that Open
+// or Verify rejects it, right after Open and after the index is used
+void CheckDamaged(const std::string& name, const std::function<void(std::string&, IndexFileHeader&)>& damage) {
+    WriteDamaged(damage);
+    for (const bool is_used : {false, true}) {
+        bool is_accepted = false;
+        IsRejected([&] {
+            SearchServer search_server = SearchServer::Open(DAMAGED_PATH);
+            if (is_used) {
+                UseIndex(search_server);
+            }
+            search_server.Verify();
+            is_accepted = true;
+        });
+        Check(!is_accepted, name + (is_used ? " has to be rejected after use"s : " has to be rejected"s));
+    }
+}
+
+SegmentFileHeader& GetFirstSegment(std::string& file, IndexFileHeader& header) {
+    return *GetRecords<SegmentFileHeader>(file, header.segments);
+}
+
+// Posting blocks are checked when they are decoded, which has to stay
+// within the bytes of the segment. "cat" is term 0, its postings start
+// with block 0.
+void CheckDamagedPostings(const std::string& name, const std::function<void(std::string&, IndexFileHeader&)>& damage) {
+    WriteDamaged(damage);
+    Check(IsRejected([] {
+        SearchServer::Open(DAMAGED_PATH).FindTopDocuments("cat"s);
+    }), name + " has to be rejected"s);
+}
+
+// Locations are checked when they are used, so a damaged one only fails
+// its own document
+void CheckDamagedLocation() {
+    WriteDamaged([](std::string& file, IndexFileHeader& header) {
+        GetRecords<IndexFileLocation>(file, header.locations)[0].slot = 1000;
+    });
+    const SearchServer search_server = SearchServer::Open(DAMAGED_PATH);
+    Check(IsRejected([&] {
+        search_server.GetWordFrequencies(0);
+    }), "the damaged location has to be rejected"s);
+    Check(search_server.GetWordFrequencies(1).size() == 4, "the other locations are read"s);
+    Check(search_server.FindTopDocuments("cat"s).size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT),
+          "the index with a damaged location is searched"s);
+}
+
+// Open reads no records, a damaged one only fails the calls that reach it,
+// also in parallel searches and matches and in background merges
+void CheckRecordsReadOnUse() {
+    WriteDamaged([](std::string& file, IndexFileHeader& header) {
+        GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0].offset = 1 << 30;
+    });
+    SearchServer postings_damaged = SearchServer::Open(DAMAGED_PATH);
+    postings_damaged.EnableBooleanQueries();
+    Check(postings_damaged.FindTopDocuments("dog"s).size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT),
+          "the other posting lists are read"s);
+    Check(IsRejected([&] {
+        postings_damaged.FindTopDocuments(std::execution::par, "cat"s);
+    }), "a parallel search has to reject the damaged postings"s);
+    std::vector<int> ids(DOCUMENT_COUNT);
+    std::iota(ids.begin(), ids.end(), 0);
+    Check(IsRejected([&] {
+        postings_damaged.MatchDocuments(std::execution::par, "cat AND dog"s, ids);
+    }), "a parallel match has to reject the damaged postings"s);
+
+    WriteDamaged([](std::string& file, IndexFileHeader& header) {
+        uint32_t* slots = GetRecords<uint32_t>(file, header.term_slots);
+        for (uint64_t i = 0; i < header.term_slots.count; ++i) {
+            slots[i] = 0;
+        }
+    });
+    const SearchServer slots_damaged = SearchServer::Open(DAMAGED_PATH);
+    Check(slots_damaged.FindTopDocuments("missing"s).empty(), "a term table without empty slots is probed once"s);
+
+    WriteDamaged([](std::string& file, IndexFileHeader& header) {
+        GetRecords<int>(file, GetFirstSegment(file, header).term_freqs)[0] = 1 << 30;
+    });
+    SearchServer document_damaged = SearchServer::Open(DAMAGED_PATH);
+    for (int id = 1; id < DOCUMENT_COUNT * 2 / 3; ++id) {
+        document_damaged.RemoveDocument(id);
+    }
+    // the merge of the segment reaches document 0 and gives up
+    document_damaged.WaitForMerges();
+    Check(IsRejected([&] {
+        document_damaged.GetWordFrequencies(0);
+    }), "the damaged document has to be rejected"s);
+    Check(document_damaged.FindTopDocuments("dog"s, DocumentStatus::ACTUAL, 1000).size()
+          == static_cast<size_t>(DOCUMENT_COUNT - DOCUMENT_COUNT * 2 / 3 + 1), "the unmerged segment is searched"s);
+}
+
+void CheckDocuments(SearchServer& search_server, const std::map<int, size_t>& expected, const std::string& name) {
+    search_server.Verify();
+    std::vector<int> expected_ids;
+    for (const auto& [id, word_count] : expected) {
+        expected_ids.push_back(id);
+        Check(search_server.GetWordFrequencies(id).size() == word_count, name + ": words of document "s
+              + std::to_string(id));
+    }
+    Check(std::vector<int>(search_server.begin(), search_server.end()) == expected_ids, name + ": ids"s);
+    Check(search_server.GetDocumentCount() == static_cast<int>(expected.size()), name + ": document count"s);
+}
+
+// Documents added and removed after Open are merged with the saved ones,
+// also once a merge has moved the saved documents
+void CheckOpenedChanges() {
+    SearchServer search_server = SearchServer::Open(INDEX_PATH);
+    std::map<int, size_t> expected;
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        expected[id] = 4;
+    }
+    for (const int id : {0, 5, 7, DOCUMENT_COUNT - 1}) {
+        search_server.RemoveDocument(id);
+        expected.erase(id);
+    }
+    search_server.AddDocument(5, "parrot"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(DOCUMENT_COUNT + 10, "parrot starling"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(DOCUMENT_COUNT + 3, "parrot"s, DocumentStatus::ACTUAL, {1});
+    expected[5] = 1;
+    expected[DOCUMENT_COUNT + 10] = 2;
+    expected[DOCUMENT_COUNT + 3] = 1;
+    CheckDocuments(search_server, expected, "changes after Open"s);
+    Check(search_server.GetWordFrequencies(7).empty(), "a removed saved document has no words"s);
+    Check(search_server.FindTopDocuments("parrot"s).size() == 3, "the added documents are found"s);
+
+    // a segment with most of its documents removed is merged alone
+    for (int id = 10; id < DOCUMENT_COUNT * 2 / 3; ++id) {
+        search_server.RemoveDocument(id);
+        expected.erase(id);
+    }
+    search_server.WaitForMerges();
+    CheckDocuments(search_server, expected, "merged after Open"s);
+    Check(search_server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 1000).size() == expected.size() - 3,
+          "the merged documents are found"s);
+}
+
+}  // namespace
+
+int main() {
+    {
+        SearchServer search_server("and in"s);
+        for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+            search_server.AddDocument(id, "cat and dog number "s + std::to_string(id % 7), DocumentStatus::ACTUAL, {1});
+        }
+        search_server.Save(INDEX_PATH);
+    }
+    const size_t found_count = SearchServer::Open(INDEX_PATH).FindTopDocuments("cat"s).size();
+    Check(found_count == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT), "the saved index opens"s);
+    SearchServer::Open(INDEX_PATH).Verify();
+    CheckOpenedChanges();
+    CheckDamagedLocation();
+    CheckRecordsReadOnUse();
+
+    CheckDamaged("a location in a missing segment"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<IndexFileLocation>(file, header.locations)[0].segment = 1000;
+    });
+    CheckDamaged("a location past the slots"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<IndexFileLocation>(file, header.locations)[0].slot = 1000;
+    });
+    CheckDamaged("unsorted locations"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<IndexFileLocation>(file, header.locations)[1].document_id = -1;
+    });
+    CheckDamaged("a duplicate location"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<IndexFileLocation>(file, header.locations)[1].document_id = 0;
+    });
+    CheckDamaged("a term slot past the terms"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<uint32_t>(file, header.term_slots)[0] = static_cast<uint32_t>(header.term_offsets.count);
+    });
+    CheckDamaged("a term table without empty slots"s, [](std::string& file, IndexFileHeader& header) {
+        uint32_t* slots = GetRecords<uint32_t>(file, header.term_slots);
+        for (uint64_t i = 0; i < header.term_slots.count; ++i) {
+            slots[i] = 0;
+        }
+    });
+    CheckDamaged("unsorted term offsets"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<uint64_t>(file, header.term_offsets)[1] = header.term_chars.count;
+    });
+    CheckDamaged("a posting list of a missing term"s, [](std::string& file, IndexFileHeader& header) {
+        const SegmentFileHeader& segment = GetFirstSegment(file, header);
+        GetRecords<int>(file, segment.term_ids)[segment.term_ids.count - 1] = 1 << 30;
+    });
+    CheckDamaged("a document term past the terms"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<int>(file, GetFirstSegment(file, header).term_freqs)[0] = 1 << 30;
+    });
+    CheckDamaged("a posting block past the bytes"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0].offset = 1 << 30;
+    });
+    CheckDamaged("a posting block past the slots"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0].last_slot = 1 << 30;
+    });
+    CheckDamaged("an oversized posting block"s, [](std::string& file, IndexFileHeader& header) {
+        GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0].size = 1000;
+    });
+    CheckDamaged("a posting list past the blocks"s, [](std::string& file, IndexFileHeader& header) {
+        const SegmentFileHeader& segment = GetFirstSegment(file, header);
+        GetRecords<uint32_t>(file, segment.term_postings)[2] = 1 << 30;
+    });
+
+    CheckDamagedPostings("a posting block with its values past the bytes"s,
+        [](std::string& file, IndexFileHeader& header) {
+            const SegmentFileHeader& segment = GetFirstSegment(file, header);
+            PostingBlock& block = GetRecords<PostingBlock>(file, segment.blocks)[0];
+            // the control bytes still fit
+            block.offset = static_cast<uint32_t>(segment.bytes.count - (block.size + 3) / 4);
+        });
+    CheckDamagedPostings("a posting block with its count past the bytes"s,
+        [](std::string& file, IndexFileHeader& header) {
+            const SegmentFileHeader& segment = GetFirstSegment(file, header);
+            PostingBlock& block = GetRecords<PostingBlock>(file, segment.blocks)[0];
+            // one posting has no slot gaps, only the control byte of its count fits
+            GetRecords<Segment::TermPostings>(file, segment.term_postings)[0].size -= block.size - 1;
+            block.size = 1;
+            block.last_slot = block.first_slot;
+            block.offset = static_cast<uint32_t>(segment.bytes.count - 1);
+        });
+    CheckDamagedPostings("a posting block with slots past its last one"s,
+        [](std::string& file, IndexFileHeader& header) {
+            PostingBlock& block = GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0];
+            block.first_slot = block.last_slot;
+        });
+    CheckDamagedPostings("a posting block past the slots of an int"s, [](std::string& file, IndexFileHeader& header) {
+        PostingBlock& block = GetRecords<PostingBlock>(file, GetFirstSegment(file, header).blocks)[0];
+        block.first_slot += 1u << 31;
+        block.last_slot += 1u << 31;
+    });
+
+    std::remove(INDEX_PATH.c_str());
+    std::remove(DAMAGED_PATH.c_str());
+    return FinishChecks();
+}
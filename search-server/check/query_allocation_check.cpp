@@ -0,0 +1,95 @@
+// Checks that parsing a plain query of 3 to 10 words makes no heap
+// allocations once the query buffer of the thread is warm. Every
+// operator new is counted. Run it without arguments, it exits with 1 if
+// a check fails.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../plain_query.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+size_t allocation_count = 0;
+
+void* Allocate(size_t size) {
+    ++allocation_count;
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+// Queries of 3 to 10 words with stop words, minus words and repeats
+std::vector<std::string> MakeQueries(const std::vector<std::string>& words) {
+    std::vector<std::string> queries;
+    size_t next_word = 0;
+    for (size_t word_count = 3; word_count <= 10; ++word_count) {
+        for (int variant = 0; variant < 4; ++variant) {
+            std::string query;
+            for (size_t i = 0; i < word_count; ++i) {
+                const bool is_minus = i > 0 && (i + variant) % 4 == 0;
+                query += (i > 0 ? " "s : ""s) + (is_minus ? "-"s : ""s) + words[next_word++ % words.size()];
+            }
+            queries.push_back(query);
+        }
+    }
+    return queries;
+}
+
+void CheckParsing(const Tokenizer& tokenizer, const std::string& name, const std::vector<std::string>& words) {
+    const FlatStringSet stop_words(std::vector<std::string>{"and"s, "in"s, "with"s});
+    const std::vector<std::string> queries = MakeQueries(words);
+    PlainQuery query;
+    // the buffers grow to the longest query once
+    ParsePlainQuery(queries.back(), stop_words, tokenizer, query);
+    for (const std::string& text : queries) {
+        const size_t count_before = allocation_count;
+        ParsePlainQuery(text, stop_words, tokenizer, query);
+        const size_t allocations = allocation_count - count_before;
+        Check(allocations == 0, name + ": "s + std::to_string(allocations) + " allocations parsing \""s + text + "\""s);
+        Check(!query.plus_words.empty(), name + ": no plus words in \""s + text + "\""s);
+    }
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+int main() {
+    const std::vector<std::string> words = {"curly"s, "cat"s, "and"s, "fluffy"s, "dog"s, "with"s, "collar"s,
+                                            "in"s, "the"s, "city"s, "cat"s, "groomed"s, "starling"s};
+    CheckParsing(Tokenizer(), "default tokenizer"s, words);
+    const std::vector<std::string> text_words = {"Curly,"s, "cat"s, "AND"s, "fluffy"s, "dog."s, "With"s, "collar"s,
+                                                 "in"s, "the"s, "City!"s, "cat"s, "groomed"s, "starling"s};
+    CheckParsing(Tokenizer::MakeTextTokenizer(), "text tokenizer"s, text_words);
+    return FinishChecks();
+}
@@ -0,0 +1,207 @@
+// Checks of ProcessQueriesStream: results come out in the order of the
+// queries for any number of threads and batch size, a small window of
+// pending queries holds back the input, and an exception thrown by a
+// search, by the consumer or by the input stops the stream and is
+// rethrown. Run it without arguments, it exits with 1 if a check fails.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../process_queries.h"
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+struct ConsumerError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+const std::vector<std::string> WORDS = {"cat"s, "dog"s, "parrot"s, "curly"s, "fluffy"s, "tail"s, "collar"s,
+                                        "black"s, "white"s, "eyes"s};
+
+void AddDocuments(SearchServer& search_server) {
+    for (int id = 0; id < 400; ++id) {
+        std::string text;
+        for (size_t i = 0; i < 4; ++i) {
+            text += WORDS[(id * 7 + i * 3 + id / 11) % WORDS.size()] + " "s;
+        }
+        search_server.AddDocument(id, text + "with word"s + std::to_string(id % 23), DocumentStatus::ACTUAL, {id % 9});
+    }
+}
+
+// Queries of one to many words, so that some take much longer than others
+std::vector<std::string> MakeQueries(size_t count) {
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < count; ++i) {
+        std::string query = "word"s + std::to_string(i % 29);
+        for (size_t j = 0; j < i % 7; ++j) {
+            query += " "s + WORDS[(i + j) % WORDS.size()];
+        }
+        if (i % 5 == 0) {
+            query += " -"s + WORDS[i % WORDS.size()];
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+bool IsSameResults(const std::vector<Document>& left, const std::vector<Document>& right) {
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); ++i) {
+        if (left[i].id != right[i].id || left[i].relevance != right[i].relevance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CheckOrder(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    const std::vector<std::vector<Document>> expected = ProcessQueries(search_server, queries);
+    for (const size_t thread_count : {1, 2, 3, 8}) {
+        for (const size_t batch_size : {1, 5, 64}) {
+            const std::string hint = "threads "s + std::to_string(thread_count) + ", batch "s
+                                     + std::to_string(batch_size);
+            QueryStreamOptions options;
+            options.thread_count = thread_count;
+            options.batch_size = batch_size;
+            size_t consumed_count = 0;
+            ProcessQueriesStream(search_server, queries.begin(), queries.end(),
+                                 [&](const std::string& query, std::vector<Document> documents) {
+                Check(consumed_count < queries.size() && query == queries[consumed_count], hint + ": query order"s);
+                Check(consumed_count < queries.size() && IsSameResults(documents, expected[consumed_count]),
+                      hint + ": results of "s + query);
+                ++consumed_count;
+            }, options);
+            Check(consumed_count == queries.size(), hint + ": every query is consumed"s);
+        }
+    }
+
+    // one query per line, the empty input gives nothing
+    std::stringstream input;
+    for (const std::string& query : queries) {
+        input << query << '\n';
+    }
+    size_t consumed_count = 0;
+    ProcessQueriesStream(search_server, input, [&](const std::string& query, std::vector<Document>) {
+        Check(consumed_count < queries.size() && query == queries[consumed_count], "istream: query order"s);
+        ++consumed_count;
+    });
+    Check(consumed_count == queries.size(), "istream: every query is consumed"s);
+    std::istringstream empty_input;
+    ProcessQueriesStream(search_server, empty_input, [&](const std::string&, std::vector<Document>) {
+        Check(false, "empty input: nothing is consumed"s);
+    });
+}
+
+// The stream reads a query only while fewer than max_pending_queries are
+// read and not consumed, besides the one being consumed
+void CheckWindow(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    for (const size_t window : {1, 2, 3, 10}) {
+        const std::string hint = "window "s + std::to_string(window);
+        QueryStreamOptions options;
+        options.thread_count = 4;
+        options.batch_size = 4;
+        options.max_pending_queries = window;
+        // written by the workers, read by the consumer
+        std::atomic<size_t> read_count{0};
+        size_t consumed_count = 0;
+        size_t max_ahead = 0;
+        ProcessQueriesStream(search_server, [&](std::string& query) {
+            if (read_count == queries.size()) {
+                return false;
+            }
+            query = queries[read_count++];
+            return true;
+        }, [&](const std::string& query, std::vector<Document>) {
+            Check(query == queries[consumed_count], hint + ": query order"s);
+            max_ahead = std::max(max_ahead, read_count - consumed_count);
+            ++consumed_count;
+        }, options);
+        Check(consumed_count == queries.size(), hint + ": every query is consumed"s);
+        Check(max_ahead <= window + 1, hint + ": "s + std::to_string(max_ahead) + " queries read ahead"s);
+    }
+}
+
+void CheckErrors(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    // a search throws on the query with an empty minus word
+    const size_t bad_index = queries.size() / 2;
+    std::vector<std::string> bad_queries = queries;
+    bad_queries[bad_index] = "cat -"s;
+    for (const size_t window : {1, 16, 4096}) {
+        const std::string hint = "window "s + std::to_string(window);
+        QueryStreamOptions options;
+        options.thread_count = 3;
+        options.max_pending_queries = window;
+        size_t consumed_count = 0;
+        bool is_thrown = false;
+        try {
+            ProcessQueriesStream(search_server, bad_queries.begin(), bad_queries.end(),
+                                 [&](const std::string& query, std::vector<Document>) {
+                Check(consumed_count < bad_index && query == bad_queries[consumed_count],
+                      hint + ": only queries before the failed one are consumed"s);
+                ++consumed_count;
+            }, options);
+        } catch (const std::invalid_argument&) {
+            is_thrown = true;
+        }
+        Check(is_thrown, hint + ": the search exception is rethrown"s);
+
+        // the consumer throws on its tenth query
+        consumed_count = 0;
+        is_thrown = false;
+        try {
+            ProcessQueriesStream(search_server, queries.begin(), queries.end(),
+                                 [&](const std::string&, std::vector<Document>) {
+                if (++consumed_count == 10) {
+                    throw ConsumerError("stop"s);
+                }
+            }, options);
+        } catch (const ConsumerError&) {
+            is_thrown = true;
+        }
+        Check(is_thrown, hint + ": the consumer exception is rethrown"s);
+        Check(consumed_count == 10, hint + ": nothing is consumed after the consumer throws"s);
+
+        // the input throws after a few queries
+        size_t read_count = 0;
+        consumed_count = 0;
+        is_thrown = false;
+        try {
+            ProcessQueriesStream(search_server, [&](std::string& query) {
+                if (read_count == 20) {
+                    throw ConsumerError("input"s);
+                }
+                query = queries[read_count++];
+                return true;
+            }, [&](const std::string&, std::vector<Document>) {
+                ++consumed_count;
+            }, options);
+        } catch (const ConsumerError&) {
+            is_thrown = true;
+        }
+        Check(is_thrown, hint + ": the input exception is rethrown"s);
+        Check(consumed_count <= 20, hint + ": no more is consumed than was read"s);
+    }
+}
+
+}  // namespace
+
+int main() {
+    SearchServer search_server("and with"s);
+    AddDocuments(search_server);
+    const std::vector<std::string> queries = MakeQueries(500);
+    CheckOrder(search_server, queries);
+    CheckWindow(search_server, queries);
+    CheckErrors(search_server, queries);
+    return FinishChecks();
+}
@@ -0,0 +1,242 @@
+// Checks of RequestStats with an injected clock: slots roll over after a
+// second and after a minute, records older than the rings are dropped, the
+// 1, 5 and 1440 minute windows count what they cover, result counts and
+// latencies land in the right buckets, and records from many threads add
+// up. RequestQueue is checked to record its searches. Run it without
+// arguments, it exits with 1 if a check fails.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../request_queue.h"
+#include "../request_stats.h"
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = RequestStats::Clock;
+
+// far from the epoch of the clock, so that times before it are valid too
+const Clock::time_point START = Clock::time_point{} + 1000h;
+
+uint64_t CountRequests(const RequestStats& stats, std::chrono::minutes window, Clock::time_point now) {
+    return stats.GetWindowStats(window, now).request_count;
+}
+
+void CheckSecondRollover() {
+    RequestStats stats(START);
+    stats.Record(1, 1ms, START + 500ms);
+    stats.Record(1, 1ms, START + 1500ms);
+    Check(CountRequests(stats, 1min, START + 1500ms) == 2, "both seconds are in the minute"s);
+
+    // period 300 reuses the slot of period 0, which leaves the 5 minute window
+    stats.Record(1, 1ms, START + 300500ms);
+    Check(CountRequests(stats, 5min, START + 300500ms) == 2, "second slot reused after 5 minutes"s);
+    Check(CountRequests(stats, 1min, START + 300500ms) == 1, "1 minute window after 5 minutes"s);
+    // the minute ring still has all three
+    Check(CountRequests(stats, 10min, START + 300500ms) == 3, "minute ring keeps the first second"s);
+}
+
+void CheckMinuteRollover() {
+    RequestStats stats(START);
+    stats.Record(1, 1ms, START + 30s);
+    stats.Record(1, 1ms, START + 90s);
+    Check(CountRequests(stats, 6min, START + 90s) == 2, "both minutes are in the window"s);
+    Check(CountRequests(stats, 6min, START + 6min + 10s) == 1, "the first minute leaves a 6 minute window"s);
+
+    // period 1440 reuses the slot of period 0
+    stats.Record(1, 1ms, START + 1440min + 10s);
+    Check(CountRequests(stats, 1440min, START + 1440min + 10s) == 2, "minute slot reused after a day"s);
+}
+
+void CheckOldRecordsDropped() {
+    RequestStats stats(START);
+    // the slot of period 0 holds period 300 in the seconds ring and 1440 in
+    // the minutes ring
+    stats.Record(1, 1ms, START + 1440min + 300s);
+    stats.Record(1, 1ms, START + 1440min);
+    const Clock::time_point now = START + 1440min + 300s;
+    Check(CountRequests(stats, 1440min, now) == 2, "records of the last day"s);
+
+    stats.Record(1, 1ms, START + 100ms);
+    stats.Record(1, 1ms, START + 30s);
+    Check(CountRequests(stats, 1440min, now) == 2, "records older than the minute ring are dropped"s);
+    Check(CountRequests(stats, 5min, now) == 1, "records older than the second ring are dropped"s);
+
+    // a time before the start counts as the start
+    RequestStats early_stats(START);
+    early_stats.Record(1, 1ms, START - 10s);
+    Check(CountRequests(early_stats, 1min, START) == 1, "a record before the start"s);
+}
+
+void CheckWindows() {
+    RequestStats stats(START);
+    const Clock::time_point now = START + 1440min - 1s;
+    for (const Clock::duration age : {Clock::duration(10s), Clock::duration(3min), Clock::duration(30min),
+                                      Clock::duration(1000min), Clock::duration(1439min)}) {
+        stats.Record(age > 100min ? 0 : 3, 1ms, now - age);
+    }
+    const RequestStats::WindowStats minute = stats.GetWindowStats(1min, now);
+    const RequestStats::WindowStats five_minutes = stats.GetWindowStats(5min, now);
+    const RequestStats::WindowStats day = stats.GetWindowStats(1440min, now);
+    Check(minute.request_count == 1, "1 minute window"s);
+    Check(five_minutes.request_count == 2, "5 minute window"s);
+    Check(day.request_count == 5, "1440 minute window"s);
+    Check(minute.window == 1min && day.window == 1440min, "window of the stats"s);
+    Check(std::abs(minute.queries_per_second - 1.0 / 60) < 1e-9, "requests per second of a minute"s);
+    Check(std::abs(day.queries_per_second - 5.0 / 86400) < 1e-9, "requests per second of a day"s);
+    Check(day.no_result_count == 2 && std::abs(day.no_result_rate - 0.4) < 1e-9, "no result rate of a day"s);
+    Check(minute.no_result_count == 0 && minute.no_result_rate == 0.0, "no result rate of a minute"s);
+
+    // shortly after the start only the time since the start is covered
+    RequestStats young_stats(START);
+    young_stats.Record(1, 1ms, START + 1s);
+    young_stats.Record(1, 1ms, START + 2s);
+    Check(std::abs(young_stats.GetWindowStats(5min, START + 4s).queries_per_second - 0.5) < 1e-9,
+          "requests per second since the start"s);
+
+    for (const std::chrono::minutes window : {0min, -1min, 1441min}) {
+        bool is_thrown = false;
+        try {
+            stats.GetWindowStats(window, now);
+        } catch (const std::invalid_argument&) {
+            is_thrown = true;
+        }
+        Check(is_thrown, "window of "s + std::to_string(window.count()) + " minutes is rejected"s);
+    }
+}
+
+void CheckResultCountBuckets() {
+    Check(RequestStats::GetResultCountBucket(0) == 0, "bucket of 0"s);
+    Check(RequestStats::GetResultCountBucket(7) == 7, "bucket of 7"s);
+    Check(RequestStats::GetResultCountBucket(8) == 8, "bucket of 8"s);
+    Check(RequestStats::GetResultCountBucket(15) == 8, "bucket of 15"s);
+    Check(RequestStats::GetResultCountBucket(16) == 9, "bucket of 16"s);
+    Check(RequestStats::GetResultCountBucket(size_t{1} << 40) == RequestStats::RESULT_COUNT_BUCKET_COUNT - 1,
+          "bucket of a huge count"s);
+    Check(RequestStats::GetResultCountLowerBound(7) == 7, "lower bound of bucket 7"s);
+    Check(RequestStats::GetResultCountLowerBound(8) == 8, "lower bound of bucket 8"s);
+    Check(RequestStats::GetResultCountLowerBound(9) == 16, "lower bound of bucket 9"s);
+    for (size_t bucket = 1; bucket < RequestStats::RESULT_COUNT_BUCKET_COUNT; ++bucket) {
+        const size_t lower_bound = RequestStats::GetResultCountLowerBound(bucket);
+        Check(RequestStats::GetResultCountBucket(lower_bound) == bucket
+              && RequestStats::GetResultCountBucket(lower_bound - 1) == bucket - 1,
+              "edges of bucket "s + std::to_string(bucket));
+    }
+
+    RequestStats stats(START);
+    for (const size_t result_count : {0, 7, 8, 15, 16}) {
+        stats.Record(result_count, 1ms, START + 1s);
+    }
+    const RequestStats::WindowStats window_stats = stats.GetWindowStats(1min, START + 1s);
+    Check(window_stats.result_counts[0] == 1 && window_stats.result_counts[7] == 1
+          && window_stats.result_counts[8] == 2 && window_stats.result_counts[9] == 1,
+          "recorded result counts"s);
+}
+
+// Quantiles are the middle of a bucket a quarter of a power of two wide
+void CheckLatencyQuantiles() {
+    RequestStats stats(START);
+    const RequestStats::WindowStats empty = stats.GetWindowStats(1min, START + 1s);
+    Check(empty.latency_p50.count() == 0 && empty.latency_p99.count() == 0, "no latency without requests"s);
+
+    for (int microseconds = 1; microseconds <= 1000; ++microseconds) {
+        stats.Record(1, std::chrono::microseconds(microseconds), START + 1s);
+    }
+    const RequestStats::WindowStats window_stats = stats.GetWindowStats(1min, START + 1s);
+    const auto is_near = [](std::chrono::nanoseconds value, std::chrono::nanoseconds expected) {
+        return std::abs(static_cast<double>(value.count()) / expected.count() - 1.0) <= 0.19;
+    };
+    Check(is_near(window_stats.latency_p50, 500us), "p50 latency"s);
+    Check(is_near(window_stats.latency_p90, 900us), "p90 latency"s);
+    Check(is_near(window_stats.latency_p99, 990us), "p99 latency"s);
+    Check(window_stats.latency_p50 <= window_stats.latency_p90 && window_stats.latency_p90 <= window_stats.latency_p99,
+          "latency quantiles are ordered"s);
+
+    // a negative latency counts as zero
+    RequestStats zero_stats(START);
+    zero_stats.Record(1, -5ms, START + 1s);
+    Check(zero_stats.GetWindowStats(1min, START + 1s).latency_p99.count() == 0, "negative latency"s);
+}
+
+// Every thread records over 200 seconds, so slots are claimed and cleared
+// while other threads add to them and a reader sums them
+void CheckConcurrentRecords() {
+    const int thread_count = 8;
+    const int records_per_thread = 20000;
+    const Clock::duration step = 200s / records_per_thread;
+    RequestStats stats(START);
+    std::atomic<int> writer_count{thread_count};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < thread_count; ++t) {
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < records_per_thread; ++i) {
+                stats.Record(static_cast<size_t>((i + t) % 20), std::chrono::microseconds(1 + i % 100),
+                             START + step * i);
+            }
+            --writer_count;
+        });
+    }
+    const uint64_t total = uint64_t{thread_count} * records_per_thread;
+    std::thread reader([&] {
+        while (writer_count > 0) {
+            const RequestStats::WindowStats window_stats = stats.GetWindowStats(5min, START + 200s);
+            Check(window_stats.request_count <= total, "requests seen while recording"s);
+        }
+    });
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    reader.join();
+
+    for (const std::chrono::minutes window : {5min, 10min}) {
+        const RequestStats::WindowStats window_stats = stats.GetWindowStats(window, START + 200s);
+        uint64_t bucket_total = 0;
+        for (const uint64_t count : window_stats.result_counts) {
+            bucket_total += count;
+        }
+        const std::string hint = std::to_string(window.count()) + " minute window"s;
+        Check(window_stats.request_count == total, hint + ": every record is counted"s);
+        Check(bucket_total == total, hint + ": every result count is counted"s);
+        Check(window_stats.no_result_count == total / 20, hint + ": requests without results"s);
+    }
+}
+
+void CheckRequestQueue() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "curly cat with tail"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy dog"s, DocumentStatus::ACTUAL, {2});
+    RequestQueue request_queue(search_server);
+    Check(request_queue.AddFindRequest("cat"s).size() == 1, "queue finds documents"s);
+    request_queue.AddFindRequest("parrot"s);
+    request_queue.AddFindRequest("dog"s, DocumentStatus::BANNED);
+    request_queue.ProcessQueries({"cat dog"s, "parrot"s});
+    Check(request_queue.GetNoResultRequests() == 3, "queue requests without results"s);
+    const RequestStats::WindowStats window_stats = request_queue.GetStats(1min);
+    Check(window_stats.request_count == 5, "queue records every request"s);
+    Check(window_stats.result_counts[2] == 1, "queue records result counts"s);
+}
+
+}  // namespace
+
+int main() {
+    CheckSecondRollover();
+    CheckMinuteRollover();
+    CheckOldRecordsDropped();
+    CheckWindows();
+    CheckResultCountBuckets();
+    CheckLatencyQuantiles();
+    CheckConcurrentRecords();
+    CheckRequestQueue();
+    return FinishChecks();
+}
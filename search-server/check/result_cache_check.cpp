@@ -0,0 +1,130 @@
+// Checks that cached search results go stale with the index: after
+// AddDocument, AddDocuments and RemoveDocument the next search misses the
+// cache and returns what a server without a cache returns, which differs
+// from the answer cached before. Run it without arguments, it exits with
+// 1 if a check fails.
+
+#include <cmath>
+#include <cstddef>
+#include <execution>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::vector<std::string> QUERIES = {"cat"s, "cat -collar"s, "dog parrot"s};
+
+bool IsSame(const std::vector<Document>& lhs, const std::vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].id != rhs[i].id || lhs[i].rating != rhs[i].rating
+            || std::abs(lhs[i].relevance - rhs[i].relevance) >= EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A server with the cache on and one without, changed the same way
+struct Servers {
+    SearchServer cached{"and with"s};
+    SearchServer uncached{"and with"s};
+
+    Servers() {
+        cached.SetResultCacheLimit(1 << 20);
+    }
+
+    void Change(const std::function<void(SearchServer&)>& change) {
+        change(cached);
+        change(uncached);
+    }
+};
+
+template <typename ExecutionPolicy>
+std::vector<Document> Search(const SearchServer& search_server, ExecutionPolicy policy, const std::string& query) {
+    return search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+}
+
+// Searches every query three times: the first search misses, the second
+// one and a search under the other policy hit the entry it left, and all
+// of them equal the uncached answer
+std::vector<std::vector<Document>> CheckSearches(const Servers& servers, const std::string& name) {
+    std::vector<std::vector<Document>> answers;
+    for (const std::string& query : QUERIES) {
+        const std::string hint = name + ", \""s + query + "\""s;
+        const std::vector<Document> expected = Search(servers.uncached, std::execution::seq, query);
+        const ResultCacheStats before = servers.cached.GetResultCacheStats();
+        const std::vector<Document> first = Search(servers.cached, std::execution::seq, query);
+        const ResultCacheStats between = servers.cached.GetResultCacheStats();
+        const std::vector<Document> second = Search(servers.cached, std::execution::seq, query);
+        const std::vector<Document> parallel = Search(servers.cached, std::execution::par, query);
+        const ResultCacheStats after = servers.cached.GetResultCacheStats();
+        Check(between.misses == before.misses + 1 && between.hits == before.hits,
+              hint + ": the first search misses"s);
+        Check(after.hits == between.hits + 2 && after.misses == between.misses, hint + ": the next searches hit"s);
+        Check(IsSame(first, expected), hint + ": the first answer is stale"s);
+        Check(IsSame(second, expected), hint + ": the cached answer differs"s);
+        Check(IsSame(parallel, expected), hint + ": the cached answer differs under par"s);
+        answers.push_back(first);
+    }
+    return answers;
+}
+
+// The answers to at least one query have to change, or the check would
+// pass with a cache that is never invalidated
+void CheckChanged(const std::vector<std::vector<Document>>& before, const std::vector<std::vector<Document>>& after,
+                  const std::string& name) {
+    bool is_changed = false;
+    for (size_t i = 0; i < before.size(); ++i) {
+        is_changed = is_changed || !IsSame(before[i], after[i]);
+    }
+    Check(is_changed, name + ": the answers did not change"s);
+}
+
+}  // namespace
+
+int main() {
+    Servers servers;
+    servers.Change([](SearchServer& search_server) {
+        search_server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    });
+    std::vector<std::vector<Document>> answers = CheckSearches(servers, "initial"s);
+
+    const auto check_change = [&](const std::string& name, const std::function<void(SearchServer&)>& change) {
+        servers.Change(change);
+        std::vector<std::vector<Document>> new_answers = CheckSearches(servers, name);
+        CheckChanged(answers, new_answers, name);
+        answers = std::move(new_answers);
+    };
+    check_change("AddDocument"s, [](SearchServer& search_server) {
+        search_server.AddDocument(4, "cat cat parrot"s, DocumentStatus::ACTUAL, {1});
+    });
+    // a document without the query words still changes their IDF
+    check_change("AddDocument of other words"s, [](SearchServer& search_server) {
+        search_server.AddDocument(5, "starling in the city"s, DocumentStatus::ACTUAL, {2});
+    });
+    check_change("AddDocuments"s, [](SearchServer& search_server) {
+        search_server.AddDocuments({{6, "dog and parrot"s, DocumentStatus::ACTUAL, {3}},
+                                    {7, "black cat"s, DocumentStatus::ACTUAL, {4}}});
+    });
+    check_change("AddDocuments in parallel"s, [](SearchServer& search_server) {
+        search_server.AddDocuments(std::execution::par, {{8, "parrot parrot"s, DocumentStatus::ACTUAL, {9}}});
+    });
+    check_change("RemoveDocument"s, [](SearchServer& search_server) {
+        search_server.RemoveDocument(4);
+    });
+    check_change("RemoveDocument in parallel"s, [](SearchServer& search_server) {
+        search_server.RemoveDocument(std::execution::par, 2);
+    });
+    return FinishChecks();
+}
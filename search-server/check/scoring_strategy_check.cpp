@@ -0,0 +1,110 @@
+// Checks that MaxScore pruning returns what term at a time scoring does:
+// both strategies are forced on the same queries of one to six words,
+// with minus words, over documents in sealed segments and the open one,
+// for tops much smaller than the matches, by status and by predicate,
+// under both policies. Ids have to be equal and in the same order, and
+// relevances equal within EPSILON. Run it without arguments, it exits
+// with 1 if a check fails.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const int DOCUMENT_COUNT = 3 * SEGMENT_DOCUMENT_COUNT + 500;
+const int VOCABULARY_SIZE = 300;
+
+// Word ranks are skewed towards the first ones, so a few words have long
+// posting lists and many have short ones
+std::string DrawWord(std::mt19937_64& generator) {
+    const double share = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+    return "w"s + std::to_string(static_cast<int>(VOCABULARY_SIZE * share * share * share));
+}
+
+void AddDocuments(SearchServer& search_server, std::mt19937_64& generator) {
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        std::string text;
+        const int word_count = 3 + static_cast<int>(generator() % 30);
+        for (int i = 0; i < word_count; ++i) {
+            text += DrawWord(generator) + " "s;
+        }
+        const auto status = static_cast<DocumentStatus>(generator() % 4 == 0 ? generator() % 4 : 0);
+        search_server.AddDocument(id, text, status, {static_cast<int>(generator() % 21) - 10});
+    }
+}
+
+std::vector<std::string> MakeQueries(std::mt19937_64& generator) {
+    std::vector<std::string> queries;
+    for (int i = 0; i < 200; ++i) {
+        std::string query;
+        const int word_count = 1 + static_cast<int>(generator() % 6);
+        for (int j = 0; j < word_count; ++j) {
+            query += (generator() % 8 == 0 ? "-"s : ""s) + DrawWord(generator) + " "s;
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+void CheckSame(const std::vector<Document>& pruned, const std::vector<Document>& scored, const std::string& hint) {
+    bool is_same = pruned.size() == scored.size();
+    for (size_t i = 0; is_same && i < pruned.size(); ++i) {
+        is_same = pruned[i].id == scored[i].id && std::abs(pruned[i].relevance - scored[i].relevance) < EPSILON;
+    }
+    Check(is_same, hint);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> FindTop(SearchServer& search_server, ScoringStrategy strategy, ExecutionPolicy policy,
+                              const std::string& query, size_t top_k, bool is_by_predicate) {
+    search_server.SetScoringStrategy(strategy);
+    if (is_by_predicate) {
+        return search_server.FindTopDocuments(policy, query, [](int document_id, DocumentStatus, int rating) {
+            return document_id % 3 != 0 && rating > -5;
+        }, top_k);
+    }
+    return search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL, top_k);
+}
+
+template <typename ExecutionPolicy>
+void CheckStrategies(SearchServer& search_server, ExecutionPolicy policy, const std::string& name,
+                     const std::vector<std::string>& queries) {
+    for (const std::string& query : queries) {
+        for (const size_t top_k : {1, 5, 20}) {
+            for (const bool is_by_predicate : {false, true}) {
+                const std::vector<Document> pruned = FindTop(search_server, ScoringStrategy::MAX_SCORE, policy, query,
+                                                             top_k, is_by_predicate);
+                const std::vector<Document> scored = FindTop(search_server, ScoringStrategy::TERM_AT_A_TIME, policy,
+                                                             query, top_k, is_by_predicate);
+                const std::vector<Document> chosen = FindTop(search_server, ScoringStrategy::AUTO, policy, query,
+                                                             top_k, is_by_predicate);
+                const std::string hint = name + ", \""s + query + "\", top "s + std::to_string(top_k)
+                                         + (is_by_predicate ? " by predicate"s : " by status"s);
+                CheckSame(pruned, scored, hint + ": MaxScore differs from term at a time"s);
+                CheckSame(chosen, scored, hint + ": the chosen strategy differs from term at a time"s);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 generator(42);
+    SearchServer search_server("w1"s);
+    AddDocuments(search_server, generator);
+    const std::vector<std::string> queries = MakeQueries(generator);
+    CheckStrategies(search_server, std::execution::seq, "seq"s, queries);
+    CheckStrategies(search_server, std::execution::par, "par"s, queries);
+    return FinishChecks();
+}
@@ -0,0 +1,168 @@
+// Checks of segment merges: more documents than SEGMENT_MERGE_FACTOR
+// segments hold are added and some are removed, then the searches, the
+// document count and GetWordFrequencies are compared with a brute force
+// ranking of the texts before and after the background merges. Run it
+// without arguments, it exits with 1 if a check fails.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "../string_processing.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const int DOCUMENT_COUNT = SEGMENT_DOCUMENT_COUNT * static_cast<int>(SEGMENT_MERGE_FACTOR) + 3000;
+const int VOCABULARY_SIZE = 200;
+
+struct ReferenceDocument {
+    std::map<std::string, double> word_freqs;
+    DocumentStatus status;
+    int rating;
+};
+
+// The live documents and how the server should see them
+using Reference = std::map<int, ReferenceDocument>;
+
+std::string MakeText(std::mt19937_64& generator) {
+    std::string text;
+    const int word_count = 3 + static_cast<int>(generator() % 10);
+    for (int i = 0; i < word_count; ++i) {
+        const double share = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+        text += "w"s + std::to_string(static_cast<int>(VOCABULARY_SIZE * share * share)) + " "s;
+    }
+    return text;
+}
+
+std::map<std::string, double> ComputeWordFreqs(const std::string& text) {
+    const std::vector<std::string> words = SplitIntoWords(text);
+    std::map<std::string, double> word_freqs;
+    for (const std::string& word : words) {
+        word_freqs[word] += 1.0 / words.size();
+    }
+    return word_freqs;
+}
+
+// Top of the query among the ACTUAL documents by TF-IDF over the live ones
+std::vector<Document> FindReferenceTop(const Reference& reference, const std::string& query) {
+    std::set<std::string> plus_words;
+    std::set<std::string> minus_words;
+    for (const std::string& word : SplitIntoWords(query)) {
+        if (word[0] == '-') {
+            minus_words.insert(word.substr(1));
+        } else {
+            plus_words.insert(word);
+        }
+    }
+    std::map<std::string, int> document_freqs;
+    for (const auto& [id, document] : reference) {
+        for (const auto& [word, _] : document.word_freqs) {
+            ++document_freqs[word];
+        }
+    }
+    std::vector<Document> matches;
+    for (const auto& [id, document] : reference) {
+        if (document.status != DocumentStatus::ACTUAL) {
+            continue;
+        }
+        const bool has_minus_word = std::any_of(minus_words.begin(), minus_words.end(), [&](const std::string& word) {
+            return document.word_freqs.count(word) > 0;
+        });
+        double relevance = 0.0;
+        bool has_plus_word = false;
+        for (const std::string& word : plus_words) {
+            const auto it = document.word_freqs.find(word);
+            if (it != document.word_freqs.end()) {
+                relevance += it->second * std::log(static_cast<double>(reference.size()) / document_freqs.at(word));
+                has_plus_word = true;
+            }
+        }
+        if (has_plus_word && !has_minus_word) {
+            matches.push_back({id, relevance, document.rating});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), IsRankedHigher);
+    matches.resize(std::min(matches.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)));
+    return matches;
+}
+
+void CheckIndex(const SearchServer& search_server, const Reference& reference, const std::vector<std::string>& queries,
+                const std::vector<int>& removed_ids, const std::string& name) {
+    Check(search_server.GetDocumentCount() == static_cast<int>(reference.size()), name + ": document count"s);
+    for (const std::string& query : queries) {
+        const std::vector<Document> found = search_server.FindTopDocuments(query);
+        const std::vector<Document> expected = FindReferenceTop(reference, query);
+        bool is_same = found.size() == expected.size();
+        for (size_t i = 0; is_same && i < found.size(); ++i) {
+            is_same = found[i].id == expected[i].id && found[i].rating == expected[i].rating
+                      && std::abs(found[i].relevance - expected[i].relevance) < EPSILON;
+        }
+        Check(is_same, name + ": results of \""s + query + "\""s);
+        for (const Document& document : found) {
+            Check(reference.count(document.id) > 0, name + ": removed document "s + std::to_string(document.id)
+                  + " is found"s);
+        }
+    }
+    for (const auto& [id, document] : reference) {
+        const std::map<std::string_view, double> word_freqs = search_server.GetWordFrequencies(id);
+        bool is_same = word_freqs.size() == document.word_freqs.size();
+        for (const auto& [word, freq] : document.word_freqs) {
+            const auto it = word_freqs.find(word);
+            is_same = is_same && it != word_freqs.end() && std::abs(it->second - freq) < EPSILON;
+        }
+        Check(is_same, name + ": word frequencies of document "s + std::to_string(id));
+    }
+    for (const int id : removed_ids) {
+        Check(search_server.GetWordFrequencies(id).empty(), name + ": removed document "s + std::to_string(id)
+              + " has words"s);
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 generator(8);
+    SearchServer search_server(""s);
+    Reference reference;
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        const std::string text = MakeText(generator);
+        const DocumentStatus status = id % 7 == 6 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+        const int rating = static_cast<int>(generator() % 11) - 5;
+        search_server.AddDocument(id, text, status, {rating});
+        reference[id] = {ComputeWordFreqs(text), status, rating};
+    }
+    // most of the first segment, so it is compacted on its own, and every
+    // fifth document of the others
+    std::vector<int> removed_ids;
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        if (id < SEGMENT_DOCUMENT_COUNT * 3 / 4 || id % 5 == 0) {
+            search_server.RemoveDocument(id);
+            reference.erase(id);
+            removed_ids.push_back(id);
+        }
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 40; ++i) {
+        std::string query = MakeText(generator);
+        if (i % 3 == 0) {
+            query += "-w"s + std::to_string(generator() % 20);
+        }
+        queries.push_back(query);
+    }
+
+    // merges may be running meanwhile, which must not change anything either
+    CheckIndex(search_server, reference, queries, removed_ids, "before the merges"s);
+    search_server.WaitForMerges();
+    Check(search_server.GetSealedSegmentCount() < SEGMENT_MERGE_FACTOR, "the sealed segments are merged"s);
+    CheckIndex(search_server, reference, queries, removed_ids, "after the merges"s);
+    return FinishChecks();
+}
@@ -0,0 +1,132 @@
+// Checks that searches by status, which test the status bitmaps of the
+// segments, agree with the same searches by a predicate on the status.
+// Documents of every status are searched in the open segment only, in
+// sealed segments with batches and removals, after the merges and in a
+// saved index opened from its file, under both policies and both scoring
+// strategies. Run it without arguments, it writes its file to the current
+// directory and exits with 1 if a check fails.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <execution>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../search_server.h"
+#include "check.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::string INDEX_PATH = "status_filter_check.index"s;
+const std::vector<DocumentStatus> STATUSES = {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+                                              DocumentStatus::BANNED, DocumentStatus::REMOVED};
+const std::vector<std::string> QUERIES = {"cat"s, "cat dog"s, "dog -parrot"s, "cat dog parrot starling"s,
+                                          "w3 w7 w11"s, "w1 cat -w2"s, "(cat OR w5) AND dog"s, "missing"s};
+
+std::string MakeText(std::mt19937_64& generator) {
+    const std::vector<std::string> animals = {"cat"s, "dog"s, "parrot"s, "starling"s};
+    std::string text;
+    const int word_count = 2 + static_cast<int>(generator() % 8);
+    for (int i = 0; i < word_count; ++i) {
+        text += generator() % 3 == 0 ? animals[generator() % animals.size()] + " "s
+                                     : "w"s + std::to_string(generator() % 20) + " "s;
+    }
+    return text;
+}
+
+DocumentStatus DrawStatus(std::mt19937_64& generator) {
+    return STATUSES[generator() % STATUSES.size()];
+}
+
+void AddDocuments(SearchServer& search_server, std::mt19937_64& generator, int first_id, int count) {
+    for (int id = first_id; id < first_id + count; ++id) {
+        search_server.AddDocument(id, MakeText(generator), DrawStatus(generator),
+                                  {static_cast<int>(generator() % 21) - 10});
+    }
+}
+
+bool IsSame(const std::vector<Document>& lhs, const std::vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].id != rhs[i].id || lhs[i].rating != rhs[i].rating
+            || std::abs(lhs[i].relevance - rhs[i].relevance) >= EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename ExecutionPolicy>
+void CheckStatuses(const SearchServer& search_server, ExecutionPolicy policy, const std::string& name) {
+    for (const std::string& query : QUERIES) {
+        for (const DocumentStatus status : STATUSES) {
+            for (const size_t top_k : {5, 1000}) {
+                const std::vector<Document> by_status = search_server.FindTopDocuments(policy, query, status, top_k);
+                const std::vector<Document> by_predicate = search_server.FindTopDocuments(policy, query,
+                    [status](int, DocumentStatus document_status, int) {
+                        return document_status == status;
+                    }, top_k);
+                Check(IsSame(by_status, by_predicate), name + ", \""s + query + "\", status "s
+                      + std::to_string(static_cast<int>(status)) + ", top "s + std::to_string(top_k));
+            }
+        }
+    }
+}
+
+void CheckIndex(SearchServer& search_server, const std::string& name) {
+    for (const ScoringStrategy strategy : {ScoringStrategy::TERM_AT_A_TIME, ScoringStrategy::MAX_SCORE}) {
+        search_server.SetScoringStrategy(strategy);
+        const std::string strategy_name = strategy == ScoringStrategy::MAX_SCORE ? ", MaxScore"s : ", term at a time"s;
+        CheckStatuses(search_server, std::execution::seq, name + strategy_name + ", seq"s);
+        CheckStatuses(search_server, std::execution::par, name + strategy_name + ", par"s);
+    }
+    search_server.SetScoringStrategy(ScoringStrategy::AUTO);
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 generator(20);
+    SearchServer search_server("and with"s);
+    search_server.EnableBooleanQueries();
+    AddDocuments(search_server, generator, 0, SEGMENT_DOCUMENT_COUNT / 2);
+    CheckIndex(search_server, "open segment"s);
+
+    int next_id = SEGMENT_DOCUMENT_COUNT / 2;
+    for (size_t segment = 0; segment + 1 < SEGMENT_MERGE_FACTOR; ++segment) {
+        AddDocuments(search_server, generator, next_id, SEGMENT_DOCUMENT_COUNT);
+        next_id += SEGMENT_DOCUMENT_COUNT;
+    }
+    std::vector<std::string> texts;
+    for (int i = 0; i < 2000; ++i) {
+        texts.push_back(MakeText(generator));
+    }
+    std::vector<DocumentInput> batch;
+    for (const std::string& text : texts) {
+        batch.push_back({next_id++, text, DrawStatus(generator), {static_cast<int>(generator() % 21) - 10}});
+    }
+    search_server.AddDocuments(std::execution::par, batch);
+    for (int id = 0; id < next_id; id += 7) {
+        search_server.RemoveDocument(id);
+    }
+    CheckIndex(search_server, "sealed segments"s);
+
+    // the last segments tip the first tier over the merge factor
+    AddDocuments(search_server, generator, next_id, 2 * SEGMENT_DOCUMENT_COUNT);
+    search_server.WaitForMerges();
+    Check(search_server.GetSealedSegmentCount() < SEGMENT_MERGE_FACTOR, "the sealed segments are merged"s);
+    CheckIndex(search_server, "merged segments"s);
+
+    search_server.Save(INDEX_PATH);
+    SearchServer opened = SearchServer::Open(INDEX_PATH);
+    opened.EnableBooleanQueries();
+    CheckIndex(opened, "opened index"s);
+    std::remove(INDEX_PATH.c_str());
+    return FinishChecks();
+}
@@ -1,55 +1,164 @@
 #pragma once
 
-#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <mutex>
-#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
- 
-#include "log_duration.h"
-#include "test_framework.h"
- 
-using namespace std::string_literals;
- 
+
+// Map of integer keys split into buckets, each an open addressing table
+// behind its own lock. Buckets are cache line aligned, so threads working
+// on different buckets do not share lines. An Access holds the lock of its
+// bucket for as long as it lives.
 template <typename Key, typename Value>
 class ConcurrentMap {
 private:
-    struct Bucket {
+    struct Slot {
+        Key key{};
+        Value value{};
+        bool is_used = false;
+    };
+
+    struct alignas(64) Bucket {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        // empty or a power of two in size, at most half used
+        std::vector<Slot> slots;
+        size_t size = 0;
     };
- 
+
 public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
- 
+    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
+
     struct Access {
         std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
- 
+
         Access(const Key& key, Bucket& bucket)
             : guard(bucket.mutex)
-            , ref_to_value(bucket.map[key]) {
+            , ref_to_value(FindOrInsert(bucket, key)) {
         }
     };
- 
+
     explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count) {
+        : buckets_(bucket_count > 0 ? bucket_count : 1) {
     }
- 
+
     Access operator[](const Key& key) {
-        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return {key, bucket};
+        return {key, GetBucket(key)};
+    }
+
+    // Adds delta to the value of the key, a new key starts from Value(),
+    // and returns the previous value. The lock is held only for the add.
+    Value FetchAdd(const Key& key, Value delta) {
+        static_assert(std::is_arithmetic_v<Value>, "FetchAdd supports only arithmetic values");
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        Value& value = FindOrInsert(bucket, key);
+        const Value previous = value;
+        value += delta;
+        return previous;
+    }
+
+    size_t GetBucketCount() const {
+        return buckets_.size();
     }
- 
+
+    // Moves the entries of one bucket out and leaves it empty. Draining the
+    // buckets one by one never holds more than a bucket in two places.
+    std::vector<std::pair<Key, Value>> ExtractBucket(size_t bucket_index) {
+        Bucket& bucket = buckets_[bucket_index];
+        std::vector<std::pair<Key, Value>> entries;
+        std::lock_guard guard(bucket.mutex);
+        entries.reserve(bucket.size);
+        for (Slot& slot : bucket.slots) {
+            if (slot.is_used) {
+                entries.emplace_back(slot.key, std::move(slot.value));
+            }
+        }
+        std::vector<Slot>().swap(bucket.slots);
+        bucket.size = 0;
+        return entries;
+    }
+
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : buckets_) {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            for (const Slot& slot : bucket.slots) {
+                if (slot.is_used) {
+                    result.emplace(slot.key, slot.value);
+                }
+            }
         }
         return result;
     }
- 
+
 private:
     std::vector<Bucket> buckets_;
-};
\ No newline at end of file
+
+    static uint64_t Hash(const Key& key) {
+        uint64_t hash = static_cast<uint64_t>(key);
+        hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdull;
+        return hash ^ (hash >> 33);
+    }
+
+    Bucket& GetBucket(const Key& key) {
+        return buckets_[Hash(key) % buckets_.size()];
+    }
+
+    // Slot positions take the high bits, the bucket index the low ones
+    static size_t GetFirstPosition(const Bucket& bucket, const Key& key) {
+        return static_cast<size_t>(Hash(key) >> 32) & (bucket.slots.size() - 1);
+    }
+
+    static Slot* Find(Bucket& bucket, const Key& key) {
+        if (bucket.slots.empty()) {
+            return nullptr;
+        }
+        const size_t mask = bucket.slots.size() - 1;
+        for (size_t position = GetFirstPosition(bucket, key); bucket.slots[position].is_used;
+             position = (position + 1) & mask) {
+            if (bucket.slots[position].key == key) {
+                return &bucket.slots[position];
+            }
+        }
+        return nullptr;
+    }
+
+    static Value& FindOrInsert(Bucket& bucket, const Key& key) {
+        if (Slot* slot = Find(bucket, key)) {
+            return slot->value;
+        }
+        if ((bucket.size + 1) * 2 > bucket.slots.size()) {
+            Grow(bucket);
+        }
+        const size_t mask = bucket.slots.size() - 1;
+        size_t position = GetFirstPosition(bucket, key);
+        while (bucket.slots[position].is_used) {
+            position = (position + 1) & mask;
+        }
+        Slot& slot = bucket.slots[position];
+        slot.key = key;
+        slot.is_used = true;
+        ++bucket.size;
+        return slot.value;
+    }
+
+    static void Grow(Bucket& bucket) {
+        std::vector<Slot> old_slots(bucket.slots.empty() ? 8 : bucket.slots.size() * 2);
+        old_slots.swap(bucket.slots);
+        const size_t mask = bucket.slots.size() - 1;
+        for (Slot& old_slot : old_slots) {
+            if (!old_slot.is_used) {
+                continue;
+            }
+            size_t position = GetFirstPosition(bucket, old_slot.key);
+            while (bucket.slots[position].is_used) {
+                position = (position + 1) & mask;
+            }
+            bucket.slots[position] = std::move(old_slot);
+        }
+    }
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 enum class DocumentStatus {
@@ -18,6 +19,14 @@ struct Document {
     
 };
 
+// A document for SearchServer::AddDocuments, text has to outlive the call
+struct DocumentInput {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
 void PrintDocument(const Document& document);
@@ -0,0 +1,120 @@
+#include "document_map.h"
+
+#include <algorithm>
+
+int DocumentMap::Iterator::operator*() const {
+    return IsAtChange() ? change_->first : saved_->document_id;
+}
+
+DocumentMap::Iterator& DocumentMap::Iterator::operator++() {
+    if (IsAtChange()) {
+        // a change of a saved document stands for its record
+        if (saved_ != saved_end_ && saved_->document_id == change_->first) {
+            ++saved_;
+        }
+        ++change_;
+    } else {
+        ++saved_;
+    }
+    SkipRemoved();
+    return *this;
+}
+
+DocumentMap::Iterator DocumentMap::Iterator::operator++(int) {
+    Iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool DocumentMap::Iterator::operator==(const Iterator& other) const {
+    return saved_ == other.saved_ && change_ == other.change_;
+}
+
+bool DocumentMap::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+DocumentMap::Iterator::Iterator(const IndexFileLocation* saved, const IndexFileLocation* saved_end,
+                                ChangeIterator change, ChangeIterator change_end)
+    : saved_(saved)
+    , saved_end_(saved_end)
+    , change_(change)
+    , change_end_(change_end) {
+    SkipRemoved();
+}
+
+bool DocumentMap::Iterator::IsAtChange() const {
+    return change_ != change_end_ && (saved_ == saved_end_ || change_->first <= saved_->document_id);
+}
+
+void DocumentMap::Iterator::SkipRemoved() {
+    while (IsAtChange() && !change_->second) {
+        if (saved_ != saved_end_ && saved_->document_id == change_->first) {
+            ++saved_;
+        }
+        ++change_;
+    }
+}
+
+DocumentMap::DocumentMap(ArrayView<IndexFileLocation> saved)
+    : saved_(saved)
+    , size_(saved.size()) {
+}
+
+std::optional<DocumentMap::Location> DocumentMap::Find(int document_id) const {
+    const auto change = changes_.find(document_id);
+    if (change != changes_.end()) {
+        return change->second;
+    }
+    const IndexFileLocation* saved = FindSaved(document_id);
+    if (saved == nullptr) {
+        return std::nullopt;
+    }
+    return Location{saved->segment, saved->slot};
+}
+
+bool DocumentMap::Contains(int document_id) const {
+    return Find(document_id).has_value();
+}
+
+void DocumentMap::Insert(int document_id, Location location) {
+    changes_[document_id] = location;
+    ++size_;
+}
+
+void DocumentMap::Update(int document_id, Location location) {
+    changes_[document_id] = location;
+}
+
+void DocumentMap::Erase(int document_id) {
+    if (FindSaved(document_id) != nullptr) {
+        changes_[document_id] = std::nullopt;
+    } else {
+        changes_.erase(document_id);
+    }
+    --size_;
+}
+
+size_t DocumentMap::size() const {
+    return size_;
+}
+
+bool DocumentMap::empty() const {
+    return size_ == 0;
+}
+
+DocumentMap::Iterator DocumentMap::begin() const {
+    return Iterator(saved_.begin(), saved_.end(), changes_.begin(), changes_.end());
+}
+
+DocumentMap::Iterator DocumentMap::end() const {
+    return Iterator(saved_.end(), saved_.end(), changes_.end(), changes_.end());
+}
+
+const IndexFileLocation* DocumentMap::FindSaved(int document_id) const {
+    const auto saved = std::lower_bound(saved_.begin(), saved_.end(), document_id,
+        [](const IndexFileLocation& location, int document_id) {
+            return location.document_id < document_id;
+        });
+    return saved != saved_.end() && saved->document_id == document_id ? saved : nullptr;
+}
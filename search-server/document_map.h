@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+
+#include "flat_array.h"
+#include "index_file.h"
+
+// Where every live document is, by id. The documents of an opened index
+// are found by a binary search over its IndexFileLocation records, which
+// stay in the mapped file; only documents added, moved or removed since
+// are kept in a map.
+class DocumentMap {
+public:
+    struct Location {
+        uint32_t segment;
+        int slot;
+    };
+
+    // Ids in increasing order
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        int operator*() const;
+
+        Iterator& operator++();
+
+        Iterator operator++(int);
+
+        bool operator==(const Iterator& other) const;
+
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        friend class DocumentMap;
+
+        using ChangeIterator = std::map<int, std::optional<Location>>::const_iterator;
+
+        const IndexFileLocation* saved_;
+        const IndexFileLocation* saved_end_;
+        ChangeIterator change_;
+        ChangeIterator change_end_;
+
+        Iterator(const IndexFileLocation* saved, const IndexFileLocation* saved_end, ChangeIterator change,
+                 ChangeIterator change_end);
+
+        // Whether the current id comes from the changes rather than the saved records
+        bool IsAtChange() const;
+
+        // Skips saved documents removed since
+        void SkipRemoved();
+    };
+
+    DocumentMap() = default;
+
+    // Documents of an opened index, the records are sorted by id
+    explicit DocumentMap(ArrayView<IndexFileLocation> saved);
+
+    // Empty when there is no such document
+    std::optional<Location> Find(int document_id) const;
+
+    bool Contains(int document_id) const;
+
+    // The document must be missing
+    void Insert(int document_id, Location location);
+
+    // The document must be present
+    void Update(int document_id, Location location);
+
+    // The document must be present
+    void Erase(int document_id);
+
+    size_t size() const;
+
+    bool empty() const;
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+private:
+    ArrayView<IndexFileLocation> saved_;
+    // new locations by id, empty for saved documents that were removed
+    std::map<int, std::optional<Location>> changes_;
+    size_t size_ = 0;
+
+    const IndexFileLocation* FindSaved(int document_id) const;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Read-only view of contiguous elements owned elsewhere
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() = default;
+
+    ArrayView(const T* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    const T* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    const T* begin() const {
+        return data_;
+    }
+
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Elements kept either in an owned vector, which can grow, or in memory
+// owned by someone else, such as a mapped index file
+template <typename T>
+class FlatArray {
+public:
+    FlatArray() = default;
+
+    explicit FlatArray(std::vector<T> values)
+        : values_(std::move(values))
+        , view_(values_.data(), values_.size()) {
+    }
+
+    explicit FlatArray(ArrayView<T> view)
+        : view_(view) {
+    }
+
+    FlatArray(const FlatArray&) = delete;
+    FlatArray& operator=(const FlatArray&) = delete;
+
+    // Moving a vector keeps its buffer, so the view stays valid
+    FlatArray(FlatArray&& other) noexcept
+        : values_(std::move(other.values_))
+        , view_(std::exchange(other.view_, {})) {
+    }
+
+    FlatArray& operator=(FlatArray&& other) noexcept {
+        if (this != &other) {
+            values_ = std::move(other.values_);
+            view_ = std::exchange(other.view_, {});
+        }
+        return *this;
+    }
+
+    // Only for arrays that own their elements
+    void push_back(const T& value) {
+        values_.push_back(value);
+        view_ = ArrayView<T>(values_.data(), values_.size());
+    }
+
+    // Only for arrays that own their elements
+    T& GetMutable(size_t index) {
+        return values_[index];
+    }
+
+    ArrayView<T> GetView() const {
+        return view_;
+    }
+
+    const T* data() const {
+        return view_.data();
+    }
+
+    size_t size() const {
+        return view_.size();
+    }
+
+    bool empty() const {
+        return view_.empty();
+    }
+
+    const T& operator[](size_t index) const {
+        return view_[index];
+    }
+
+    const T* begin() const {
+        return view_.begin();
+    }
+
+    const T* end() const {
+        return view_.end();
+    }
+
+private:
+    std::vector<T> values_;
+    ArrayView<T> view_;
+};
\ No newline at end of file
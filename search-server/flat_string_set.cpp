@@ -0,0 +1,53 @@
+#include "flat_string_set.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "word_set_fingerprint.h"
+
+FlatStringSet::FlatStringSet(std::vector<std::string> strings)
+    : strings_(std::move(strings)) {
+    std::sort(strings_.begin(), strings_.end());
+    strings_.erase(std::unique(strings_.begin(), strings_.end()), strings_.end());
+    size_t slot_count = 2;
+    while (slot_count < strings_.size() * 2) {
+        slot_count *= 2;
+    }
+    slots_.assign(slot_count, EMPTY_SLOT);
+    for (size_t index = 0; index < strings_.size(); ++index) {
+        size_t slot = HashWord(strings_[index]) & (slot_count - 1);
+        while (slots_[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots_[slot] = static_cast<uint32_t>(index);
+    }
+}
+
+bool FlatStringSet::Contains(std::string_view str) const {
+    if (strings_.empty()) {
+        return false;
+    }
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = HashWord(str) & mask; slots_[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+        if (strings_[slots_[slot]] == str) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FlatStringSet::size() const {
+    return strings_.size();
+}
+
+bool FlatStringSet::empty() const {
+    return strings_.empty();
+}
+
+std::vector<std::string>::const_iterator FlatStringSet::begin() const {
+    return strings_.begin();
+}
+
+std::vector<std::string>::const_iterator FlatStringSet::end() const {
+    return strings_.end();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Set of strings fixed at construction. Contains hashes the view once and
+// compares it with the strings of its probe sequence, nothing is allocated.
+// The table is kept at most half full, so a miss usually stops at the
+// first empty slot.
+class FlatStringSet {
+public:
+    FlatStringSet() = default;
+
+    explicit FlatStringSet(std::vector<std::string> strings);
+
+    template <typename StringContainer>
+    explicit FlatStringSet(const StringContainer& strings)
+        : FlatStringSet(std::vector<std::string>(std::begin(strings), std::end(strings))) {
+    }
+
+    bool Contains(std::string_view str) const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // The strings in sorted order
+    std::vector<std::string>::const_iterator begin() const;
+
+    std::vector<std::string>::const_iterator end() const;
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    // sorted and unique
+    std::vector<std::string> strings_;
+    // indexes into strings_ by hash, the size is a power of two
+    std::vector<uint32_t> slots_;
+};
@@ -0,0 +1,94 @@
+#include "index_file.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open index file "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read index file "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map index file "s + path);
+        }
+        data_ = static_cast<const uint8_t*>(data);
+    }
+    // the mapping keeps the file open
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+const uint8_t* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
+
+IndexFileWriter::IndexFileWriter(const std::string& path)
+    : path_(path)
+    , temp_path_(path + ".tmp")
+    , out_(temp_path_, std::ios::binary | std::ios::trunc)
+    , offset_(sizeof(IndexFileHeader)) {
+    if (!out_) {
+        throw std::runtime_error("Cannot create index file "s + temp_path_);
+    }
+    // room for the header, it is written last
+    const IndexFileHeader header{};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void IndexFileWriter::WriteWords(const std::vector<std::string_view>& words, FileArray& offsets, FileArray& chars) {
+    std::vector<uint64_t> word_offsets{0};
+    std::vector<char> word_chars;
+    for (const std::string_view word : words) {
+        word_chars.insert(word_chars.end(), word.begin(), word.end());
+        word_offsets.push_back(word_chars.size());
+    }
+    offsets = Write(ArrayView<uint64_t>(word_offsets.data(), word_offsets.size()));
+    chars = Write(ArrayView<char>(word_chars.data(), word_chars.size()));
+}
+
+void IndexFileWriter::Finish(const IndexFileHeader& header) {
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (!out_ || std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        std::remove(temp_path_.c_str());
+        throw std::runtime_error("Cannot write index file "s + path_);
+    }
+}
+
+void IndexFileWriter::Align() {
+    static const char padding[8] = {};
+    const uint64_t padding_size = (8 - offset_ % 8) % 8;
+    out_.write(padding, padding_size);
+    offset_ += padding_size;
+}
+
+std::string_view GetWord(ArrayView<uint64_t> offsets, ArrayView<char> chars, size_t index) {
+    if (offsets[index] > offsets[index + 1] || offsets[index + 1] > chars.size()) {
+        throw std::invalid_argument("Index file is damaged");
+    }
+    return {chars.data() + offsets[index], offsets[index + 1] - offsets[index]};
+}
\ No newline at end of file
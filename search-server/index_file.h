@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_array.h"
+
+// Layout of a saved index. Every section is an array of fixed-size
+// records at an 8-byte aligned offset, so an opened index reads them in
+// place from the mapping. Numbers are stored in the byte order of the
+// machine that saved the file, byte_order tells whether it matches.
+
+// count records of the array's type starting at offset
+struct FileArray {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SegmentFileHeader {
+    uint32_t number;
+    uint32_t reserved;
+    FileArray documents;
+    FileArray term_freqs;
+    FileArray word_positions;
+    FileArray status_words;
+    FileArray term_ids;
+    FileArray term_postings;
+    FileArray blocks;
+    FileArray bytes;
+    // words of the deleted slot bitmap
+    FileArray deleted;
+    uint64_t deleted_count;
+};
+
+struct IndexFileHeader {
+    static constexpr char MAGIC[8] = "SRCHIDX";
+    static constexpr uint32_t VERSION = 5;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr uint32_t WORD_POSITIONS = 1;
+    static constexpr uint32_t FOLDING_CASE = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    // see IndexFileWriter::WriteWords
+    FileArray stop_word_offsets;
+    FileArray stop_word_chars;
+    FileArray term_offsets;
+    FileArray term_chars;
+    // open addressing table of term ids by word hash
+    FileArray term_slots;
+    FileArray document_freqs;
+    // IndexFileLocation records sorted by document id
+    FileArray locations;
+    // SegmentFileHeader records sorted by number
+    FileArray segments;
+    uint32_t next_segment_number;
+    // WORD_POSITIONS when the segments keep word positions, FOLDING_CASE
+    // when the tokenizer folds case
+    uint32_t flags;
+    // bit c is set for the delimiter c of the tokenizer
+    uint64_t delimiters[2];
+};
+
+struct IndexFileLocation {
+    int32_t document_id;
+    uint32_t segment;
+    int32_t slot;
+};
+
+// Read-only mapping of a whole file, unmapped by the destructor. Pages
+// are read from disk when they are first touched.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const uint8_t* data() const;
+
+    size_t size() const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Writes the sections of an index to a temporary file, Finish puts the
+// header in front and moves the file to its place, so readers never see
+// a partially written index
+class IndexFileWriter {
+public:
+    explicit IndexFileWriter(const std::string& path);
+
+    template <typename T>
+    FileArray Write(ArrayView<T> values);
+
+    // Word i is chars[offsets[i], offsets[i + 1])
+    void WriteWords(const std::vector<std::string_view>& words, FileArray& offsets, FileArray& chars);
+
+    void Finish(const IndexFileHeader& header);
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream out_;
+    uint64_t offset_;
+
+    void Align();
+};
+
+// The array a header refers to, checked against the bounds of the file
+template <typename T>
+ArrayView<T> GetArray(const MappedFile& file, FileArray array) {
+    if (array.offset % alignof(T) != 0 || array.offset > file.size()
+        || array.count > (file.size() - array.offset) / sizeof(T)) {
+        throw std::invalid_argument("Index file is damaged");
+    }
+    return {reinterpret_cast<const T*>(file.data() + array.offset), static_cast<size_t>(array.count)};
+}
+
+// Word i of arrays written by IndexFileWriter::WriteWords
+std::string_view GetWord(ArrayView<uint64_t> offsets, ArrayView<char> chars, size_t index);
+
+template <typename T>
+FileArray IndexFileWriter::Write(ArrayView<T> values) {
+    Align();
+    const FileArray array{offset_, values.size()};
+    out_.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    offset_ += values.size() * sizeof(T);
+    return array;
+}
\ No newline at end of file
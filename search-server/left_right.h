@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Left-right concurrency control over two copies of T. Readers use one
+// copy while the writer changes the other, then the copies swap roles.
+// A reader never waits, not even for a writer in progress: it only bumps
+// a counter. The writer waits until the readers leave a copy before it
+// touches that copy. Writers are serialized.
+template <typename T>
+class LeftRight {
+public:
+    LeftRight() = default;
+
+    LeftRight(const LeftRight&) = delete;
+    LeftRight& operator=(const LeftRight&) = delete;
+
+    // Calls function with the copy that readers currently use and returns
+    // its result. Reads may nest, but a reader must not call Modify.
+    template <typename Function>
+    decltype(auto) Read(Function function) const {
+        ReaderCounter& counter = counters_[version_.load()][GetStripe()];
+        counter.value.fetch_add(1);
+        const Departure departure{counter};
+        return function(instances_[current_.load()]);
+    }
+
+    // Applies function to both copies. The two calls must make the same
+    // change. If the first call throws, it must leave its copy unchanged,
+    // and then the update is dropped. The second call must not throw.
+    template <typename Function>
+    void Modify(Function function) {
+        std::lock_guard guard(writer_mutex_);
+        const int current = current_.load();
+        function(instances_[1 - current]);
+        current_.store(1 - current);
+        WaitForReaders();
+        function(instances_[current]);
+    }
+
+    // Copy that readers currently use. Only safe when no writer runs.
+    const T& GetUnsynchronized() const {
+        return instances_[current_.load()];
+    }
+
+private:
+    static constexpr size_t STRIPE_COUNT = 16;
+
+    // Readers of different threads count on separate cache lines
+    struct alignas(64) ReaderCounter {
+        std::atomic<int64_t> value{0};
+    };
+
+    struct Departure {
+        ReaderCounter& counter;
+
+        ~Departure() {
+            counter.value.fetch_sub(1);
+        }
+    };
+
+    std::array<T, 2> instances_;
+    // copy the readers use
+    std::atomic<int> current_{0};
+    // set of counters new readers announce themselves in
+    std::atomic<int> version_{0};
+    mutable std::array<std::array<ReaderCounter, STRIPE_COUNT>, 2> counters_;
+    std::mutex writer_mutex_;
+
+    static size_t GetStripe() {
+        thread_local const size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % STRIPE_COUNT;
+        return stripe;
+    }
+
+    // After the swap of current_, readers may still be in the old copy.
+    // New readers go to the other counter set, and the old set drains.
+    void WaitForReaders() {
+        const int previous = version_.load();
+        const int next = 1 - previous;
+        WaitUntilEmpty(next);
+        version_.store(next);
+        WaitUntilEmpty(previous);
+    }
+
+    void WaitUntilEmpty(int version) const {
+        for (const ReaderCounter& counter : counters_[version]) {
+            while (counter.value.load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
\ No newline at end of file
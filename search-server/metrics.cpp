@@ -0,0 +1,237 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace {
+
+const char* const LATENCY_METRIC_NAMES[LATENCY_METRIC_COUNT] = {
+    "query_parse", "postings_scan", "minus_exclusion", "top_k_selection", "tokenization", "index_insert",
+};
+
+const char* const COUNTER_METRIC_NAMES[COUNTER_METRIC_COUNT] = {
+    "queries", "postings_scanned", "predicate_rejected", "minus_excluded", "documents_added",
+};
+
+// Upper bounds of the exported Prometheus buckets, in nanoseconds
+const uint64_t PROMETHEUS_BOUNDS_NS[] = {
+    1'000,       2'500,       5'000,       10'000,        25'000,        50'000,        100'000,
+    250'000,     500'000,     1'000'000,   2'500'000,     5'000'000,     10'000'000,    25'000'000,
+    50'000'000,  100'000'000, 250'000'000, 500'000'000,   1'000'000'000, 2'500'000'000, 10'000'000'000,
+};
+
+constexpr size_t SUB_BUCKET_BITS = 4;
+
+// Written only by the thread that owns it; relaxed atomics let snapshots
+// read it meanwhile
+struct MetricsShard {
+    std::atomic<uint64_t> buckets[LATENCY_METRIC_COUNT][HistogramSnapshot::BUCKET_COUNT] = {};
+    std::atomic<uint64_t> sums_ns[LATENCY_METRIC_COUNT] = {};
+    std::atomic<uint64_t> maxes_ns[LATENCY_METRIC_COUNT] = {};
+    std::atomic<uint64_t> counters[COUNTER_METRIC_COUNT] = {};
+};
+
+void Increase(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void AddShard(const MetricsShard& shard, MetricsSnapshot& snapshot) {
+    for (size_t m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        HistogramSnapshot& histogram = snapshot.latencies[m];
+        for (size_t b = 0; b < HistogramSnapshot::BUCKET_COUNT; ++b) {
+            const uint64_t count = shard.buckets[m][b].load(std::memory_order_relaxed);
+            histogram.buckets[b] += count;
+            histogram.count += count;
+        }
+        histogram.sum_ns += shard.sums_ns[m].load(std::memory_order_relaxed);
+        histogram.max_ns = std::max(histogram.max_ns, shard.maxes_ns[m].load(std::memory_order_relaxed));
+    }
+    for (size_t c = 0; c < COUNTER_METRIC_COUNT; ++c) {
+        snapshot.counters[c] += shard.counters[c].load(std::memory_order_relaxed);
+    }
+}
+
+// Shards of the running threads and the sum of the finished ones
+class MetricsRegistry {
+public:
+    // Never destroyed: worker threads of the thread pool may finish after
+    // the static objects are gone
+    static MetricsRegistry& Instance() {
+        static MetricsRegistry* const registry = new MetricsRegistry;
+        return *registry;
+    }
+
+    void Register(const MetricsShard* shard) {
+        std::lock_guard guard(mutex_);
+        shards_.push_back(shard);
+    }
+
+    void Unregister(const MetricsShard* shard) {
+        std::lock_guard guard(mutex_);
+        AddShard(*shard, finished_);
+        shards_.erase(std::find(shards_.begin(), shards_.end(), shard));
+    }
+
+    MetricsSnapshot GetSnapshot() const {
+        std::lock_guard guard(mutex_);
+        MetricsSnapshot snapshot = finished_;
+        for (const MetricsShard* shard : shards_) {
+            AddShard(*shard, snapshot);
+        }
+        return snapshot;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<const MetricsShard*> shards_;
+    MetricsSnapshot finished_;
+};
+
+class ThreadMetrics {
+public:
+    ThreadMetrics() {
+        MetricsRegistry::Instance().Register(&shard_);
+    }
+
+    ~ThreadMetrics() {
+        MetricsRegistry::Instance().Unregister(&shard_);
+    }
+
+    MetricsShard& GetShard() {
+        return shard_;
+    }
+
+private:
+    MetricsShard shard_;
+};
+
+MetricsShard& GetThreadShard() {
+    thread_local ThreadMetrics metrics;
+    return metrics.GetShard();
+}
+
+// Seconds with enough digits for nanoseconds
+std::string FormatSeconds(uint64_t ns) {
+    std::ostringstream out;
+    out << std::setprecision(9) << ns / 1e9;
+    return out.str();
+}
+
+}  // namespace
+
+size_t HistogramSnapshot::GetBucket(uint64_t value_ns) {
+    if (value_ns < SUB_BUCKET_COUNT) {
+        return value_ns;
+    }
+    const size_t exponent = 63 - __builtin_clzll(value_ns);
+    const size_t sub_bucket = (value_ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return std::min((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t HistogramSnapshot::GetBucketLowerBound(size_t bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const size_t exponent = bucket / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = bucket % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t HistogramSnapshot::GetQuantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * (count - 1));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        seen += buckets[b];
+        if (seen > rank) {
+            // the middle of the bucket, but never beyond the largest value
+            const uint64_t lower = GetBucketLowerBound(b);
+            const uint64_t upper = b + 1 < BUCKET_COUNT ? GetBucketLowerBound(b + 1) : lower;
+            return std::min(lower + (upper - lower) / 2, max_ns);
+        }
+    }
+    return max_ns;
+}
+
+std::string MetricsSnapshot::ToPrometheus() const {
+    std::ostringstream out;
+    out << "# HELP search_server_stage_seconds Time spent in the stages of searches and document additions\n"
+        << "# TYPE search_server_stage_seconds histogram\n";
+    for (size_t m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        const HistogramSnapshot& histogram = latencies[m];
+        const std::string stage = "stage=\""s + LATENCY_METRIC_NAMES[m] + '"';
+        // a value counts toward a bound when its bucket starts below it
+        size_t b = 0;
+        uint64_t cumulative = 0;
+        for (const uint64_t bound : PROMETHEUS_BOUNDS_NS) {
+            for (; b < HistogramSnapshot::BUCKET_COUNT && HistogramSnapshot::GetBucketLowerBound(b) <= bound; ++b) {
+                cumulative += histogram.buckets[b];
+            }
+            out << "search_server_stage_seconds_bucket{" << stage << ",le=\"" << FormatSeconds(bound) << "\"} "
+                << cumulative << '\n';
+        }
+        out << "search_server_stage_seconds_bucket{" << stage << ",le=\"+Inf\"} " << histogram.count << '\n'
+            << "search_server_stage_seconds_sum{" << stage << "} " << FormatSeconds(histogram.sum_ns) << '\n'
+            << "search_server_stage_seconds_count{" << stage << "} " << histogram.count << '\n';
+    }
+    for (size_t c = 0; c < COUNTER_METRIC_COUNT; ++c) {
+        const std::string name = "search_server_"s + COUNTER_METRIC_NAMES[c] + "_total"s;
+        out << "# TYPE " << name << " counter\n" << name << ' ' << counters[c] << '\n';
+    }
+    return out.str();
+}
+
+std::string MetricsSnapshot::ToJson() const {
+    std::ostringstream out;
+    out << "{\"stages\":{";
+    for (size_t m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        const HistogramSnapshot& histogram = latencies[m];
+        out << (m > 0 ? "," : "") << '"' << LATENCY_METRIC_NAMES[m] << "\":{\"count\":" << histogram.count
+            << ",\"sum_seconds\":" << FormatSeconds(histogram.sum_ns)
+            << ",\"max_seconds\":" << FormatSeconds(histogram.max_ns)
+            << ",\"p50_seconds\":" << FormatSeconds(histogram.GetQuantile(0.5))
+            << ",\"p90_seconds\":" << FormatSeconds(histogram.GetQuantile(0.9))
+            << ",\"p99_seconds\":" << FormatSeconds(histogram.GetQuantile(0.99))
+            << ",\"p999_seconds\":" << FormatSeconds(histogram.GetQuantile(0.999)) << '}';
+    }
+    out << "},\"counters\":{";
+    for (size_t c = 0; c < COUNTER_METRIC_COUNT; ++c) {
+        out << (c > 0 ? "," : "") << '"' << COUNTER_METRIC_NAMES[c] << "\":" << counters[c];
+    }
+    out << "}}";
+    return out.str();
+}
+
+const char* GetMetricName(LatencyMetric metric) {
+    return LATENCY_METRIC_NAMES[static_cast<size_t>(metric)];
+}
+
+const char* GetMetricName(CounterMetric metric) {
+    return COUNTER_METRIC_NAMES[static_cast<size_t>(metric)];
+}
+
+MetricsSnapshot GetMetricsSnapshot() {
+    return MetricsRegistry::Instance().GetSnapshot();
+}
+
+void RecordLatency(LatencyMetric metric, uint64_t duration_ns) {
+    MetricsShard& shard = GetThreadShard();
+    const auto m = static_cast<size_t>(metric);
+    Increase(shard.buckets[m][HistogramSnapshot::GetBucket(duration_ns)], 1);
+    Increase(shard.sums_ns[m], duration_ns);
+    if (duration_ns > shard.maxes_ns[m].load(std::memory_order_relaxed)) {
+        shard.maxes_ns[m].store(duration_ns, std::memory_order_relaxed);
+    }
+}
+
+void AddToCounter(CounterMetric metric, uint64_t value) {
+    Increase(GetThreadShard().counters[static_cast<size_t>(metric)], value);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Latency histograms and counters of the stages of searches and document
+// additions. Every thread records into its own shard without locks or
+// atomic read-modify-writes; a snapshot sums the shards of all threads.
+//
+// Histograms are HDR style: exact below 16 ns, then 16 buckets per power
+// of two, so a value is known within 6%, up to 2^40 ns, about 18 minutes.
+//
+// Building with SEARCH_SERVER_NO_METRICS defined turns the recording
+// macros into nothing; snapshots are then empty.
+// Stages nest: the minus word pass of term at a time scoring is part of
+// the postings scan of its range
+enum class LatencyMetric {
+    QUERY_PARSE,
+    POSTINGS_SCAN,
+    MINUS_EXCLUSION,
+    TOP_K_SELECTION,
+    TOKENIZATION,
+    INDEX_INSERT,
+};
+
+enum class CounterMetric {
+    // searches not answered from the result cache
+    QUERIES,
+    // postings visited term at a time, documents reached by MaxScore or
+    // matched by a boolean query
+    POSTINGS_SCANNED,
+    // documents the status or predicate turned down
+    PREDICATE_REJECTED,
+    // documents dropped for a minus word, term at a time every minus posting
+    MINUS_EXCLUDED,
+    DOCUMENTS_ADDED,
+};
+
+constexpr size_t LATENCY_METRIC_COUNT = static_cast<size_t>(LatencyMetric::INDEX_INSERT) + 1;
+constexpr size_t COUNTER_METRIC_COUNT = static_cast<size_t>(CounterMetric::DOCUMENTS_ADDED) + 1;
+
+struct HistogramSnapshot {
+    static constexpr size_t SUB_BUCKET_COUNT = 16;
+    // 16 exact buckets and the powers of two from 2^4 to 2^39
+    static constexpr size_t BUCKET_COUNT = 37 * SUB_BUCKET_COUNT;
+
+    // number of values in every bucket
+    std::array<uint64_t, BUCKET_COUNT> buckets{};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+
+    static size_t GetBucket(uint64_t value_ns);
+
+    // The smallest value that falls into the bucket
+    static uint64_t GetBucketLowerBound(size_t bucket);
+
+    // Value below which the share q of the values is, 0 without values
+    uint64_t GetQuantile(double q) const;
+};
+
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, LATENCY_METRIC_COUNT> latencies;
+    std::array<uint64_t, COUNTER_METRIC_COUNT> counters{};
+
+    // Prometheus text exposition format, latencies as histograms in seconds
+    std::string ToPrometheus() const;
+
+    // Count, sum, max and quantiles of every latency, and the counters
+    std::string ToJson() const;
+};
+
+// snake_case names used in the exports
+const char* GetMetricName(LatencyMetric metric);
+
+const char* GetMetricName(CounterMetric metric);
+
+// Sum of every thread's records since the start of the process
+MetricsSnapshot GetMetricsSnapshot();
+
+void RecordLatency(LatencyMetric metric, uint64_t duration_ns);
+
+void AddToCounter(CounterMetric metric, uint64_t value);
+
+// Records the time from construction to destruction
+class ScopedTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTimer(LatencyMetric metric)
+        : metric_(metric) {
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_);
+        RecordLatency(metric_, static_cast<uint64_t>(duration.count()));
+    }
+
+private:
+    const LatencyMetric metric_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+#define METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define METRICS_CONCAT(X, Y) METRICS_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_NO_METRICS
+#define METRICS_SCOPED_TIMER(metric)
+// the value is still read, so counting locals do not look unused
+#define METRICS_ADD(metric, value) static_cast<void>(value)
+#else
+#define METRICS_SCOPED_TIMER(metric) ScopedTimer METRICS_CONCAT(metrics_timer_, __LINE__)(LatencyMetric::metric)
+#define METRICS_ADD(metric, value) AddToCounter(CounterMetric::metric, value)
+#endif
@@ -0,0 +1,59 @@
+#include "plain_query.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "metrics.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+struct QueryWord {
+    std::string_view data;
+    bool is_minus;
+    bool is_stop;
+};
+
+QueryWord ParseQueryWord(const std::string_view text, const FlatStringSet& stop_words) {
+    if (text.empty()) {
+        throw std::invalid_argument("Query word is empty"s);
+    }
+    std::string_view word(text);
+    bool is_minus = false;
+    if (word[0] == '-') {
+        is_minus = true;
+        word = word.substr(1);
+    }
+    // the same rules as for the words of documents
+    if (word.empty() || word[0] == '-'
+        || std::any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+        throw std::invalid_argument("Query word "s + static_cast<std::string>(text) + " is invalid");
+    }
+    return {word, is_minus, stop_words.Contains(word)};
+}
+
+}  // namespace
+
+void ParsePlainQuery(std::string_view text, const FlatStringSet& stop_words, const Tokenizer& tokenizer,
+                     PlainQuery& query) {
+    METRICS_SCOPED_TIMER(QUERY_PARSE);
+    query.plus_words.clear();
+    query.minus_words.clear();
+    query.tokens.clear();
+    tokenizer.Split(text, query.folded_text, query.tokens);
+    for (const std::string_view word : query.tokens) {
+        const auto query_word = ParseQueryWord(word, stop_words);
+        if (!query_word.is_stop) {
+            if (query_word.is_minus) {
+                query.minus_words.push_back(query_word.data);
+            } else {
+                query.plus_words.push_back(query_word.data);
+            }
+        }
+    }
+    for (auto* words : {&query.plus_words, &query.minus_words}) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_string_set.h"
+#include "small_vector.h"
+#include "tokenizer.h"
+
+// Words of a plain query as views into the raw query text or its folded
+// copy, sorted and unique. Typical queries fit into the inline storage and
+// parse without allocations.
+struct PlainQuery {
+    SmallVector<std::string_view, 16> plus_words;
+    SmallVector<std::string_view, 16> minus_words;
+    // buffers of the tokenizer
+    std::string folded_text;
+    std::vector<std::string_view> tokens;
+};
+
+// Overwrites query, the words stay valid as long as text and query do.
+// Words are split and folded by the tokenizer, stop words are left out.
+// Throws std::invalid_argument on invalid words.
+void ParsePlainQuery(std::string_view text, const FlatStringSet& stop_words, const Tokenizer& tokenizer,
+                     PlainQuery& query);
@@ -0,0 +1,236 @@
+#include "posting_codec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POSTING_CODEC_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+size_t GetControlLength(size_t count) {
+    return (count + 3) / 4;
+}
+
+// Decodes values [first, count) with the control and data pointers already
+// positioned at value `first`, previous is the last decoded value for gaps.
+// The data of the values has to be within the available bytes at in.
+template <bool IsDelta>
+size_t DecodeScalar(const uint8_t* in, size_t available, size_t count, size_t first, const uint8_t* data,
+                    uint32_t previous, uint32_t* values) {
+    const uint8_t* end = in + available;
+    for (size_t i = first; i < count; ++i) {
+        const size_t length = ((in[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        if (static_cast<size_t>(end - data) < length) {
+            throw std::invalid_argument("Encoded values are truncated"s);
+        }
+        uint32_t value = 0;
+        for (size_t byte = 0; byte < length; ++byte) {
+            value |= uint32_t{data[byte]} << (8 * byte);
+        }
+        data += length;
+        if constexpr (IsDelta) {
+            previous += value;
+            values[i] = previous;
+        } else {
+            values[i] = value;
+        }
+    }
+    return static_cast<size_t>(data - in);
+}
+
+#ifdef POSTING_CODEC_X86
+
+struct ShuffleTables {
+    // moves the bytes of four values given by a control byte into 32-bit lanes
+    alignas(16) uint8_t masks[256][16];
+    // total data length of the four values
+    uint8_t lengths[256];
+
+    ShuffleTables() {
+        for (int code = 0; code < 256; ++code) {
+            int source = 0;
+            for (int value = 0; value < 4; ++value) {
+                const int length = ((code >> (2 * value)) & 3) + 1;
+                for (int byte = 0; byte < 4; ++byte) {
+                    masks[code][value * 4 + byte] = byte < length ? static_cast<uint8_t>(source + byte) : 0xFF;
+                }
+                source += length;
+            }
+            lengths[code] = static_cast<uint8_t>(source);
+        }
+    }
+};
+
+const ShuffleTables& GetShuffleTables() {
+    static const ShuffleTables tables;
+    return tables;
+}
+
+template <bool IsDelta>
+__attribute__((target("ssse3")))
+size_t DecodeSsse3(const uint8_t* in, size_t available, size_t count, uint32_t base, uint32_t* values) {
+    const ShuffleTables& tables = GetShuffleTables();
+    const uint8_t* data = in + GetControlLength(count);
+    const uint8_t* end = in + available;
+    __m128i previous = _mm_set1_epi32(static_cast<int>(base));
+    size_t i = 0;
+    // a full 16-byte load must stay inside the readable bytes
+    for (; i + 4 <= count && end - data >= 16; i += 4) {
+        const uint8_t code = in[i / 4];
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.masks[code]));
+        __m128i decoded = _mm_shuffle_epi8(raw, mask);
+        data += tables.lengths[code];
+        if constexpr (IsDelta) {
+            decoded = _mm_add_epi32(decoded, _mm_slli_si128(decoded, 4));
+            decoded = _mm_add_epi32(decoded, _mm_slli_si128(decoded, 8));
+            decoded = _mm_add_epi32(decoded, previous);
+            previous = _mm_shuffle_epi32(decoded, 0xFF);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), decoded);
+    }
+    return DecodeScalar<IsDelta>(in, available, count, i, data, static_cast<uint32_t>(_mm_cvtsi128_si32(previous)),
+                                 values);
+}
+
+template <bool IsDelta>
+__attribute__((target("avx2")))
+size_t DecodeAvx2(const uint8_t* in, size_t available, size_t count, uint32_t base, uint32_t* values) {
+    const ShuffleTables& tables = GetShuffleTables();
+    const uint8_t* data = in + GetControlLength(count);
+    const uint8_t* end = in + available;
+    __m256i previous = _mm256_set1_epi32(static_cast<int>(base));
+    // moves the last value of the low lane into every position of the high lane
+    const __m256i low_total = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+    const __m256i last_value = _mm256_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const uint8_t low_code = in[i / 4];
+        const uint8_t high_code = in[i / 4 + 1];
+        const uint8_t low_length = tables.lengths[low_code];
+        if (end - data < low_length + 16) {
+            break;
+        }
+        const __m256i raw = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + low_length)), 1);
+        const __m256i mask = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.masks[low_code]))),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(tables.masks[high_code])), 1);
+        __m256i decoded = _mm256_shuffle_epi8(raw, mask);
+        data += low_length + tables.lengths[high_code];
+        if constexpr (IsDelta) {
+            // prefix sums inside each 128-bit lane, then carry the low lane into the high one
+            decoded = _mm256_add_epi32(decoded, _mm256_slli_si256(decoded, 4));
+            decoded = _mm256_add_epi32(decoded, _mm256_slli_si256(decoded, 8));
+            const __m256i carry = _mm256_blend_epi32(_mm256_setzero_si256(),
+                _mm256_permutevar8x32_epi32(decoded, low_total), 0xF0);
+            decoded = _mm256_add_epi32(_mm256_add_epi32(decoded, carry), previous);
+            previous = _mm256_permutevar8x32_epi32(decoded, last_value);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), decoded);
+    }
+    const uint32_t last = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(previous)));
+    return DecodeScalar<IsDelta>(in, available, count, i, data, last, values);
+}
+
+DecodeKernel DetectDecodeKernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return DecodeKernel::AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return DecodeKernel::SSSE3;
+    }
+    return DecodeKernel::SCALAR;
+}
+
+#else
+
+DecodeKernel DetectDecodeKernel() {
+    return DecodeKernel::SCALAR;
+}
+
+#endif
+
+const DecodeKernel BEST_DECODE_KERNEL = DetectDecodeKernel();
+std::atomic<DecodeKernel> decode_kernel{BEST_DECODE_KERNEL};
+
+// Below this many values the setup of a SIMD kernel costs more than it
+// saves, and AVX2 only beats SSSE3 on full posting blocks, which have 127
+// slot gaps and 128 counts
+constexpr size_t MIN_SIMD_COUNT = 4;
+constexpr size_t MIN_AVX2_COUNT = 127;
+
+DecodeKernel ChooseDecodeKernel(size_t count) {
+    const DecodeKernel widest = decode_kernel.load(std::memory_order_relaxed);
+    if (count < MIN_SIMD_COUNT) {
+        return DecodeKernel::SCALAR;
+    }
+    if (count < MIN_AVX2_COUNT) {
+        return std::min(widest, DecodeKernel::SSSE3);
+    }
+    return widest;
+}
+
+template <bool IsDelta>
+size_t Decode(const uint8_t* in, size_t available, size_t count, uint32_t base, uint32_t* values) {
+    if (GetControlLength(count) > available) {
+        throw std::invalid_argument("Encoded values are truncated"s);
+    }
+#ifdef POSTING_CODEC_X86
+    switch (ChooseDecodeKernel(count)) {
+    case DecodeKernel::AVX2:
+        return DecodeAvx2<IsDelta>(in, available, count, base, values);
+    case DecodeKernel::SSSE3:
+        return DecodeSsse3<IsDelta>(in, available, count, base, values);
+    case DecodeKernel::SCALAR:
+        break;
+    }
+#endif
+    return DecodeScalar<IsDelta>(in, available, count, 0, in + GetControlLength(count), base, values);
+}
+
+}
+
+void EncodeStreamVByte(const uint32_t* values, size_t count, std::vector<uint8_t>& out) {
+    const size_t control_offset = out.size();
+    out.resize(out.size() + GetControlLength(count), 0);
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t value = values[i];
+        const size_t length = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+        out[control_offset + i / 4] |= static_cast<uint8_t>((length - 1) << (2 * (i % 4)));
+        for (size_t byte = 0; byte < length; ++byte) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+        }
+    }
+}
+
+size_t DecodeStreamVByte(const uint8_t* in, size_t available, size_t count, uint32_t* values) {
+    return Decode<false>(in, available, count, 0, values);
+}
+
+size_t DecodeStreamVByteDelta(const uint8_t* in, size_t available, size_t count, uint32_t base, uint32_t* values) {
+    return Decode<true>(in, available, count, base, values);
+}
+
+DecodeKernel GetDecodeKernel() {
+    return decode_kernel.load(std::memory_order_relaxed);
+}
+
+DecodeKernel GetDecodeKernel(size_t count) {
+    return ChooseDecodeKernel(count);
+}
+
+void SetDecodeKernel(DecodeKernel kernel) {
+    if (kernel <= BEST_DECODE_KERNEL) {
+        decode_kernel.store(kernel, std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// StreamVByte codec: a control byte holds 2-bit lengths of four values,
+// all control bytes of a run precede the 1-4 byte little-endian values.
+// Decoding picks scalar code, an SSSE3 or an AVX2 kernel by the length of
+// the run and by what the CPU has, which is checked at runtime.
+
+// Appends the encoding of values to out
+void EncodeStreamVByte(const uint32_t* values, size_t count, std::vector<uint8_t>& out);
+
+// Decodes count values and returns the number of bytes consumed.
+// `available` is the number of readable bytes at `in`, SIMD kernels
+// only read past the encoded run when they are allowed to. Throws
+// std::invalid_argument if the run does not fit in them.
+size_t DecodeStreamVByte(const uint8_t* in, size_t available, size_t count, uint32_t* values);
+
+// Same as DecodeStreamVByte, but the encoded values are gaps:
+// values[i] = base + gap[0] + ... + gap[i]
+size_t DecodeStreamVByteDelta(const uint8_t* in, size_t available, size_t count, uint32_t base, uint32_t* values);
+
+enum class DecodeKernel {
+    SCALAR,
+    SSSE3,
+    AVX2,
+};
+
+// The widest kernel the decoder may use
+DecodeKernel GetDecodeKernel();
+
+// The kernel that decodes a run of count values: scalar code for a few
+// values, SSSE3 for short runs and the widest kernel for full blocks
+DecodeKernel GetDecodeKernel(size_t count);
+
+// Limits the decoder to kernels up to the given one, which is the widest
+// the CPU has by default. Kernels the CPU lacks are ignored.
+void SetDecodeKernel(DecodeKernel kernel);
\ No newline at end of file
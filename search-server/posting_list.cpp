@@ -0,0 +1,207 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "posting_codec.h"
+
+using namespace std::string_literals;
+
+PostingListView::Cursor::Cursor(const PostingListView& postings, int first_slot, int last_slot)
+    : blocks_(postings.blocks_)
+    , bytes_(postings.bytes_)
+    , tail_(postings.tail_)
+    , last_slot_(last_slot)
+    , block_(FindBlock(blocks_, first_slot)) {
+    LoadBlock(block_);
+    SeekInBlock(first_slot);
+}
+
+void PostingListView::Cursor::SkipTo(int slot) {
+    if (IsEnd() || GetSlot() >= slot) {
+        return;
+    }
+    if (block_ < blocks_.size() && static_cast<int>(blocks_[block_].last_slot) < slot) {
+        block_ = GallopToBlock(blocks_, block_, slot);
+        LoadBlock(block_);
+    }
+    SeekInBlock(slot);
+}
+
+void PostingListView::Cursor::LoadBlock(size_t block) {
+    position_ = 0;
+    if (block < blocks_.size()) {
+        size_ = blocks_[block].size;
+        DecodeBlock(blocks_[block], bytes_, slots_.data(), counts_.data());
+        return;
+    }
+    size_ = tail_.size();
+    for (size_t i = 0; i < size_; ++i) {
+        slots_[i] = tail_[i].slot;
+        counts_[i] = tail_[i].count;
+    }
+}
+
+void PostingListView::Cursor::SeekInBlock(int slot) {
+    position_ = std::lower_bound(slots_.begin() + position_, slots_.begin() + size_, static_cast<uint32_t>(slot))
+        - slots_.begin();
+    if (position_ == size_ && block_ < blocks_.size()) {
+        LoadBlock(++block_);
+    }
+}
+
+PostingListView::PostingListView(ArrayView<PostingBlock> blocks, ArrayView<uint8_t> bytes, ArrayView<Posting> tail,
+                                 size_t size, double max_term_freq)
+    : blocks_(blocks)
+    , bytes_(bytes)
+    , tail_(tail)
+    , size_(size)
+    , max_term_freq_(max_term_freq) {
+}
+
+size_t PostingListView::size() const {
+    return size_;
+}
+
+bool PostingListView::empty() const {
+    return size_ == 0;
+}
+
+size_t PostingListView::CountInRange(int first_slot, int last_slot) const {
+    size_t count = 0;
+    for (size_t block = FindBlock(blocks_, first_slot);
+         block < blocks_.size() && static_cast<int>(blocks_[block].first_slot) < last_slot; ++block) {
+        count += blocks_[block].size;
+    }
+    for (const Posting& posting : tail_) {
+        const int slot = static_cast<int>(posting.slot);
+        count += slot >= first_slot && slot < last_slot;
+    }
+    return count;
+}
+
+PostingListView::Cursor PostingListView::GetCursor(int first_slot, int last_slot) const {
+    return Cursor(*this, first_slot, last_slot);
+}
+
+double PostingListView::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+size_t PostingListView::FindBlock(ArrayView<PostingBlock> blocks, int slot) {
+    return std::lower_bound(blocks.begin(), blocks.end(), static_cast<uint32_t>(slot),
+        [](const PostingBlock& block, uint32_t slot) {
+            return block.last_slot < slot;
+        }) - blocks.begin();
+}
+
+size_t PostingListView::GallopToBlock(ArrayView<PostingBlock> blocks, size_t from, int slot) {
+    // intersections mostly skip a few blocks ahead, so the bound doubles
+    // from the current block before the binary search
+    size_t step = 1;
+    size_t low = from;
+    while (low + step < blocks.size() && blocks[low + step].last_slot < static_cast<uint32_t>(slot)) {
+        low += step;
+        step *= 2;
+    }
+    const size_t high = std::min(low + step + 1, blocks.size());
+    return std::lower_bound(blocks.begin() + low, blocks.begin() + high, static_cast<uint32_t>(slot),
+        [](const PostingBlock& block, uint32_t slot) {
+            return block.last_slot < slot;
+        }) - blocks.begin();
+}
+
+// Blocks of a mapped file are checked here, when they are first read: the
+// slots have to increase up to last_slot, which keeps cursors in the slots
+// of their range
+void PostingListView::DecodeBlock(const PostingBlock& info, ArrayView<uint8_t> bytes, uint32_t* slots,
+                                  uint32_t* counts) {
+    if (info.size == 0 || info.size > BLOCK_SIZE || info.offset > bytes.size() || info.first_slot > info.last_slot
+        || info.last_slot > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    const uint8_t* in = bytes.data() + info.offset;
+    const size_t available = bytes.size() - info.offset;
+    slots[0] = info.first_slot;
+    const size_t gaps_length = DecodeStreamVByteDelta(in, available, info.size - 1, info.first_slot, slots + 1);
+    DecodeStreamVByte(in + gaps_length, available - gaps_length, info.size, counts);
+    bool is_increasing = true;
+    for (size_t i = 1; i < info.size; ++i) {
+        is_increasing &= slots[i] > slots[i - 1];
+    }
+    if (!is_increasing || slots[info.size - 1] != info.last_slot) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+}
+
+void PostingList::Add(int slot, uint32_t count, double term_freq) {
+    assert(tail_.empty() || static_cast<int>(tail_.back().slot) < slot);
+    assert(!tail_.empty() || blocks_.empty() || static_cast<int>(blocks_.back().last_slot) < slot);
+    assert(blocks_.empty() || blocks_.back().size == BLOCK_SIZE);
+    tail_.push_back({static_cast<uint32_t>(slot), count});
+    ++size_;
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+    if (tail_.size() == BLOCK_SIZE) {
+        EncodeTail();
+    }
+}
+
+void PostingList::Flush() {
+    if (!tail_.empty()) {
+        EncodeTail();
+    }
+    std::vector<Posting>().swap(tail_);
+}
+
+PostingListView PostingList::GetView() const {
+    return PostingListView(GetBlocks(), GetBytes(), {tail_.data(), tail_.size()}, size_, max_term_freq_);
+}
+
+ArrayView<PostingBlock> PostingList::GetBlocks() const {
+    return {blocks_.data(), blocks_.size()};
+}
+
+ArrayView<uint8_t> PostingList::GetBytes() const {
+    return {bytes_.data(), bytes_.size()};
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+size_t PostingList::GetEncodedSize() const {
+    return bytes_.size() + blocks_.size() * sizeof(PostingBlock) + tail_.size() * sizeof(Posting);
+}
+
+void PostingList::EncodeTail() {
+    std::array<uint32_t, BLOCK_SIZE> slots;
+    std::array<uint32_t, BLOCK_SIZE> counts;
+    for (size_t i = 0; i < tail_.size(); ++i) {
+        slots[i] = tail_[i].slot;
+        counts[i] = tail_[i].count;
+    }
+    blocks_.push_back({slots.front(), slots[tail_.size() - 1], static_cast<uint32_t>(bytes_.size()),
+                       static_cast<uint32_t>(tail_.size())});
+    EncodeBlock(slots.data(), counts.data(), tail_.size(), bytes_);
+    tail_.clear();
+}
+
+void PostingList::EncodeBlock(const uint32_t* slots, const uint32_t* counts, size_t size, std::vector<uint8_t>& out) {
+    std::array<uint32_t, BLOCK_SIZE> gaps;
+    for (size_t i = 1; i < size; ++i) {
+        gaps[i - 1] = slots[i] - slots[i - 1];
+    }
+    EncodeStreamVByte(gaps.data(), size - 1, out);
+    EncodeStreamVByte(counts, size, out);
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_array.h"
+
+// At most BLOCK_SIZE postings, slot gaps and occurrence counts are
+// StreamVByte encoded at offset. Only the last block of a list may be partial.
+struct PostingBlock {
+    uint32_t first_slot;
+    uint32_t last_slot;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Posting {
+    uint32_t slot;
+    uint32_t count;
+};
+
+// Read-only postings of a single term sorted by document slot: compressed
+// blocks followed by a plain tail. The arrays belong to a PostingList or
+// to a sealed segment, possibly in a mapped index file.
+class PostingListView {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    // Forward-only walk over the postings of a slot range, decodes one block at a time
+    class Cursor {
+    public:
+        Cursor(const PostingListView& postings, int first_slot, int last_slot);
+
+        bool IsEnd() const;
+
+        int GetSlot() const;
+
+        // Occurrences of the term in the document
+        uint32_t GetCount() const;
+
+        void Next();
+
+        // Moves to the first posting with a slot not less than the given one,
+        // blocks that end before it are skipped without being decoded
+        void SkipTo(int slot);
+
+    private:
+        ArrayView<PostingBlock> blocks_;
+        ArrayView<uint8_t> bytes_;
+        ArrayView<Posting> tail_;
+        int last_slot_;
+        // index of the loaded block, the block count stands for the tail
+        size_t block_;
+        size_t size_ = 0;
+        size_t position_ = 0;
+        std::array<uint32_t, BLOCK_SIZE> slots_;
+        std::array<uint32_t, BLOCK_SIZE> counts_;
+
+        void LoadBlock(size_t block);
+
+        void SeekInBlock(int slot);
+    };
+
+    PostingListView() = default;
+
+    // Block offsets are relative to the start of bytes, which may extend
+    // past the last block: the decoder reads whole registers when it can
+    PostingListView(ArrayView<PostingBlock> blocks, ArrayView<uint8_t> bytes, ArrayView<Posting> tail,
+                    size_t size, double max_term_freq);
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Upper bound of the number of postings with slots in [first_slot, last_slot)
+    size_t CountInRange(int first_slot, int last_slot) const;
+
+    Cursor GetCursor(int first_slot, int last_slot) const;
+
+    // Upper bound of the term frequencies in the list
+    double GetMaxTermFreq() const;
+
+private:
+    ArrayView<PostingBlock> blocks_;
+    ArrayView<uint8_t> bytes_;
+    ArrayView<Posting> tail_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+
+    // First block whose last slot is not less than the given one
+    static size_t FindBlock(ArrayView<PostingBlock> blocks, int slot);
+
+    // The same, searching forward from a block known to end before the slot
+    static size_t GallopToBlock(ArrayView<PostingBlock> blocks, size_t from, int slot);
+
+    static void DecodeBlock(const PostingBlock& block, ArrayView<uint8_t> bytes, uint32_t* slots, uint32_t* counts);
+};
+
+// Postings of a single term under construction. Full blocks are
+// compressed, the newest postings stay in a plain tail until they fill one.
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = PostingListView::BLOCK_SIZE;
+
+    // Slots are handed out in increasing order, so adding is an append.
+    // term_freq only maintains the bound returned by GetMaxTermFreq.
+    void Add(int slot, uint32_t count, double term_freq);
+
+    // Compresses the tail into a partial last block, nothing can be added afterwards
+    void Flush();
+
+    PostingListView GetView() const;
+
+    ArrayView<PostingBlock> GetBlocks() const;
+
+    ArrayView<uint8_t> GetBytes() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    double GetMaxTermFreq() const;
+
+    // Bytes of the compressed blocks, their headers and the plain tail
+    size_t GetEncodedSize() const;
+
+private:
+    std::vector<PostingBlock> blocks_;
+    std::vector<uint8_t> bytes_;
+    std::vector<Posting> tail_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+
+    void EncodeTail();
+
+    static void EncodeBlock(const uint32_t* slots, const uint32_t* counts, size_t size, std::vector<uint8_t>& out);
+};
+
+// The cursor accessors run once per posting, so they are kept inline
+
+inline bool PostingListView::Cursor::IsEnd() const {
+    return position_ == size_ || static_cast<int>(slots_[position_]) >= last_slot_;
+}
+
+inline int PostingListView::Cursor::GetSlot() const {
+    return static_cast<int>(slots_[position_]);
+}
+
+inline uint32_t PostingListView::Cursor::GetCount() const {
+    return counts_[position_];
+}
+
+inline void PostingListView::Cursor::Next() {
+    ++position_;
+    if (position_ == size_ && block_ < blocks_.size()) {
+        LoadBlock(++block_);
+    }
+}
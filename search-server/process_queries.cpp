@@ -1,5 +1,10 @@
 #include "process_queries.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
@@ -14,29 +19,268 @@ std::vector<std::vector<Document>> ProcessQueries(
  
         return result;
     }
+JoinedDocuments::JoinedDocuments(std::vector<Document> documents, std::vector<size_t> offsets)
+    : documents_(std::move(documents))
+    , offsets_(std::move(offsets)) {
+}
+
+std::vector<Document>::const_iterator JoinedDocuments::begin() const {
+    return documents_.begin();
+}
+
+std::vector<Document>::const_iterator JoinedDocuments::end() const {
+    return documents_.end();
+}
+
+size_t JoinedDocuments::size() const {
+    return documents_.size();
+}
+
+bool JoinedDocuments::empty() const {
+    return documents_.empty();
+}
+
+size_t JoinedDocuments::GetQueryCount() const {
+    return offsets_.size() - 1;
+}
+
+ArrayView<Document> JoinedDocuments::GetQueryDocuments(size_t query_index) const {
+    return {documents_.data() + offsets_[query_index], offsets_[query_index + 1] - offsets_[query_index]};
+}
+
 /* набор объектов Document */
-std::list<Document> ProcessQueriesJoined(
+JoinedDocuments ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries){
-    
-        std::vector<std::list<Document>> result_;
-        result_.resize(queries.size());
-        transform(std::execution::par,
-            queries.begin(), queries.end(),
-            result_.begin(),
-            [&search_server] (const std::string& querie) {
-                std::vector<Document> it = search_server.FindTopDocuments(querie);
-                std::list<Document> puls;
-                for(auto c : it){
-                    puls.push_back(c);
+    const std::vector<std::string>& queries) {
+    // no query has more than MAX_RESULT_DOCUMENT_COUNT results, so query i
+    // can keep its results in slot i of that size until the counts are known
+    const size_t max_count = static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<Document> slots(queries.size() * max_count);
+    std::vector<size_t> counts(queries.size());
+    std::vector<size_t> query_indexes(queries.size());
+    std::iota(query_indexes.begin(), query_indexes.end(), 0);
+    std::for_each(std::execution::par, query_indexes.begin(), query_indexes.end(), [&](size_t query_index) {
+        const std::vector<Document> found = search_server.FindTopDocuments(queries[query_index]);
+        std::copy(found.begin(), found.end(), slots.begin() + query_index * max_count);
+        counts[query_index] = found.size();
+    });
+
+    std::vector<size_t> offsets(queries.size() + 1, 0);
+    std::exclusive_scan(std::execution::par, counts.begin(), counts.end(), offsets.begin(), size_t{0});
+    if (!queries.empty()) {
+        offsets.back() = offsets[queries.size() - 1] + counts.back();
+    }
+    std::vector<Document> documents(offsets.back());
+    std::for_each(std::execution::par, query_indexes.begin(), query_indexes.end(), [&](size_t query_index) {
+        const auto slot = slots.begin() + query_index * max_count;
+        std::copy(slot, slot + counts[query_index], documents.begin() + offsets[query_index]);
+    });
+    return JoinedDocuments(std::move(documents), std::move(offsets));
+}
+
+namespace {
+
+struct QueryTask {
+    size_t index;
+    std::string query;
+};
+
+struct QueryResult {
+    std::string query;
+    std::vector<Document> documents;
+    bool is_ready = false;
+};
+
+class QueryStreamExecutor {
+public:
+    QueryStreamExecutor(const SearchServer& search_server, const std::function<bool(std::string&)>& read_query,
+                        const QueryStreamOptions& options)
+        : search_server_(search_server)
+        , read_query_(read_query)
+        , batch_size_(std::max<size_t>(options.batch_size, 1))
+        , workers_(std::max<size_t>(options.thread_count, 1))
+        , window_(std::max<size_t>(options.max_pending_queries, 1)) {
+    }
+
+    void Run(const std::function<void(const std::string&, std::vector<Document>)>& consume) {
+        std::vector<std::thread> threads;
+        for (size_t worker = 0; worker < workers_.size(); ++worker) {
+            threads.emplace_back([this, worker] {
+                RunWorker(worker);
+            });
+        }
+        try {
+            QueryResult result;
+            while (TakeNextResult(result)) {
+                consume(result.query, std::move(result.documents));
+            }
+        } catch (...) {
+            Stop(std::current_exception());
+        }
+        Stop(nullptr);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<QueryTask> tasks;
+    };
+
+    const SearchServer& search_server_;
+    const std::function<bool(std::string&)>& read_query_;
+    const size_t batch_size_;
+    std::vector<Worker> workers_;
+
+    // guards everything below and the input
+    std::mutex mutex_;
+    std::condition_variable worker_condition_;
+    std::condition_variable consumer_condition_;
+    // result of query i is in window_[i % window_.size()] until it is consumed
+    std::vector<QueryResult> window_;
+    size_t read_count_ = 0;
+    size_t consumed_count_ = 0;
+    bool is_input_finished_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr error_;
+
+    void RunWorker(size_t worker) {
+        QueryTask task;
+        try {
+            while (TakeTask(worker, task)) {
+                std::vector<Document> documents = search_server_.FindTopDocuments(task.query);
+                std::lock_guard guard(mutex_);
+                window_[task.index % window_.size()] = {std::move(task.query), std::move(documents), true};
+                if (task.index == consumed_count_) {
+                    consumer_condition_.notify_one();
                 }
-                return puls;
+            }
+        } catch (...) {
+            Stop(std::current_exception());
+        }
+    }
+
+    bool TakeTask(size_t worker, QueryTask& task) {
+        while (true) {
+            if (PopFront(workers_[worker], task) || Steal(worker, task)) {
+                return true;
+            }
+            std::unique_lock lock(mutex_);
+            worker_condition_.wait(lock, [this] {
+                return is_stopping_ || is_input_finished_ || read_count_ < consumed_count_ + window_.size();
             });
-    
-    std::list<Document> result;
-        for(auto c : result_){
-            result.splice(result.end(), std::move(c));
+            if (is_stopping_) {
+                return false;
+            }
+            if (is_input_finished_) {
+                // the queues only shrink now, the other threads finish what is left in them
+                lock.unlock();
+                return Steal(worker, task);
+            }
+            ReadBatch(workers_[worker]);
         }
- 
-        return result;
-}
\ No newline at end of file
+    }
+
+    // Called with mutex_ held
+    void ReadBatch(Worker& worker) {
+        const size_t count = std::min(batch_size_, consumed_count_ + window_.size() - read_count_);
+        std::vector<QueryTask> batch;
+        std::string query;
+        while (batch.size() < count && read_query_(query)) {
+            batch.push_back({read_count_++, std::move(query)});
+        }
+        if (batch.size() < count) {
+            is_input_finished_ = true;
+            worker_condition_.notify_all();
+            consumer_condition_.notify_one();
+        }
+        std::lock_guard guard(worker.mutex);
+        std::move(batch.begin(), batch.end(), std::back_inserter(worker.tasks));
+    }
+
+    static bool PopFront(Worker& worker, QueryTask& task) {
+        std::lock_guard guard(worker.mutex);
+        if (worker.tasks.empty()) {
+            return false;
+        }
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        return true;
+    }
+
+    // Moves the back half of another thread's queue to this one
+    bool Steal(size_t thief, QueryTask& task) {
+        for (size_t offset = 1; offset < workers_.size(); ++offset) {
+            Worker& victim = workers_[(thief + offset) % workers_.size()];
+            std::deque<QueryTask> stolen;
+            {
+                std::lock_guard guard(victim.mutex);
+                const size_t count = (victim.tasks.size() + 1) / 2;
+                const auto first = victim.tasks.end() - static_cast<std::ptrdiff_t>(count);
+                std::move(first, victim.tasks.end(), std::back_inserter(stolen));
+                victim.tasks.erase(first, victim.tasks.end());
+            }
+            if (stolen.empty()) {
+                continue;
+            }
+            task = std::move(stolen.front());
+            stolen.pop_front();
+            Worker& worker = workers_[thief];
+            std::lock_guard guard(worker.mutex);
+            std::move(stolen.begin(), stolen.end(), std::back_inserter(worker.tasks));
+            return true;
+        }
+        return false;
+    }
+
+    bool TakeNextResult(QueryResult& result) {
+        std::unique_lock lock(mutex_);
+        QueryResult& next = window_[consumed_count_ % window_.size()];
+        consumer_condition_.wait(lock, [&] {
+            return next.is_ready || is_stopping_ || (is_input_finished_ && consumed_count_ == read_count_);
+        });
+        if (is_stopping_ || !next.is_ready) {
+            return false;
+        }
+        result = std::move(next);
+        next.is_ready = false;
+        ++consumed_count_;
+        worker_condition_.notify_all();
+        return true;
+    }
+
+    void Stop(std::exception_ptr error) {
+        std::lock_guard guard(mutex_);
+        if (error && !error_) {
+            error_ = error;
+        }
+        is_stopping_ = true;
+        worker_condition_.notify_all();
+        consumer_condition_.notify_one();
+    }
+};
+
+}  // namespace
+
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    const std::function<bool(std::string& query)>& read_query,
+    const std::function<void(const std::string& query, std::vector<Document> documents)>& consume,
+    const QueryStreamOptions& options) {
+    QueryStreamExecutor(search_server, read_query, options).Run(consume);
+}
+
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    std::istream& input,
+    const std::function<void(const std::string& query, std::vector<Document> documents)>& consume,
+    const QueryStreamOptions& options) {
+    ProcessQueriesStream(search_server, [&input](std::string& query) {
+        return static_cast<bool>(std::getline(input, query));
+    }, consume, options);
+}
@@ -6,15 +6,95 @@
 #include <algorithm>
 #include <numeric>
 #include <functional>
-#include <list>
+#include <istream>
+#include <thread>
 
 #include "document.h"
+#include "flat_array.h"
 #include "search_server.h"
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(
+// Results of all queries one after another in a single array,
+// iterated like the list ProcessQueriesJoined used to return
+class JoinedDocuments {
+public:
+    JoinedDocuments() = default;
+
+    // offsets has one more element than there are queries, the results of
+    // query i are documents[offsets[i], offsets[i + 1])
+    JoinedDocuments(std::vector<Document> documents, std::vector<size_t> offsets);
+
+    std::vector<Document>::const_iterator begin() const;
+
+    std::vector<Document>::const_iterator end() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    size_t GetQueryCount() const;
+
+    ArrayView<Document> GetQueryDocuments(size_t query_index) const;
+
+private:
+    std::vector<Document> documents_;
+    std::vector<size_t> offsets_ = {0};
+};
+
+// Each thread copies the results of its queries into a fixed-size slot,
+// then a parallel prefix sum of the result counts gives every query its
+// offset in the joined array and the slots are copied there in parallel
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+struct QueryStreamOptions {
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // queries read but not yet consumed, bounds the memory of a stream
+    size_t max_pending_queries = 4096;
+    // queries a thread takes from the input at once
+    size_t batch_size = 16;
+};
+
+// Searches the queries read_query produces until it returns false and passes
+// the results to consume on the calling thread, in the order of the queries.
+// Reading stops while max_pending_queries are ahead of consume, so a slow
+// consumer holds back the input. The first exception thrown by read_query,
+// a search or consume stops the stream and is rethrown.
+//
+// Threads take batches of queries into their own queues; one that runs out
+// of input steals half of another's queue, so slow queries do not leave the
+// rest of the threads idle. Each call starts its own threads, because the
+// workers block on the window and the pool of the parallel algorithms must
+// not; for queries that fit in memory ProcessQueries costs less.
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    const std::function<bool(std::string& query)>& read_query,
+    const std::function<void(const std::string& query, std::vector<Document> documents)>& consume,
+    const QueryStreamOptions& options = {});
+
+// One query per line of input
+void ProcessQueriesStream(
+    const SearchServer& search_server,
+    std::istream& input,
+    const std::function<void(const std::string& query, std::vector<Document> documents)>& consume,
+    const QueryStreamOptions& options = {});
+
+template <typename QueryIterator>
+void ProcessQueriesStream(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries); 
\ No newline at end of file
+    QueryIterator first, QueryIterator last,
+    const std::function<void(const std::string& query, std::vector<Document> documents)>& consume,
+    const QueryStreamOptions& options = {}) {
+    ProcessQueriesStream(search_server, [&first, last](std::string& query) {
+        if (first == last) {
+            return false;
+        }
+        query = *first;
+        ++first;
+        return true;
+    }, consume, options);
+}
@@ -0,0 +1,188 @@
+#include "query_iterator.h"
+
+#include <algorithm>
+
+QueryIterator::QueryIterator(const QueryPlanNode& node, const Segment& segment, int first_slot, int last_slot)
+    : node_(&node)
+    , segment_(&segment)
+    , last_slot_(last_slot) {
+    if (node.type == QueryNode::Type::WORD) {
+        const PostingListView postings = segment.FindPostings(node.term_ids.front());
+        cost_ = postings.CountInRange(first_slot, last_slot);
+        cursor_.emplace(postings.GetCursor(first_slot, last_slot));
+        is_end_ = cursor_->IsEnd();
+        slot_ = is_end_ ? last_slot : cursor_->GetSlot();
+        return;
+    }
+    children_.reserve(node.children.size());
+    for (const QueryPlanNode& child : node.children) {
+        children_.emplace_back(child, segment, first_slot, last_slot);
+    }
+    if (node.type == QueryNode::Type::OR) {
+        for (const QueryIterator& child : children_) {
+            cost_ += child.cost_;
+        }
+        Unite();
+        return;
+    }
+    std::sort(children_.begin(), children_.end(), [](const QueryIterator& lhs, const QueryIterator& rhs) {
+        return lhs.cost_ < rhs.cost_;
+    });
+    cost_ = children_.empty() ? 0 : children_.front().cost_;
+    Intersect();
+}
+
+void QueryIterator::Next() {
+    if (is_end_) {
+        return;
+    }
+    if (cursor_) {
+        cursor_->Next();
+        is_end_ = cursor_->IsEnd();
+        slot_ = is_end_ ? last_slot_ : cursor_->GetSlot();
+        return;
+    }
+    if (node_->type == QueryNode::Type::OR) {
+        for (QueryIterator& child : children_) {
+            if (!child.IsEnd() && child.GetSlot() == slot_) {
+                child.Next();
+            }
+        }
+        Unite();
+        return;
+    }
+    children_.front().Next();
+    Intersect();
+}
+
+void QueryIterator::SkipTo(int slot) {
+    if (is_end_ || slot_ >= slot) {
+        return;
+    }
+    if (cursor_) {
+        cursor_->SkipTo(slot);
+        is_end_ = cursor_->IsEnd();
+        slot_ = is_end_ ? last_slot_ : cursor_->GetSlot();
+        return;
+    }
+    if (node_->type == QueryNode::Type::OR) {
+        for (QueryIterator& child : children_) {
+            child.SkipTo(slot);
+        }
+        Unite();
+        return;
+    }
+    children_.front().SkipTo(slot);
+    Intersect();
+}
+
+size_t QueryIterator::GetCost() const {
+    return cost_;
+}
+
+void QueryIterator::Intersect() {
+    if (children_.empty()) {
+        is_end_ = true;
+        return;
+    }
+    QueryIterator& lead = children_.front();
+    while (!lead.IsEnd()) {
+        const int candidate = lead.GetSlot();
+        bool is_agreed = true;
+        for (size_t i = 1; i < children_.size(); ++i) {
+            QueryIterator& child = children_[i];
+            child.SkipTo(candidate);
+            if (child.IsEnd()) {
+                is_end_ = true;
+                slot_ = last_slot_;
+                return;
+            }
+            if (child.GetSlot() > candidate) {
+                lead.SkipTo(child.GetSlot());
+                is_agreed = false;
+                break;
+            }
+        }
+        if (!is_agreed) {
+            continue;
+        }
+        if (CheckPositions(candidate)) {
+            slot_ = candidate;
+            return;
+        }
+        lead.Next();
+    }
+    is_end_ = true;
+    slot_ = last_slot_;
+}
+
+void QueryIterator::Unite() {
+    is_end_ = true;
+    slot_ = last_slot_;
+    for (const QueryIterator& child : children_) {
+        if (!child.IsEnd() && child.GetSlot() < slot_) {
+            slot_ = child.GetSlot();
+            is_end_ = false;
+        }
+    }
+}
+
+bool QueryIterator::CheckPositions(int slot) const {
+    if (node_->type != QueryNode::Type::PHRASE && node_->type != QueryNode::Type::NEAR) {
+        return true;
+    }
+    // kept between calls, a query checks many documents
+    thread_local std::vector<std::pair<uint32_t, uint32_t>> spans;
+    if (node_->type == QueryNode::Type::PHRASE) {
+        FindWordSpans(*node_, *segment_, slot, spans);
+        return !spans.empty();
+    }
+    thread_local std::vector<std::pair<uint32_t, uint32_t>> other_spans;
+    FindWordSpans(node_->children[0], *segment_, slot, spans);
+    FindWordSpans(node_->children[1], *segment_, slot, other_spans);
+    if (spans.empty() || other_spans.empty()) {
+        return false;
+    }
+    // spans of one word or phrase have the same length and increasing starts, so the
+    // candidates for a span start from the first other span that does not end too far
+    // before it. An occurrence cannot be near itself: the spans must not overlap, which
+    // matters when both operands share a word.
+    const int64_t distance = node_->distance;
+    const int64_t other_length = other_spans.front().second - other_spans.front().first;
+    for (const auto& [first, last] : spans) {
+        const int64_t lowest_first = static_cast<int64_t>(first) - distance - other_length;
+        auto other = std::lower_bound(other_spans.begin(), other_spans.end(), lowest_first,
+            [](const std::pair<uint32_t, uint32_t>& span, int64_t position) {
+                return static_cast<int64_t>(span.first) < position;
+            });
+        for (; other != other_spans.end() && static_cast<int64_t>(other->first) <= static_cast<int64_t>(last) + distance;
+             ++other) {
+            if (other->first > last || other->second < first) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void FindWordSpans(const QueryPlanNode& node, const Segment& segment, int slot,
+                   std::vector<std::pair<uint32_t, uint32_t>>& spans) {
+    spans.clear();
+    const ArrayView<uint32_t> first_positions = segment.GetWordPositions(slot, node.term_ids.front());
+    if (node.type == QueryNode::Type::WORD) {
+        for (const uint32_t position : first_positions) {
+            spans.emplace_back(position, position);
+        }
+        return;
+    }
+    for (const uint32_t position : first_positions) {
+        bool is_found = true;
+        for (size_t i = 1; i < node.term_ids.size() && is_found; ++i) {
+            const ArrayView<uint32_t> positions = segment.GetWordPositions(slot, node.term_ids[i]);
+            is_found = std::binary_search(positions.begin(), positions.end(), position + node.offsets[i]);
+        }
+        if (is_found) {
+            spans.emplace_back(position, position + node.offsets.back());
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "boolean_query.h"
+#include "posting_list.h"
+#include "segment.h"
+
+// A boolean query with its words resolved to the term ids of an index.
+// Nodes that cannot match anything are dropped while compiling, so every
+// term here is in the index.
+struct QueryPlanNode {
+    QueryNode::Type type;
+    // WORD has one, PHRASE several, with the offsets of the query node
+    std::vector<int> term_ids;
+    std::vector<uint32_t> offsets;
+    uint32_t distance = 0;
+    // a PHRASE has a WORD child for each of its terms to walk the postings with
+    std::vector<QueryPlanNode> children;
+};
+
+// Walks the slots of [first_slot, last_slot) of a segment that match the
+// plan, in increasing order. Intersections move the child expected to
+// match least first and skip the others to its slot, whole blocks of
+// postings at a time; phrases and NEAR check the word positions of the
+// documents all their words are in.
+class QueryIterator {
+public:
+    QueryIterator(const QueryPlanNode& node, const Segment& segment, int first_slot, int last_slot);
+
+    bool IsEnd() const;
+
+    int GetSlot() const;
+
+    void Next();
+
+    // Moves to the first match with a slot not less than the given one
+    void SkipTo(int slot);
+
+    // Upper bound of the number of matches
+    size_t GetCost() const;
+
+private:
+    const QueryPlanNode* node_;
+    const Segment* segment_;
+    int last_slot_;
+    std::optional<PostingListView::Cursor> cursor_;
+    // cheapest first for AND, PHRASE and NEAR
+    std::vector<QueryIterator> children_;
+    size_t cost_ = 0;
+    int slot_ = 0;
+    bool is_end_ = false;
+
+    // Moves the intersection forward until all children agree on a slot
+    // that passes the position check
+    void Intersect();
+
+    // Smallest slot of the children of OR
+    void Unite();
+
+    bool CheckPositions(int slot) const;
+};
+
+// Spans [first, last] of positions where a word or phrase occurs in the document
+void FindWordSpans(const QueryPlanNode& node, const Segment& segment, int slot,
+                   std::vector<std::pair<uint32_t, uint32_t>>& spans);
+
+inline bool QueryIterator::IsEnd() const {
+    return is_end_;
+}
+
+inline int QueryIterator::GetSlot() const {
+    return slot_;
+}
@@ -2,19 +2,165 @@
 
 #include "remove_duplicates.h"
 
-void RemoveDuplicates(SearchServer& search_server){
-    std::vector<int> ids_to_delete;
-    std::set<std::map<std::string, double>> not_to_delete;
-    for(const int document_id : search_server){
-        auto element = search_server.GetWordFrequencies(document_id);
-        if(not_to_delete.count(element)){
-            ids_to_delete.push_back(document_id);
-        } else {
-            not_to_delete.insert(element);
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+const size_t MIN_HASH_COUNT = 128;
+
+using MinHashSignature = std::array<uint32_t, MIN_HASH_COUNT>;
+
+// Bands of rows signature values, documents with an equal band become candidates
+struct LshBands {
+    size_t band_count;
+    size_t row_count;
+};
+
+// The longest bands that still make a pair with exactly the threshold
+// similarity a candidate with probability 0.99, longer bands give fewer
+// false candidates
+LshBands ChooseBands(double jaccard_threshold) {
+    LshBands bands{MIN_HASH_COUNT, 1};
+    for (size_t row_count = 2; row_count <= MIN_HASH_COUNT; ++row_count) {
+        const size_t band_count = MIN_HASH_COUNT / row_count;
+        const double miss = std::pow(1.0 - std::pow(jaccard_threshold, row_count), band_count);
+        if (miss > 0.01) {
+            break;
         }
+        bands = {band_count, row_count};
     }
-    for(auto value : ids_to_delete){
-        std::cout << "Found duplicate document id " << value << std::endl;
-        search_server.RemoveDocument(value);
+    return bands;
+}
+
+// Hash function i maps a word hash x to the high half of a * x + b
+struct MinHashFunction {
+    uint64_t multiplier;
+    uint64_t addend;
+};
+
+const std::array<MinHashFunction, MIN_HASH_COUNT>& GetMinHashFunctions() {
+    static const auto functions = [] {
+        std::array<MinHashFunction, MIN_HASH_COUNT> functions;
+        for (size_t i = 0; i < MIN_HASH_COUNT; ++i) {
+            const std::string_view seed = "minhash";
+            functions[i] = {HashWord(seed, 2 * i) | 1, HashWord(seed, 2 * i + 1)};
+        }
+        return functions;
+    }();
+    return functions;
+}
+
+MinHashSignature ComputeSignature(const SearchServer& search_server, int document_id) {
+    const auto& functions = GetMinHashFunctions();
+    MinHashSignature signature;
+    signature.fill(std::numeric_limits<uint32_t>::max());
+    search_server.ForEachDocumentWord(document_id, [&](std::string_view word) {
+        const uint64_t hash = HashWord(word);
+        for (size_t i = 0; i < MIN_HASH_COUNT; ++i) {
+            const auto value = static_cast<uint32_t>((functions[i].multiplier * hash + functions[i].addend) >> 32);
+            signature[i] = std::min(signature[i], value);
+        }
+    });
+    return signature;
+}
+
+double EstimateSimilarity(const MinHashSignature& lhs, const MinHashSignature& rhs) {
+    size_t equal_count = 0;
+    for (size_t i = 0; i < MIN_HASH_COUNT; ++i) {
+        equal_count += lhs[i] == rhs[i];
     }
-}
\ No newline at end of file
+    return static_cast<double>(equal_count) / MIN_HASH_COUNT;
+}
+
+uint64_t HashBand(const MinHashSignature& signature, size_t band, size_t row_count) {
+    uint64_t hash = band;
+    for (size_t i = band * row_count; i < (band + 1) * row_count; ++i) {
+        hash = (hash ^ signature[i]) * 0x9e3779b97f4a7c15ull;
+    }
+    return hash;
+}
+
+void RemoveDocuments(SearchServer& search_server, const std::vector<int>& document_ids, bool print_removed) {
+    for (const int document_id : document_ids) {
+        if (print_removed) {
+            std::cout << "Found duplicate document id " << document_id << std::endl;
+        }
+        search_server.RemoveDocument(document_id);
+    }
+}
+
+}
+
+std::vector<int> FindDuplicates(const SearchServer& search_server) {
+    std::vector<int> duplicate_ids;
+    std::unordered_set<WordSetFingerprint, WordSetFingerprintHasher> fingerprints;
+    // ids are visited in increasing order, so the lowest one of a group is kept
+    for (const int document_id : search_server) {
+        if (!fingerprints.insert(search_server.GetWordSetFingerprint(document_id)).second) {
+            duplicate_ids.push_back(document_id);
+        }
+    }
+    return duplicate_ids;
+}
+
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double jaccard_threshold) {
+    if (!(jaccard_threshold > 0.0 && jaccard_threshold <= 1.0)) {
+        throw std::invalid_argument("Jaccard threshold must be in (0, 1]");
+    }
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<MinHashSignature> signatures(document_ids.size());
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), signatures.begin(),
+        [&search_server](int document_id) {
+            return ComputeSignature(search_server, document_id);
+        });
+
+    // (band hash, document index) of every band, sorted so that a bucket is a run
+    const LshBands bands = ChooseBands(jaccard_threshold);
+    std::vector<std::vector<std::pair<uint64_t, size_t>>> buckets(bands.band_count);
+    std::vector<size_t> band_indexes(bands.band_count);
+    std::iota(band_indexes.begin(), band_indexes.end(), 0);
+    std::for_each(std::execution::par, band_indexes.begin(), band_indexes.end(), [&](size_t band) {
+        auto& band_buckets = buckets[band];
+        band_buckets.reserve(signatures.size());
+        for (size_t i = 0; i < signatures.size(); ++i) {
+            band_buckets.emplace_back(HashBand(signatures[i], band, bands.row_count), i);
+        }
+        std::sort(band_buckets.begin(), band_buckets.end());
+    });
+
+    // A document is a duplicate when it is similar to a kept one with a lower id
+    std::vector<bool> is_duplicate(document_ids.size(), false);
+    std::vector<int> duplicate_ids;
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        for (size_t band = 0; band < bands.band_count && !is_duplicate[i]; ++band) {
+            const auto& band_buckets = buckets[band];
+            const uint64_t hash = HashBand(signatures[i], band, bands.row_count);
+            for (auto it = std::lower_bound(band_buckets.begin(), band_buckets.end(), std::pair{hash, size_t{0}});
+                 it != band_buckets.end() && it->first == hash && it->second < i; ++it) {
+                if (!is_duplicate[it->second]
+                    && EstimateSimilarity(signatures[i], signatures[it->second]) >= jaccard_threshold) {
+                    is_duplicate[i] = true;
+                    duplicate_ids.push_back(document_ids[i]);
+                    break;
+                }
+            }
+        }
+    }
+    return duplicate_ids;
+}
+
+void RemoveDuplicates(SearchServer& search_server, bool print_removed) {
+    RemoveDocuments(search_server, FindDuplicates(search_server), print_removed);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold, bool print_removed) {
+    RemoveDocuments(search_server, FindNearDuplicates(search_server, jaccard_threshold), print_removed);
+}
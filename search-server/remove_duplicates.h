@@ -1,9 +1,18 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #pragma once
 #include <vector>
-#include <set>
-#include <deque>
 
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+// Ids of the documents with the same set of words as a document with a
+// lower id, found by comparing word set fingerprints in a hash set
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+// Ids of the documents whose word sets are at least jaccard_threshold
+// similar to a kept document with a lower id. The similarity is estimated
+// from MinHash signatures, only documents sharing an LSH bucket are compared.
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double jaccard_threshold);
+
+void RemoveDuplicates(SearchServer& search_server, bool print_removed = true);
+
+void RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold, bool print_removed = true);
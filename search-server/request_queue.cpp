@@ -1,38 +1,35 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <execution>
+
 RequestQueue::RequestQueue(const SearchServer& search_server)
-    : search_server_(search_server)
-    , no_results_requests_(0)
-    , current_time_(0) {
+    : search_server_(search_server) {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
-    return result;
+    return Find([&] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
 }
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
-    return result;
+    return Find([&] {
+        return search_server_.FindTopDocuments(raw_query);
+    });
+}
+
+std::vector<std::vector<Document>> RequestQueue::ProcessQueries(const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> results(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), results.begin(), [this](const std::string& query) {
+        return AddFindRequest(query);
+    });
+    return results;
 }
+
 int RequestQueue::GetNoResultRequests() const {
-    return no_results_requests_;
+    return static_cast<int>(GetStats(RequestStats::MAX_WINDOW).no_result_count);
 }
 
-void RequestQueue::AddRequest(int results_num) {
-    // новый запрос - новая секунда
-    ++current_time_;
-    // удаляем все результаты поиска, которые устарели
-    while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-        if (0 == requests_.front().results) {
-            --no_results_requests_;
-        }
-        requests_.pop_front();
-    }
-    // сохраняем новый результат поиска
-    requests_.push_back({current_time_, results_num});
-    if (0 == results_num) {
-        ++no_results_requests_;
-    }
-}
\ No newline at end of file
+RequestStats::WindowStats RequestQueue::GetStats(std::chrono::minutes window) const {
+    return stats_.GetWindowStats(window);
+}
@@ -1,10 +1,13 @@
 #pragma once
+#include <chrono>
+#include <string>
 #include <vector>
-#include <set>
-#include <deque>
 
+#include "request_stats.h"
 #include "search_server.h"
 
+// Searches a SearchServer and keeps statistics of the requests over real
+// time. Any number of threads can search through one queue at once.
 class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server);
@@ -17,25 +20,36 @@ public:
     
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     
+    // Searches the queries in parallel, like ProcessQueries, recording each
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries);
+    
+    // Requests of the last day that found nothing
     int GetNoResultRequests() const;
     
+    // Rate, zero result share, result counts and latencies of the requests
+    // of the last window, 1, 5 and 1440 minutes being the usual ones
+    RequestStats::WindowStats GetStats(std::chrono::minutes window) const;
+    
 private:
-    struct QueryResult {
-        uint64_t timestamp;
-        int results;
-    };
-    std::deque<QueryResult> requests_;
     const SearchServer& search_server_;
-    int no_results_requests_;
-    uint64_t current_time_;
-    const static int min_in_day_ = 1440;
- 
-    void AddRequest(int results_num);
+    RequestStats stats_;
+    
+    template <typename Search>
+    std::vector<Document> Find(Search search);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    return Find([&] {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    });
+}
+
+template <typename Search>
+std::vector<Document> RequestQueue::Find(Search search) {
+    const auto start_time = RequestStats::Clock::now();
+    auto result = search();
+    const auto end_time = RequestStats::Clock::now();
+    stats_.Record(result.size(), end_time - start_time, end_time);
     return result;
-}
\ No newline at end of file
+}
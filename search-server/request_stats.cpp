@@ -0,0 +1,191 @@
+#include "request_stats.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std::string_literals;
+
+namespace {
+
+// latencies below 4 ns are exact, then 4 buckets per power of two
+constexpr size_t LATENCY_SUB_BUCKET_BITS = 2;
+constexpr size_t LATENCY_SUB_BUCKET_COUNT = size_t{1} << LATENCY_SUB_BUCKET_BITS;
+constexpr size_t EXACT_RESULT_COUNTS = 8;
+
+// the windows that are counted by the second
+constexpr std::chrono::minutes MAX_SECONDS_WINDOW{5};
+
+}  // namespace
+
+RequestStats::Ring::Ring(Clock::duration period_duration, size_t size)
+    : period_duration(period_duration)
+    , slots(size) {
+}
+
+RequestStats::RequestStats(Clock::time_point start_time)
+    : start_time_(start_time)
+    , seconds_(std::chrono::seconds(1), std::chrono::seconds(MAX_SECONDS_WINDOW).count())
+    , minutes_(std::chrono::minutes(1), MAX_WINDOW.count()) {
+}
+
+void RequestStats::Record(size_t result_count, Clock::duration latency, Clock::time_point now) {
+    const size_t result_count_bucket = GetResultCountBucket(result_count);
+    const auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    const size_t latency_bucket = GetLatencyBucket(static_cast<uint64_t>(std::max<int64_t>(latency_ns, 0)));
+    for (Ring* ring : {&seconds_, &minutes_}) {
+        if (Slot* slot = AcquireSlot(*ring, GetPeriod(*ring, now))) {
+            AddToSlot(*slot, result_count_bucket, latency_bucket, result_count > 0);
+        }
+    }
+}
+
+RequestStats::WindowStats RequestStats::GetWindowStats(std::chrono::minutes window, Clock::time_point now) const {
+    if (window.count() <= 0 || window > MAX_WINDOW) {
+        throw std::invalid_argument("Window has to be from 1 to "s + std::to_string(MAX_WINDOW.count()) + " minutes"s);
+    }
+    const Ring& ring = window <= MAX_SECONDS_WINDOW ? seconds_ : minutes_;
+    const int64_t last_period = GetPeriod(ring, now);
+    const int64_t period_count = window / ring.period_duration;
+    Totals totals;
+    AddSlots(ring, std::max<int64_t>(0, last_period - period_count + 1), last_period, totals);
+
+    WindowStats stats;
+    stats.window = window;
+    stats.request_count = totals.request_count;
+    stats.no_result_count = totals.no_result_count;
+    stats.result_counts = totals.result_counts;
+    const std::chrono::duration<double> covered = std::min<Clock::duration>(window, std::max(now - start_time_,
+                                                                                              Clock::duration(1)));
+    stats.queries_per_second = totals.request_count / covered.count();
+    stats.no_result_rate = totals.request_count > 0
+                         ? static_cast<double>(totals.no_result_count) / totals.request_count : 0.0;
+    stats.latency_p50 = GetLatencyQuantile(totals, 0.5);
+    stats.latency_p90 = GetLatencyQuantile(totals, 0.9);
+    stats.latency_p99 = GetLatencyQuantile(totals, 0.99);
+    return stats;
+}
+
+size_t RequestStats::GetResultCountBucket(size_t result_count) {
+    if (result_count < EXACT_RESULT_COUNTS) {
+        return result_count;
+    }
+    // 8-15 is bucket 8, 16-31 bucket 9 and so on
+    const size_t exponent = 63 - __builtin_clzll(result_count);
+    return std::min(exponent + 5, RESULT_COUNT_BUCKET_COUNT - 1);
+}
+
+size_t RequestStats::GetResultCountLowerBound(size_t bucket) {
+    return bucket < EXACT_RESULT_COUNTS ? bucket : size_t{1} << (bucket - 5);
+}
+
+int64_t RequestStats::GetPeriod(const Ring& ring, Clock::time_point now) const {
+    return std::max<int64_t>(0, (now - start_time_) / ring.period_duration);
+}
+
+RequestStats::Slot* RequestStats::AcquireSlot(Ring& ring, int64_t period) {
+    Slot& slot = ring.slots[period % ring.slots.size()];
+    int64_t current = slot.period.load(std::memory_order_acquire);
+    while (current != period) {
+        if (current > period) {
+            return nullptr;
+        }
+        if (current == RESETTING) {
+            // another thread is clearing the slot for a new period
+            std::this_thread::yield();
+            current = slot.period.load(std::memory_order_acquire);
+            continue;
+        }
+        if (slot.period.compare_exchange_weak(current, RESETTING, std::memory_order_acquire)) {
+            slot.request_count.store(0, std::memory_order_relaxed);
+            slot.no_result_count.store(0, std::memory_order_relaxed);
+            for (auto& count : slot.result_counts) {
+                count.store(0, std::memory_order_relaxed);
+            }
+            for (auto& count : slot.latencies) {
+                count.store(0, std::memory_order_relaxed);
+            }
+            slot.period.store(period, std::memory_order_release);
+            break;
+        }
+    }
+    return &slot;
+}
+
+void RequestStats::AddToSlot(Slot& slot, size_t result_count_bucket, size_t latency_bucket, bool has_results) {
+    slot.request_count.fetch_add(1, std::memory_order_relaxed);
+    if (!has_results) {
+        slot.no_result_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot.result_counts[result_count_bucket].fetch_add(1, std::memory_order_relaxed);
+    slot.latencies[latency_bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RequestStats::AddSlots(const Ring& ring, int64_t first_period, int64_t last_period, Totals& totals) {
+    Totals slot_totals;
+    for (int64_t period = first_period; period <= last_period; ++period) {
+        const Slot& slot = ring.slots[period % ring.slots.size()];
+        if (slot.period.load(std::memory_order_acquire) != period) {
+            continue;
+        }
+        slot_totals.request_count = slot.request_count.load(std::memory_order_relaxed);
+        slot_totals.no_result_count = slot.no_result_count.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < RESULT_COUNT_BUCKET_COUNT; ++i) {
+            slot_totals.result_counts[i] = slot.result_counts[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            slot_totals.latencies[i] = slot.latencies[i].load(std::memory_order_relaxed);
+        }
+        // the counters read are of period only if the slot was not reset meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.period.load(std::memory_order_relaxed) != period) {
+            continue;
+        }
+        totals.request_count += slot_totals.request_count;
+        totals.no_result_count += slot_totals.no_result_count;
+        for (size_t i = 0; i < RESULT_COUNT_BUCKET_COUNT; ++i) {
+            totals.result_counts[i] += slot_totals.result_counts[i];
+        }
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            totals.latencies[i] += slot_totals.latencies[i];
+        }
+    }
+}
+
+size_t RequestStats::GetLatencyBucket(uint64_t latency_ns) {
+    if (latency_ns < LATENCY_SUB_BUCKET_COUNT) {
+        return latency_ns;
+    }
+    const size_t exponent = 63 - __builtin_clzll(latency_ns);
+    const size_t sub_bucket = (latency_ns >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKET_COUNT - 1);
+    return std::min((exponent - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKET_COUNT + sub_bucket,
+                    LATENCY_BUCKET_COUNT - 1);
+}
+
+uint64_t RequestStats::GetLatencyLowerBound(size_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const size_t exponent = bucket / LATENCY_SUB_BUCKET_COUNT + LATENCY_SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = bucket % LATENCY_SUB_BUCKET_COUNT;
+    return (LATENCY_SUB_BUCKET_COUNT + sub_bucket) << (exponent - LATENCY_SUB_BUCKET_BITS);
+}
+
+std::chrono::nanoseconds RequestStats::GetLatencyQuantile(const Totals& totals, double q) {
+    if (totals.request_count == 0) {
+        return {};
+    }
+    const auto rank = static_cast<uint64_t>(q * (totals.request_count - 1));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+        seen += totals.latencies[bucket];
+        if (seen > rank) {
+            // the middle of the bucket
+            const uint64_t lower = GetLatencyLowerBound(bucket);
+            const uint64_t upper = bucket + 1 < LATENCY_BUCKET_COUNT ? GetLatencyLowerBound(bucket + 1) : lower;
+            return std::chrono::nanoseconds(lower + (upper - lower) / 2);
+        }
+    }
+    return std::chrono::nanoseconds(GetLatencyLowerBound(LATENCY_BUCKET_COUNT - 1));
+}
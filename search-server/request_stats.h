@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Request rate, result counts and latencies over sliding windows of real
+// time, up to a day. Records land in ring buffers of time slots, one slot
+// per second for the last five minutes and one per minute for the last
+// day. Any number of threads record at once without locks: they add to
+// the atomic counters of the current slot, and the first thread of a new
+// period claims the slot it reuses and clears it. Readers skip slots that
+// are cleared while they read them.
+class RequestStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::minutes MAX_WINDOW{1440};
+    // exact up to 7 results, then powers of two
+    static constexpr size_t RESULT_COUNT_BUCKET_COUNT = 16;
+    // four buckets per power of two of nanoseconds, up to 2^41 ns
+    static constexpr size_t LATENCY_BUCKET_COUNT = 164;
+
+    struct WindowStats {
+        std::chrono::minutes window{};
+        uint64_t request_count = 0;
+        uint64_t no_result_count = 0;
+        // over the window, or the time since the start if that is shorter
+        double queries_per_second = 0.0;
+        double no_result_rate = 0.0;
+        // requests by the bucket of their result count
+        std::array<uint64_t, RESULT_COUNT_BUCKET_COUNT> result_counts{};
+        // within 19%, zero without requests
+        std::chrono::nanoseconds latency_p50{};
+        std::chrono::nanoseconds latency_p90{};
+        std::chrono::nanoseconds latency_p99{};
+    };
+
+    explicit RequestStats(Clock::time_point start_time = Clock::now());
+
+    RequestStats(const RequestStats&) = delete;
+    RequestStats& operator=(const RequestStats&) = delete;
+
+    // A record older than the slots still kept is dropped
+    void Record(size_t result_count, Clock::duration latency, Clock::time_point now = Clock::now());
+
+    // Windows up to five minutes are counted by the second, longer ones by
+    // the minute. Throws std::invalid_argument for an empty window or one
+    // longer than MAX_WINDOW.
+    WindowStats GetWindowStats(std::chrono::minutes window, Clock::time_point now = Clock::now()) const;
+
+    static size_t GetResultCountBucket(size_t result_count);
+
+    // The smallest result count of the bucket
+    static size_t GetResultCountLowerBound(size_t bucket);
+
+private:
+    struct Slot {
+        // the period of the counters, EMPTY or RESETTING
+        std::atomic<int64_t> period{EMPTY};
+        std::atomic<uint64_t> request_count{0};
+        std::atomic<uint64_t> no_result_count{0};
+        std::array<std::atomic<uint64_t>, RESULT_COUNT_BUCKET_COUNT> result_counts{};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latencies{};
+    };
+
+    // Slot i holds a period p with p % size == i
+    struct Ring {
+        Ring(Clock::duration period_duration, size_t size);
+
+        Clock::duration period_duration;
+        std::vector<Slot> slots;
+    };
+
+    // Sums of the slots of a window
+    struct Totals {
+        uint64_t request_count = 0;
+        uint64_t no_result_count = 0;
+        std::array<uint64_t, RESULT_COUNT_BUCKET_COUNT> result_counts{};
+        std::array<uint64_t, LATENCY_BUCKET_COUNT> latencies{};
+    };
+
+    static constexpr int64_t EMPTY = -1;
+    static constexpr int64_t RESETTING = -2;
+
+    const Clock::time_point start_time_;
+    Ring seconds_;
+    Ring minutes_;
+
+    int64_t GetPeriod(const Ring& ring, Clock::time_point now) const;
+
+    // The slot of period, cleared first if it held an older one; nullptr if
+    // it already holds a newer period
+    static Slot* AcquireSlot(Ring& ring, int64_t period);
+
+    static void AddToSlot(Slot& slot, size_t result_count_bucket, size_t latency_bucket, bool has_results);
+
+    // Adds the slots of periods [first_period, last_period]
+    static void AddSlots(const Ring& ring, int64_t first_period, int64_t last_period, Totals& totals);
+
+    static size_t GetLatencyBucket(uint64_t latency_ns);
+
+    static uint64_t GetLatencyLowerBound(size_t bucket);
+
+    static std::chrono::nanoseconds GetLatencyQuantile(const Totals& totals, double q);
+};
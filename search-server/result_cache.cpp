@@ -0,0 +1,99 @@
+#include "result_cache.h"
+
+#include <functional>
+#include <iterator>
+
+void ResultCache::SetMemoryLimit(size_t bytes) {
+    memory_limit_ = bytes;
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        EvictTo(shard, bytes / SHARD_COUNT);
+    }
+}
+
+size_t ResultCache::GetMemoryLimit() const {
+    return memory_limit_;
+}
+
+bool ResultCache::IsEnabled() const {
+    return memory_limit_ > 0;
+}
+
+std::optional<std::vector<Document>> ResultCache::Find(const std::string& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.positions.find(key);
+    if (it == shard.positions.end()) {
+        ++shard.misses;
+        return std::nullopt;
+    }
+    if (it->second->generation != generation) {
+        // computed before the index changed
+        Erase(shard, it->second);
+        ++shard.misses;
+        return std::nullopt;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    ++shard.hits;
+    return it->second->documents;
+}
+
+void ResultCache::Insert(const std::string& key, uint64_t generation, const std::vector<Document>& documents) {
+    const size_t shard_limit = memory_limit_ / SHARD_COUNT;
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.positions.find(key);
+    if (it != shard.positions.end()) {
+        // a concurrent miss may have stored it already, keep the newer generation
+        if (it->second->generation >= generation) {
+            return;
+        }
+        Erase(shard, it->second);
+    }
+    Entry entry{key, generation, documents};
+    const size_t entry_size = GetEntrySize(entry);
+    if (entry_size > shard_limit) {
+        return;
+    }
+    EvictTo(shard, shard_limit - entry_size);
+    shard.entries.push_front(std::move(entry));
+    shard.positions.emplace(key, shard.entries.begin());
+    shard.memory_usage += entry_size;
+}
+
+ResultCacheStats ResultCache::GetStats() const {
+    ResultCacheStats stats;
+    for (const Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entry_count += shard.entries.size();
+        stats.memory_usage += shard.memory_usage;
+    }
+    return stats;
+}
+
+ResultCache::Shard& ResultCache::GetShard(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % SHARD_COUNT];
+}
+
+size_t ResultCache::GetEntrySize(const Entry& entry) {
+    // list node, map node with its own copy of the key, bucket pointer
+    const size_t node_overhead = 4 * sizeof(void*);
+    return sizeof(Entry) + node_overhead + sizeof(std::string) + sizeof(void*) + 2 * entry.key.capacity()
+        + entry.documents.capacity() * sizeof(Document);
+}
+
+void ResultCache::Erase(Shard& shard, std::list<Entry>::iterator position) {
+    shard.memory_usage -= GetEntrySize(*position);
+    shard.positions.erase(position->key);
+    shard.entries.erase(position);
+}
+
+void ResultCache::EvictTo(Shard& shard, size_t limit) {
+    while (shard.memory_usage > limit && !shard.entries.empty()) {
+        Erase(shard, std::prev(shard.entries.end()));
+        ++shard.evictions;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+struct ResultCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // entries dropped to stay within the memory limit
+    uint64_t evictions = 0;
+    size_t entry_count = 0;
+    size_t memory_usage = 0;
+};
+
+// Search results by query key. Every entry remembers the index generation
+// it was computed at; a lookup at another generation misses and drops it.
+// Keys are spread over shards with their own lock and LRU order, the
+// memory limit is split evenly between them.
+class ResultCache {
+public:
+    // A zero limit disables the cache
+    void SetMemoryLimit(size_t bytes);
+
+    size_t GetMemoryLimit() const;
+
+    bool IsEnabled() const;
+
+    std::optional<std::vector<Document>> Find(const std::string& key, uint64_t generation);
+
+    void Insert(const std::string& key, uint64_t generation, const std::vector<Document>& documents);
+
+    ResultCacheStats GetStats() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        std::string key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        // most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> positions;
+        size_t memory_usage = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    std::atomic<size_t> memory_limit_ = 0;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    Shard& GetShard(const std::string& key);
+
+    // Rough heap usage of an entry with its list and map nodes
+    static size_t GetEntrySize(const Entry& entry);
+
+    static void Erase(Shard& shard, std::list<Entry>::iterator position);
+
+    // Drops least recently used entries until the shard fits into limit
+    static void EvictTo(Shard& shard, size_t limit);
+};
@@ -0,0 +1,97 @@
+#include "score_accumulator.h"
+
+#include <cassert>
+
+namespace {
+
+// The flat array pays off once a quarter of the range is expected to match
+const size_t DENSE_RANGE_FACTOR = 4;
+
+}
+
+ScoreAccumulator::ScoreAccumulator(int first_slot, int last_slot, size_t expected_count)
+    : first_slot_(first_slot)
+    , is_dense_(expected_count * DENSE_RANGE_FACTOR >= static_cast<size_t>(last_slot - first_slot)) {
+    if (is_dense_) {
+        const size_t range = static_cast<size_t>(last_slot - first_slot);
+        dense_scores_.resize(range);
+        present_.resize((range + 63) / 64);
+        return;
+    }
+    // keep the load factor at or below one half
+    int bits = 1;
+    while ((size_t{1} << bits) < expected_count * 2) {
+        ++bits;
+    }
+    hash_shift_ = 64 - bits;
+    sparse_slots_.assign(size_t{1} << bits, EMPTY_SLOT);
+    sparse_scores_.resize(size_t{1} << bits);
+}
+
+void ScoreAccumulator::Add(int slot, double score) {
+    if (is_dense_) {
+        const size_t offset = static_cast<size_t>(slot - first_slot_);
+        uint64_t& word = present_[offset / 64];
+        const uint64_t bit = uint64_t{1} << (offset % 64);
+        if (word & bit) {
+            dense_scores_[offset] += score;
+        } else {
+            word |= bit;
+            dense_scores_[offset] = score;
+            ++size_;
+        }
+        return;
+    }
+    const size_t position = FindPosition(slot);
+    if (sparse_slots_[position] == slot) {
+        sparse_scores_[position] += score;
+    } else {
+        assert(size_ * 2 < sparse_slots_.size());
+        sparse_slots_[position] = slot;
+        sparse_scores_[position] = score;
+        ++size_;
+    }
+}
+
+void ScoreAccumulator::Erase(int slot) {
+    if (is_dense_) {
+        const size_t offset = static_cast<size_t>(slot - first_slot_);
+        uint64_t& word = present_[offset / 64];
+        const uint64_t bit = uint64_t{1} << (offset % 64);
+        if (word & bit) {
+            word &= ~bit;
+            --size_;
+        }
+        return;
+    }
+    const size_t position = FindPosition(slot);
+    if (sparse_slots_[position] == slot) {
+        sparse_slots_[position] = ERASED_SLOT;
+        --size_;
+    }
+}
+
+size_t ScoreAccumulator::size() const {
+    return size_;
+}
+
+bool ScoreAccumulator::IsDense() const {
+    return is_dense_;
+}
+
+// Returns the position holding slot or the first reusable one on its probe path
+size_t ScoreAccumulator::FindPosition(int slot) const {
+    const size_t mask = sparse_slots_.size() - 1;
+    size_t position = static_cast<size_t>((static_cast<uint64_t>(slot) * 0x9E3779B97F4A7C15ull) >> hash_shift_);
+    size_t reusable = sparse_slots_.size();
+    while (sparse_slots_[position] != EMPTY_SLOT) {
+        if (sparse_slots_[position] == slot) {
+            return position;
+        }
+        if (sparse_slots_[position] == ERASED_SLOT && reusable == sparse_slots_.size()) {
+            reusable = position;
+        }
+        position = (position + 1) & mask;
+    }
+    return reusable == sparse_slots_.size() ? position : reusable;
+}
\ No newline at end of file
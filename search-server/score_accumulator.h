@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sums relevance per document slot within [first_slot, last_slot) for one query.
+// Large result sets go to a flat array with a presence bitmap, sparse ones to
+// an open-addressing hash table sized for the expected number of slots.
+class ScoreAccumulator {
+public:
+    // expected_count must not be less than the number of distinct slots added
+    ScoreAccumulator(int first_slot, int last_slot, size_t expected_count);
+
+    void Add(int slot, double score);
+
+    void Erase(int slot);
+
+    size_t size() const;
+
+    bool IsDense() const;
+
+    // Calls function(slot, score) for every accumulated slot
+    template <typename Function>
+    void ForEach(Function function) const;
+
+private:
+    static constexpr int EMPTY_SLOT = -1;
+    static constexpr int ERASED_SLOT = -2;
+
+    int first_slot_;
+    bool is_dense_;
+    size_t size_ = 0;
+
+    std::vector<double> dense_scores_;
+    std::vector<uint64_t> present_;
+
+    std::vector<int> sparse_slots_;
+    std::vector<double> sparse_scores_;
+    int hash_shift_ = 0;
+
+    size_t FindPosition(int slot) const;
+};
+
+template <typename Function>
+void ScoreAccumulator::ForEach(Function function) const {
+    if (is_dense_) {
+        for (size_t word = 0; word < present_.size(); ++word) {
+            for (uint64_t bits = present_[word]; bits != 0; bits &= bits - 1) {
+                const size_t offset = word * 64 + __builtin_ctzll(bits);
+                function(first_slot_ + static_cast<int>(offset), dense_scores_[offset]);
+            }
+        }
+        return;
+    }
+    for (size_t position = 0; position < sparse_slots_.size(); ++position) {
+        if (sparse_slots_[position] >= 0) {
+            function(sparse_slots_[position], sparse_scores_[position]);
+        }
+    }
+}
\ No newline at end of file
@@ -1,8 +1,88 @@
 #include "search_server.h"
 
+#include <cstring>
+
+namespace {
+
+// A cursor is the relevance bits, the rating and the id of the last
+// document of a page, in hexadecimal
+const size_t CURSOR_SIZE = 32;
+
+void AppendHex(uint64_t value, size_t digit_count, std::string& out) {
+    for (size_t i = digit_count; i-- > 0;) {
+        out += "0123456789abcdef"[(value >> (i * 4)) & 0xF];
+    }
+}
+
+std::string EncodeSearchCursor(const Document& document) {
+    uint64_t relevance_bits;
+    std::memcpy(&relevance_bits, &document.relevance, sizeof(relevance_bits));
+    std::string cursor;
+    cursor.reserve(CURSOR_SIZE);
+    AppendHex(relevance_bits, 16, cursor);
+    AppendHex(static_cast<uint32_t>(document.rating), 8, cursor);
+    AppendHex(static_cast<uint32_t>(document.id), 8, cursor);
+    return cursor;
+}
+
+Document DecodeSearchCursor(std::string_view cursor) {
+    if (cursor.size() != CURSOR_SIZE) {
+        throw std::invalid_argument("Invalid search_after cursor"s);
+    }
+    const auto read_hex = [cursor](size_t first, size_t digit_count) {
+        uint64_t value = 0;
+        for (const char c : cursor.substr(first, digit_count)) {
+            uint64_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else {
+                throw std::invalid_argument("Invalid search_after cursor"s);
+            }
+            value = value << 4 | digit;
+        }
+        return value;
+    };
+    const uint64_t relevance_bits = read_hex(0, 16);
+    double relevance;
+    std::memcpy(&relevance, &relevance_bits, sizeof(relevance));
+    const auto id = static_cast<int>(static_cast<uint32_t>(read_hex(24, 8)));
+    if (std::isnan(relevance) || id < 0) {
+        throw std::invalid_argument("Invalid search_after cursor"s);
+    }
+    return {id, relevance, static_cast<int>(static_cast<uint32_t>(read_hex(16, 8)))};
+}
+
+// Stop words split by the tokenizer, like the words they are compared with
+std::vector<std::string> SplitStopWords(std::string_view text, const Tokenizer& tokenizer) {
+    std::string folded;
+    std::vector<std::string_view> words;
+    tokenizer.Split(text, folded, words);
+    return {words.begin(), words.end()};
+}
+
+}  // namespace
+
     
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(const std::string& stop_words_text, const Tokenizer& tokenizer)
+    : SearchServer(SplitStopWords(stop_words_text, tokenizer), tokenizer) {
+}
+
+SearchServer::SearchServer(const std::string_view stop_words_text, const Tokenizer& tokenizer)
+    : SearchServer(SplitStopWords(stop_words_text, tokenizer), tokenizer) {
+}
+
+SearchServer::~SearchServer() {
+    {
+        std::lock_guard guard(merge_mutex_);
+        is_stopping_ = true;
+    }
+    merge_condition_.notify_one();
+    merges_done_condition_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
 }
     
 
@@ -10,22 +90,344 @@ void SearchServer::AddDocument(int document_id,
                                const std::string_view document, 
                                DocumentStatus status, 
                                const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if (document_id < 0) {
         throw std::invalid_argument("Invalid document_id"s);
     }
-    std::string str(document);
-    const auto words = SplitIntoWordsNoStop(str);
+    std::string folded;
+    std::vector<uint32_t> positions;
+    const auto words = SplitIntoWordsNoStop(document, folded, positions);
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        ids_word_freqs_[document_id][word] += 0;
-    }    
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.insert(document_id);
+    const int rating = ComputeAverageRating(ratings);
+    
+    METRICS_SCOPED_TIMER(INDEX_INSERT);
+    // both copies intern the words in the same order, so term ids agree
+    std::shared_ptr<const Segment> sealed_segment;
+    index_.Modify([&](Index& index) {
+        if (index.documents.Contains(document_id)) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        // (term id, position) of every word, the positions of a term end up adjacent and increasing
+        std::vector<std::pair<int, uint32_t>> term_positions;
+        term_positions.reserve(words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            term_positions.emplace_back(index.terms.Intern(words[i]), positions[i]);
+        }
+        std::sort(term_positions.begin(), term_positions.end());
+        
+        std::vector<TermFreq> term_freqs;
+        std::vector<uint32_t> word_positions;
+        WordSetFingerprint fingerprint;
+        for (const auto& [term_id, position] : term_positions) {
+            if (term_freqs.empty() || term_freqs.back().term_id != term_id) {
+                term_freqs.push_back({term_id, 0, 0.0});
+                fingerprint.AddWord(index.terms.GetTerm(term_id));
+            }
+            term_freqs.back().term_freq += inv_word_count;
+            ++term_freqs.back().count;
+            if (index.has_word_positions) {
+                word_positions.push_back(position);
+            }
+        }
+        
+        ResizeDocumentFreqs(index);
+        for (const TermFreq& term_freq : term_freqs) {
+            AddDocumentFreq(index, term_freq.term_id, 1);
+        }
+        const int slot = index.active_segment.AddDocument(document_id, rating, status, inv_word_count, fingerprint,
+                                                          term_freqs, word_positions);
+        index.active_deleted.Resize(slot + 1);
+        index.documents.Insert(document_id, DocumentLocation{ACTIVE_SEGMENT, slot});
+        ++index.generation;
+        
+        if (index.active_segment.GetSlotCount() >= SEGMENT_DOCUMENT_COUNT) {
+            // the first copy seals its open segment, the second one shares the result
+            if (!sealed_segment) {
+                auto segment = std::make_shared<Segment>(std::move(index.active_segment));
+                segment->Seal();
+                sealed_segment = std::move(segment);
+            }
+            SealActiveSegment(index, sealed_segment);
+        }
+    });
+    METRICS_ADD(DOCUMENTS_ADDED, 1);
+    if (sealed_segment) {
+        RequestMerge();
+    }
+}
+
+void SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(std::execution::sequenced_policy policy, const std::vector<DocumentInput>& documents) {
+    AddDocumentBatch(policy, documents);
+}
+
+void SearchServer::AddDocuments(std::execution::parallel_policy policy, const std::vector<DocumentInput>& documents) {
+    AddDocumentBatch(policy, documents);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::AddDocumentBatch(ExecutionPolicy policy, const std::vector<DocumentInput>& documents) {
+    if (documents.empty()) {
+        return;
+    }
+    std::vector<int> document_ids;
+    document_ids.reserve(documents.size());
+    for (const DocumentInput& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        document_ids.push_back(document.id);
+    }
+    std::sort(document_ids.begin(), document_ids.end());
+    if (std::adjacent_find(document_ids.begin(), document_ids.end()) != document_ids.end()) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    
+    // Every chunk of documents becomes one sealed segment
+    const size_t chunk_count = (documents.size() + SEGMENT_DOCUMENT_COUNT - 1) / SEGMENT_DOCUMENT_COUNT;
+    std::vector<size_t> chunk_indexes(chunk_count);
+    std::iota(chunk_indexes.begin(), chunk_indexes.end(), 0);
+    const auto for_each_chunk_document = [&documents](size_t chunk, auto function) {
+        const size_t last = std::min(documents.size(), (chunk + 1) * SEGMENT_DOCUMENT_COUNT);
+        for (size_t i = chunk * SEGMENT_DOCUMENT_COUNT; i < last; ++i) {
+            function(i);
+        }
+    };
+    
+    // Words are views into the document texts, or their folded copies, sorted, so that
+    // equal words are adjacent, with their positions alongside. Exceptions cannot
+    // leave a parallel algorithm, invalid words are reported afterwards.
+    std::vector<std::string> folded_texts(documents.size());
+    std::vector<std::vector<std::string_view>> document_words(documents.size());
+    std::vector<std::vector<uint32_t>> document_positions(documents.size());
+    std::vector<std::string_view> invalid_words(documents.size());
+    // sorted unique words of every chunk
+    std::vector<std::vector<std::string_view>> chunk_words(chunk_count);
+    std::for_each(policy, chunk_indexes.begin(), chunk_indexes.end(), [&](size_t chunk) {
+        METRICS_SCOPED_TIMER(TOKENIZATION);
+        std::vector<std::pair<std::string_view, uint32_t>> positioned_words;
+        std::vector<std::string_view> tokens;
+        for_each_chunk_document(chunk, [&](size_t i) {
+            positioned_words.clear();
+            tokens.clear();
+            tokenizer_.Split(documents[i].text, folded_texts[i], tokens);
+            for (uint32_t position = 0; position < tokens.size(); ++position) {
+                const std::string_view word = tokens[position];
+                if (!IsValidWord(word)) {
+                    invalid_words[i] = word;
+                } else if (!IsStopWord(word)) {
+                    positioned_words.emplace_back(word, position);
+                }
+            }
+            std::sort(positioned_words.begin(), positioned_words.end());
+            std::vector<std::string_view>& words = document_words[i];
+            words.reserve(positioned_words.size());
+            document_positions[i].reserve(positioned_words.size());
+            for (const auto& [word, word_position] : positioned_words) {
+                words.push_back(word);
+                document_positions[i].push_back(word_position);
+            }
+            chunk_words[chunk].insert(chunk_words[chunk].end(), words.begin(), words.end());
+        });
+        std::sort(chunk_words[chunk].begin(), chunk_words[chunk].end());
+        chunk_words[chunk].erase(std::unique(chunk_words[chunk].begin(), chunk_words[chunk].end()), chunk_words[chunk].end());
+    });
+    for (const std::string_view word : invalid_words) {
+        if (!word.empty()) {
+            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
+        }
+    }
+    std::vector<std::string_view> batch_words;
+    for (const auto& words : chunk_words) {
+        batch_words.insert(batch_words.end(), words.begin(), words.end());
+    }
+    std::sort(batch_words.begin(), batch_words.end());
+    batch_words.erase(std::unique(batch_words.begin(), batch_words.end()), batch_words.end());
+    
+    METRICS_SCOPED_TIMER(INDEX_INSERT);
+    // Only interning the words and publishing the segments take the writer
+    // lock. The segments are built in between: a worker of the parallel
+    // build may run another task of the pool, which can be a writer too.
+    const auto check_new_ids = [&document_ids](const Index& index) {
+        for (const int document_id : document_ids) {
+            if (index.documents.Contains(document_id)) {
+                throw std::invalid_argument("Invalid document_id"s);
+            }
+        }
+    };
+    std::vector<int> term_ids;
+    bool has_word_positions = false;
+    index_.Modify([&](Index& index) {
+        check_new_ids(index);
+        // both copies intern the words in the same order, so term ids agree
+        std::vector<int> copy_term_ids;
+        copy_term_ids.reserve(batch_words.size());
+        for (const std::string_view word : batch_words) {
+            copy_term_ids.push_back(index.terms.Intern(word));
+        }
+        ResizeDocumentFreqs(index);
+        term_ids = std::move(copy_term_ids);
+        has_word_positions = index.has_word_positions;
+    });
+    
+    std::unordered_map<std::string_view, int> batch_term_ids;
+    batch_term_ids.reserve(batch_words.size());
+    for (size_t i = 0; i < batch_words.size(); ++i) {
+        batch_term_ids.emplace(batch_words[i], term_ids[i]);
+    }
+    std::vector<std::shared_ptr<const Segment>> segments(chunk_count);
+    std::for_each(policy, chunk_indexes.begin(), chunk_indexes.end(), [&](size_t chunk) {
+        Segment segment;
+        // term frequency and the first of its words in document_words
+        std::vector<std::pair<TermFreq, size_t>> word_groups;
+        std::vector<TermFreq> term_freqs;
+        std::vector<uint32_t> word_positions;
+        for_each_chunk_document(chunk, [&](size_t i) {
+            const DocumentInput& document = documents[i];
+            const std::vector<std::string_view>& words = document_words[i];
+            const double inv_word_count = 1.0 / words.size();
+            word_groups.clear();
+            WordSetFingerprint fingerprint;
+            for (size_t first = 0; first < words.size();) {
+                const size_t last = std::upper_bound(words.begin() + first, words.end(), words[first]) - words.begin();
+                TermFreq term_freq{batch_term_ids.at(words[first]), static_cast<uint32_t>(last - first), 0.0};
+                // summed like AddDocument does, so frequencies are the same either way
+                for (size_t j = first; j < last; ++j) {
+                    term_freq.term_freq += inv_word_count;
+                }
+                word_groups.emplace_back(term_freq, first);
+                fingerprint.AddWord(words[first]);
+                first = last;
+            }
+            std::sort(word_groups.begin(), word_groups.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first.term_id < rhs.first.term_id;
+            });
+            term_freqs.clear();
+            word_positions.clear();
+            for (const auto& [term_freq, first] : word_groups) {
+                term_freqs.push_back(term_freq);
+                if (has_word_positions) {
+                    word_positions.insert(word_positions.end(), document_positions[i].begin() + first,
+                                          document_positions[i].begin() + first + term_freq.count);
+                }
+            }
+            segment.AddDocument(document.id, ComputeAverageRating(document.ratings), document.status,
+                                inv_word_count, fingerprint, term_freqs, word_positions);
+        });
+        segment.Seal();
+        segments[chunk] = std::make_shared<const Segment>(std::move(segment));
+    });
+    
+    // documents of the batch with every term, by term id
+    std::vector<uint32_t> document_freqs(term_ids.empty() ? 0 : *std::max_element(term_ids.begin(), term_ids.end()) + 1);
+    for (const auto& segment : segments) {
+        for (int slot = 0; slot < segment->GetSlotCount(); ++slot) {
+            for (const TermFreq& term_freq : segment->GetTermFreqs(slot)) {
+                ++document_freqs[term_freq.term_id];
+            }
+        }
+    }
+    index_.Modify([&](Index& index) {
+        // another writer may have added one of the ids meanwhile
+        check_new_ids(index);
+        // or turned on word positions, which the segments were built without
+        if (index.has_word_positions != has_word_positions) {
+            throw std::logic_error("Word positions were enabled while documents were added"s);
+        }
+        for (const int term_id : term_ids) {
+            AddDocumentFreq(index, term_id, document_freqs[term_id]);
+        }
+        ++index.generation;
+        for (const auto& segment : segments) {
+            AddSealedSegment(index, segment);
+        }
+    });
+    METRICS_ADD(DOCUMENTS_ADDED, documents.size());
+    RequestMerge();
+}
+
+DocumentPage SearchServer::FindDocumentPage(const std::string_view raw_query, DocumentStatus status, size_t page_size,
+                                           const std::string_view search_after) const {
+    return FindDocumentPage(std::execution::seq, raw_query, status, page_size, search_after);
+}
+
+DocumentPage SearchServer::FindDocumentPage(std::execution::sequenced_policy policy, const std::string_view raw_query,
+                                           DocumentStatus status, size_t page_size,
+                                           const std::string_view search_after) const {
+    return MakeDocumentPage(FindCachedTopDocuments(policy, raw_query, status, MakePageTop(page_size, search_after)),
+                            page_size);
+}
+
+DocumentPage SearchServer::FindDocumentPage(std::execution::parallel_policy policy, const std::string_view raw_query,
+                                           DocumentStatus status, size_t page_size,
+                                           const std::string_view search_after) const {
+    return MakeDocumentPage(FindCachedTopDocuments(policy, raw_query, status, MakePageTop(page_size, search_after)),
+                            page_size);
 }
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return index_.Read([](const Index& index) {
+        return static_cast<int>(index.documents.size());
+    });
+}
+
+size_t SearchServer::GetSealedSegmentCount() const {
+    return index_.Read([](const Index& index) {
+        return index.segments.size();
+    });
+}
+
+void SearchServer::WaitForMerges() {
+    std::unique_lock lock(merge_mutex_);
+    merges_done_condition_.wait(lock, [this] {
+        return is_stopping_ || (!is_merge_requested_ && !is_merging_);
+    });
+}
+
+void SearchServer::SetResultCacheLimit(size_t memory_bytes) {
+    result_cache_.SetMemoryLimit(memory_bytes);
+}
+
+ResultCacheStats SearchServer::GetResultCacheStats() const {
+    return result_cache_.GetStats();
+}
+
+void SearchServer::EnableWordPositions() {
+    index_.Modify([](Index& index) {
+        if (!index.has_word_positions && (!index.documents.empty() || !index.segments.empty()
+                                          || index.active_segment.GetSlotCount() > 0)) {
+            throw std::logic_error("Word positions must be enabled before documents are added"s);
+        }
+        index.has_word_positions = true;
+    });
+}
+
+bool SearchServer::HasWordPositions() const {
+    return index_.Read([](const Index& index) {
+        return index.has_word_positions;
+    });
+}
+
+void SearchServer::EnableBooleanQueries() {
+    has_boolean_queries_.store(true, std::memory_order_relaxed);
+}
+
+bool SearchServer::HasBooleanQueries() const {
+    return has_boolean_queries_.load(std::memory_order_relaxed);
+}
+
+void SearchServer::SetScoringStrategy(ScoringStrategy strategy) {
+    scoring_strategy_.store(strategy, std::memory_order_relaxed);
+}
+
+ScoringStrategy SearchServer::GetScoringStrategy() const {
+    return scoring_strategy_.load(std::memory_order_relaxed);
+}
+
+bool SearchServer::IsBooleanSyntax(const std::string_view raw_query) const {
+    return HasBooleanQueries() && IsBooleanQuery(raw_query);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
@@ -35,72 +437,127 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
         (std::execution::seq, raw_query, document_id);
 }
 
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument
+        (std::execution::sequenced_policy policy, const std::string_view raw_query, int document_id) const {
+    if (IsBooleanSyntax(raw_query)) {
+        return std::move(MatchDocumentBatch(policy, raw_query, {document_id}).front());
+    }
+    Query& query = GetThreadQuery();
+    ParsePlainQuery(raw_query, stop_words_, tokenizer_, query);
+    return index_.Read([&](const Index& index) {
+        return MatchInIndex(index, FindIndexedTerms(index, query.plus_words),
+                            FindIndexedTerms(index, query.minus_words), FindExistingDocument(index, document_id));
+    });
+}
+
+// A query has a handful of words, each checked with a binary search in the
+// forward index of the document: splitting that between threads costs more
+// than it saves. MatchDocuments runs documents in parallel instead.
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
-        std::execution::parallel_policy policy, 
+        std::execution::parallel_policy, 
         const std::string_view raw_query, 
         int document_id) const {
-    std::vector<std::string_view> matched_words;
-    if (document_id >= 0) {
-        static auto query_par = ParParseQuery(raw_query);
-        
-        auto check = find_if(std::execution::seq, 
-                             query_par.minus_words.begin(), 
-                             query_par.minus_words.end(),
-            [&] (const std::string& word) {
-                return word_to_document_freqs_.at(word).count(document_id);
-            });
-            if (check != query_par.minus_words.end()) {
-                return std::tuple(matched_words, documents_.at(document_id).status);
-            }
-        
-        matched_words.reserve(query_par.plus_words.size());
-        for (const std::string_view word : query_par.plus_words) {
-            if ((word_to_document_freqs_.count(word) != 0)
-            &&word_to_document_freqs_.at(static_cast<std::string>(word)).count(document_id)) {
-            matched_words.insert(matched_words.end(), word);
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocumentBatch(std::execution::seq, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    std::execution::sequenced_policy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocumentBatch(policy, raw_query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    std::execution::parallel_policy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocumentBatch(policy, raw_query, document_ids);
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocumentBatch(
+    ExecutionPolicy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const {
+    // unknown ids throw here, before any work is split between threads; the
+    // postings read by the work may still throw if an opened index is damaged
+    const auto find_documents = [&](const Index& index) {
+        std::vector<StoredDocument> documents;
+        documents.reserve(document_ids.size());
+        for (const int document_id : document_ids) {
+            documents.push_back(FindExistingDocument(index, document_id));
         }
+        return documents;
+    };
+    if (IsBooleanSyntax(raw_query)) {
+        const BooleanQuery query = ParseBooleanQuery(raw_query, stop_words_, tokenizer_);
+        return index_.Read([&](const Index& index) {
+            const std::vector<StoredDocument> documents = find_documents(index);
+            const BooleanQueryPlan plan = CompileBooleanQuery(index, query);
+            std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> matches(documents.size());
+            ParallelError error;
+            std::transform(policy, documents.begin(), documents.end(), matches.begin(), [&](StoredDocument document) {
+                std::tuple<std::vector<std::string_view>, DocumentStatus> match;
+                error.Catch([&] {
+                    match = MatchInIndex(index, plan, document);
+                });
+                return match;
+            });
+            error.Rethrow();
+            return matches;
+        });
     }
-        std::sort(policy, matched_words.begin(), matched_words.end());
-        matched_words.erase(std::unique(matched_words.begin(), 
-                                        matched_words.end()), matched_words.end());
-    } else {
-        throw std::out_of_range("id");
-    }
-    return {matched_words, documents_.at(document_id).status};
+    Query& query = GetThreadQuery();
+    ParsePlainQuery(raw_query, stop_words_, tokenizer_, query);
+    return index_.Read([&](const Index& index) {
+        const std::vector<StoredDocument> documents = find_documents(index);
+        const TermIds plus_terms = FindIndexedTerms(index, query.plus_words);
+        const TermIds minus_terms = FindIndexedTerms(index, query.minus_words);
+        std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> matches(documents.size());
+        ParallelError error;
+        std::transform(policy, documents.begin(), documents.end(), matches.begin(), [&](StoredDocument document) {
+            std::tuple<std::vector<std::string_view>, DocumentStatus> match;
+            error.Catch([&] {
+                match = MatchInIndex(index, plus_terms, minus_terms, document);
+            });
+            return match;
+        });
+        error.Rethrow();
+        return matches;
+    });
 }
-    
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument
-        (std::execution::sequenced_policy policy, const std::string_view raw_query, int document_id) const {
-    if(!document_ids_.count(document_id)){
-            throw std::out_of_range("Документ не существует");
-        }
-    static Query query_;
-    query_ = ParseQuery(raw_query);
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchInIndex(const Index& index,
+    const TermIds& plus_terms, const TermIds& minus_terms, StoredDocument document) {
+    const auto [segment, slot] = document;
+    const DocumentData& document_data = segment->GetDocument(slot);
+    const ArrayView<TermFreq> term_freqs = segment->GetTermFreqs(slot);
     std::vector<std::string_view> matched_words;
-    matched_words.reserve(query_.plus_words.size());
-    
-    for (const std::string& word : query_.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            query_.plus_words.clear();
-            break;
+    for (const int term_id : minus_terms) {
+        if (HasTerm(term_freqs, term_id)) {
+            return {matched_words, document_data.status};
         }
     }
-    for (const std::string& word : query_.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    // plus words are sorted and unique, so are the matches
+    matched_words.reserve(plus_terms.size());
+    for (const int term_id : plus_terms) {
+        if (HasTerm(term_freqs, term_id)) {
+            matched_words.push_back(index.terms.GetTerm(term_id));
         }
     }
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, document_data.status};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchInIndex(const Index& index,
+    const BooleanQueryPlan& plan, StoredDocument document) {
+    const auto [segment, slot] = document;
+    if (!plan.root || QueryIterator(*plan.root, *segment, slot, slot + 1).IsEnd()) {
+        return {std::vector<std::string_view>{}, segment->GetDocument(slot).status};
     }
+    return MatchInIndex(index, plan.terms.plus_terms, plan.terms.minus_terms, document);
+}
     
 bool SearchServer::IsStopWord(const std::string_view word) const {
-    return stop_words_.count(static_cast<std::string>(word)) > 0;
+    return stop_words_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
@@ -110,133 +567,646 @@ bool SearchServer::IsValidWord(const std::string_view word) {
     });
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text, std::string& folded,
+                                                                 std::vector<uint32_t>& positions) const {
+    METRICS_SCOPED_TIMER(TOKENIZATION);
+    std::vector<std::string_view> words;
+    tokenizer_.Split(text, folded, words);
+    size_t kept_count = 0;
+    for (uint32_t position = 0; position < words.size(); ++position) {
+        const std::string_view word = words[position];
         if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word "s + word + " is invalid"s);
+            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
         }
         if (!IsStopWord(word)) {
-            words.push_back(word);
+            words[kept_count++] = word;
+            positions.push_back(position);
         }
     }
+    words.resize(kept_count);
     return words;
 }
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const {
-    if (text.empty()) {
-        throw std::invalid_argument("Query word is empty"s);
+SearchServer::Query& SearchServer::GetThreadQuery() {
+    thread_local Query query;
+    return query;
+}
+
+    // Existence required
+double SearchServer::ComputeWordInverseDocumentFreq(const Index& index, double log_document_count, int term_id) {
+    return log_document_count - index.log_document_freqs[term_id];
+}
+
+void SearchServer::ResizeDocumentFreqs(Index& index) {
+    if (index.document_freqs.size() < index.terms.size()) {
+        index.document_freqs.resize(index.terms.size());
+        index.log_document_freqs.resize(index.terms.size());
     }
-    std::string_view word(text);
-    bool is_minus = false;
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
+}
+
+void SearchServer::AddDocumentFreq(Index& index, int term_id, int64_t delta) {
+    uint32_t& document_freq = index.document_freqs[term_id];
+    document_freq = static_cast<uint32_t>(document_freq + delta);
+    // terms of no live document are never scored
+    index.log_document_freqs[term_id] = document_freq > 0 ? std::log(document_freq) : 0.0;
+}
+
+bool SearchServer::HasTerm(ArrayView<TermFreq> term_freqs, int term_id) {
+    if (term_id == TermDictionary::NO_TERM) {
+        return false;
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word "s + static_cast<std::string>(text) + " is invalid");
+    return std::binary_search(term_freqs.begin(), term_freqs.end(),
+        TermFreq{term_id, 0, 0.0},
+        [](const TermFreq& lhs, const TermFreq& rhs) {
+            return lhs.term_id < rhs.term_id;
+        });
+}
+
+bool SearchServer::IsExcluded(std::vector<PostingListView::Cursor>& minus_cursors, int slot) {
+    for (auto& cursor : minus_cursors) {
+        cursor.SkipTo(slot);
+        if (!cursor.IsEnd() && cursor.GetSlot() == slot) {
+            return true;
+        }
     }
-    return {word, is_minus, IsStopWord(word)};
+    return false;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
-    Query result;
-    for (const std::string_view word : SplitIntoWordsView(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(static_cast<std::string>(query_word.data));
-            } else {
-                result.plus_words.insert(static_cast<std::string>(query_word.data));
-            }
+int SearchServer::FindIndexedTerm(const Index& index, const std::string_view word) {
+    const int term_id = index.terms.Find(word);
+    if (term_id == TermDictionary::NO_TERM || index.document_freqs[term_id] == 0) {
+        return TermDictionary::NO_TERM;
+    }
+    return term_id;
+}
+
+const std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    return index_.Read([&](const Index& index) {
+        const auto [segment, slot] = FindDocument(index, document_id);
+        if (segment == nullptr) {
+            return empty_word_freqs_;
         }
+        std::map<std::string_view, double> word_freqs;
+        for (const TermFreq& term_freq : segment->GetTermFreqs(slot)) {
+            word_freqs[index.terms.GetTerm(term_freq.term_id)] = term_freq.term_freq;
+        }
+        
+        return word_freqs;
+    });
+}
+
+WordSetFingerprint SearchServer::GetWordSetFingerprint(int document_id) const {
+    return index_.Read([&](const Index& index) {
+        const auto [segment, slot] = FindDocument(index, document_id);
+        if (segment == nullptr) {
+            throw std::out_of_range("Документ не существует");
+        }
+        return segment->GetDocument(slot).fingerprint;
+    });
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    SearchServer::RemoveDocument(std::execution::seq, document_id);
+}
+
+void SearchServer::RemoveDocument(std::execution::sequenced_policy, int document_id) {
+    bool needs_merge = false;
+    index_.Modify([&](Index& index) {
+        needs_merge = RemoveFromIndex(index, document_id);
+    });
+    if (needs_merge) {
+        RequestMerge();
     }
-    return result;
+}
+    
+// A removal only sets a bit and updates counters, there is nothing to split
+void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
 }
 
-SearchServer::ParQuery SearchServer::ParParseQuery(const std::string_view text) const {
-    ParQuery result;
-    result.plus_words.reserve(500);
-    result.minus_words.reserve(500);
-    for (const std::string_view word : SplitIntoWordsView(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(static_cast<std::string>(query_word.data));
-            } else {
-                result.plus_words.push_back(static_cast<std::string>(query_word.data));
+bool SearchServer::RemoveFromIndex(Index& index, int document_id) {
+    const std::optional<DocumentLocation> location = FindLocation(index, document_id);
+    if (!location) {
+        return false;
+    }
+    const auto [segment_number, slot] = *location;
+    const Segment* segment;
+    bool needs_merge = false;
+    if (segment_number == ACTIVE_SEGMENT) {
+        index.active_deleted.Set(slot);
+        segment = &index.active_segment;
+    } else {
+        SealedSegment& sealed = index.segments[FindSegment(index, segment_number)];
+        sealed.deleted.Set(slot);
+        ++sealed.deleted_count;
+        needs_merge = sealed.deleted_count * 2 > static_cast<size_t>(sealed.segment->GetSlotCount());
+        segment = sealed.segment.get();
+    }
+    for (const TermFreq& term_freq : segment->GetTermFreqs(slot)) {
+        AddDocumentFreq(index, term_freq.term_id, -1);
+    }
+    index.documents.Erase(document_id);
+    ++index.generation;
+    return needs_merge;
+}
+
+size_t SearchServer::FindSegment(const Index& index, uint32_t number) {
+    return std::lower_bound(index.segments.begin(), index.segments.end(), number,
+        [](const SealedSegment& sealed, uint32_t number) {
+            return sealed.number < number;
+        }) - index.segments.begin();
+}
+
+std::optional<SearchServer::DocumentLocation> SearchServer::FindLocation(const Index& index, int document_id) {
+    const std::optional<DocumentLocation> location = index.documents.Find(document_id);
+    if (!location) {
+        return std::nullopt;
+    }
+    const Segment* segment = &index.active_segment;
+    const Bitmap* deleted = &index.active_deleted;
+    if (location->segment != ACTIVE_SEGMENT) {
+        const size_t position = FindSegment(index, location->segment);
+        if (position == index.segments.size() || index.segments[position].number != location->segment) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        segment = index.segments[position].segment.get();
+        deleted = &index.segments[position].deleted;
+    }
+    if (location->slot < 0 || location->slot >= segment->GetSlotCount() || deleted->Test(location->slot)
+        || segment->GetDocument(location->slot).id != document_id) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    // the callers read the words of the document
+    segment->CheckDocument(location->slot);
+    return location;
+}
+
+SearchServer::StoredDocument SearchServer::FindDocument(const Index& index, int document_id) {
+    const std::optional<DocumentLocation> location = FindLocation(index, document_id);
+    if (!location) {
+        return {nullptr, 0};
+    }
+    const auto [segment_number, slot] = *location;
+    if (segment_number == ACTIVE_SEGMENT) {
+        return {&index.active_segment, slot};
+    }
+    return {index.segments[FindSegment(index, segment_number)].segment.get(), slot};
+}
+
+SearchServer::StoredDocument SearchServer::FindExistingDocument(const Index& index, int document_id) {
+    const StoredDocument document = FindDocument(index, document_id);
+    if (document.segment == nullptr) {
+        throw std::out_of_range("Документ не существует");
+    }
+    return document;
+}
+
+// Valid words have no control characters, they separate the words here
+std::string SearchServer::MakeResultCacheKey(const Query& query, DocumentStatus status, const TopDocuments& empty_top) {
+    std::string key = std::to_string(static_cast<int>(status)) + ' ' + std::to_string(empty_top.GetCapacity());
+    if (empty_top.GetSearchAfter()) {
+        key += ' ';
+        key += EncodeSearchCursor(*empty_top.GetSearchAfter());
+    }
+    for (const std::string_view word : query.plus_words) {
+        key += "\x01+";
+        key += word;
+    }
+    for (const std::string_view word : query.minus_words) {
+        key += "\x01-";
+        key += word;
+    }
+    return key;
+}
+
+TopDocuments SearchServer::MakePageTop(size_t page_size, const std::string_view search_after) {
+    if (search_after.empty()) {
+        return TopDocuments(page_size);
+    }
+    return TopDocuments(page_size, DecodeSearchCursor(search_after));
+}
+
+DocumentPage SearchServer::MakeDocumentPage(std::vector<Document> documents, size_t page_size) {
+    DocumentPage page{std::move(documents), {}};
+    if (page_size > 0 && page.documents.size() == page_size) {
+        page.next_cursor = EncodeSearchCursor(page.documents.back());
+    }
+    return page;
+}
+
+SearchServer::QueryTerms SearchServer::ResolveQueryTerms(const Index& index, const Query& query) {
+    return ResolveQueryTerms(index, query.plus_words, query.minus_words);
+}
+
+SearchServer::BooleanQueryPlan SearchServer::CompileBooleanQuery(const Index& index, const BooleanQuery& query) {
+    if (!index.has_word_positions && NeedsWordPositions(query.root)) {
+        throw std::invalid_argument("Phrases and NEAR need word positions, see EnableWordPositions"s);
+    }
+    return {CompileQueryNode(index, query.root), ResolveQueryTerms(index, GetQueryWords(query.root), query.minus_words)};
+}
+
+std::optional<QueryPlanNode> SearchServer::CompileQueryNode(const Index& index, const QueryNode& node) {
+    QueryPlanNode plan{node.type, {}, node.offsets, node.distance, {}};
+    switch (node.type) {
+    case QueryNode::Type::WORD:
+    case QueryNode::Type::PHRASE:
+        for (const std::string_view word : node.words) {
+            const int term_id = FindIndexedTerm(index, word);
+            if (term_id == TermDictionary::NO_TERM) {
+                return std::nullopt;
+            }
+            plan.term_ids.push_back(term_id);
+            if (node.type == QueryNode::Type::PHRASE) {
+                plan.children.push_back({QueryNode::Type::WORD, {term_id}, {0}, 0, {}});
+            }
+        }
+        return plan;
+    case QueryNode::Type::OR:
+        for (const QueryNode& child : node.children) {
+            if (std::optional<QueryPlanNode> child_plan = CompileQueryNode(index, child)) {
+                plan.children.push_back(std::move(*child_plan));
+            }
+        }
+        if (plan.children.size() <= 1) {
+            return plan.children.empty() ? std::nullopt : std::optional(std::move(plan.children.front()));
+        }
+        return plan;
+    default:
+        for (const QueryNode& child : node.children) {
+            std::optional<QueryPlanNode> child_plan = CompileQueryNode(index, child);
+            if (!child_plan) {
+                return std::nullopt;
             }
+            plan.children.push_back(std::move(*child_plan));
         }
+        return plan;
     }
-    return result;
 }
 
-    // Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(static_cast<std::string>(word)).size());
+std::vector<SearchServer::SegmentRange> SearchServer::SplitIntoRanges(const Index& index, int chunk_count) {
+    int64_t slot_count = index.active_segment.GetSlotCount();
+    for (const SealedSegment& sealed : index.segments) {
+        slot_count += sealed.segment->GetSlotCount();
+    }
+    std::vector<SegmentRange> ranges;
+    const auto split_segment = [&](const Segment& segment, const Bitmap& deleted) {
+        const int64_t size = segment.GetSlotCount();
+        if (size == 0) {
+            return;
+        }
+        // the number of parts follows the share of the segment in all slots
+        const int64_t part_count = std::clamp<int64_t>(chunk_count * size / slot_count, 1, size);
+        for (int64_t part = 0; part < part_count; ++part) {
+            ranges.push_back({&segment, &deleted, static_cast<int>(size * part / part_count),
+                              static_cast<int>(size * (part + 1) / part_count)});
+        }
+    };
+    for (const SealedSegment& sealed : index.segments) {
+        split_segment(*sealed.segment, sealed.deleted);
+    }
+    split_segment(index.active_segment, index.active_deleted);
+    return ranges;
 }
 
-const std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-    if(!document_ids_.count(document_id)){
-        return empty_word_freqs_;
+void SearchServer::SealActiveSegment(Index& index, std::shared_ptr<const Segment> segment) {
+    const uint32_t number = index.next_segment_number++;
+    size_t deleted_count = 0;
+    for (int slot = 0; slot < segment->GetSlotCount(); ++slot) {
+        if (index.active_deleted.Test(slot)) {
+            ++deleted_count;
+        } else {
+            index.documents.Update(segment->GetDocument(slot).id, {number, slot});
+        }
     }
-    std::map<std::string_view, double> word_freqs;
-    for(auto [i, j] : ids_word_freqs_.at(document_id)){
-        word_freqs[i] = j;
+    index.segments.push_back({number, std::move(segment), std::move(index.active_deleted), deleted_count});
+    index.active_segment = Segment();
+    index.active_deleted = Bitmap();
+}
+
+void SearchServer::AddSealedSegment(Index& index, std::shared_ptr<const Segment> segment) {
+    const uint32_t number = index.next_segment_number++;
+    for (int slot = 0; slot < segment->GetSlotCount(); ++slot) {
+        index.documents.Insert(segment->GetDocument(slot).id, DocumentLocation{number, slot});
     }
-    
-    return word_freqs;
+    Bitmap deleted;
+    deleted.Resize(segment->GetSlotCount());
+    index.segments.push_back({number, std::move(segment), std::move(deleted), 0});
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    SearchServer::RemoveDocument(std::execution::seq, document_id);
+void SearchServer::RequestMerge() {
+    std::lock_guard guard(merge_mutex_);
+    is_merge_requested_ = true;
+    if (!merge_thread_.joinable()) {
+        merge_thread_ = std::thread([this] {
+            RunMerges();
+        });
+    }
+    merge_condition_.notify_one();
 }
 
-void SearchServer::RemoveDocument(std::execution::sequenced_policy policy, int document_id) {
-    if(document_ids_.count(document_id)) {
-        for_each(policy, 
-                 ids_word_freqs_.at(document_id).begin(), 
-                 ids_word_freqs_.at(document_id).end(), 
-                 [&](std::pair<std::string, double> words) {
-            word_to_document_freqs_[words.first].erase(document_id);
+void SearchServer::RunMerges() {
+    std::unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_condition_.wait(lock, [this] {
+            return is_stopping_ || is_merge_requested_;
         });
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        ids_word_freqs_.erase(document_id);
+        if (is_stopping_) {
+            return;
+        }
+        is_merge_requested_ = false;
+        is_merging_ = true;
+        do {
+            lock.unlock();
+            const bool has_merged = MergeSegments();
+            lock.lock();
+            if (!has_merged) {
+                break;
+            }
+        } while (!is_stopping_);
+        is_merging_ = false;
+        if (!is_merge_requested_) {
+            merges_done_condition_.notify_all();
+        }
     }
 }
-    
-void SearchServer::RemoveDocument(std::execution::parallel_policy policy, int document_id) {
-    if(document_ids_.count(document_id)) {
-        std::vector<const std::string*> it_to_words;
-        it_to_words.resize(ids_word_freqs_[document_id].size());
-        
-        std::transform(policy, ids_word_freqs_[document_id].begin(),
-                       ids_word_freqs_[document_id].end(), it_to_words.begin(),
-                       [](const auto& word) { return &word.first;
+
+bool SearchServer::MergeSegments() {
+    // the copies of the tombstones are the state the merge is built from
+    const std::vector<SealedSegment> sources = index_.Read([](const Index& index) {
+        return SelectMerge(index);
+    });
+    if (sources.empty()) {
+        return false;
+    }
+    std::vector<Segment::MergeSource> merge_sources;
+    for (const SealedSegment& source : sources) {
+        merge_sources.push_back({source.segment.get(), &source.deleted});
+    }
+    std::shared_ptr<const Segment> merged;
+    try {
+        merged = std::make_shared<Segment>(Segment::Merge(merge_sources));
+    } catch (const std::invalid_argument&) {
+        // a damaged segment of an opened index stays unmerged, reading the
+        // damaged records keeps throwing to the searches that reach them
+        return false;
+    }
+    index_.Modify([&](Index& index) {
+        CommitMerge(index, sources, merged);
+    });
+    return true;
+}
+
+std::vector<SearchServer::SealedSegment> SearchServer::SelectMerge(const Index& index) {
+    for (const SealedSegment& sealed : index.segments) {
+        if (sealed.deleted_count * 2 > static_cast<size_t>(sealed.segment->GetSlotCount())) {
+            return {sealed};
+        }
+    }
+    std::map<int, std::vector<const SealedSegment*>> tiers;
+    for (const SealedSegment& sealed : index.segments) {
+        const size_t live_count = sealed.segment->GetSlotCount() - sealed.deleted_count;
+        int tier = 0;
+        for (size_t bound = SEGMENT_DOCUMENT_COUNT * SEGMENT_MERGE_FACTOR; live_count >= bound; bound *= SEGMENT_MERGE_FACTOR) {
+            ++tier;
+        }
+        tiers[tier].push_back(&sealed);
+    }
+    for (auto& [tier, segments] : tiers) {
+        if (segments.size() < SEGMENT_MERGE_FACTOR) {
+            continue;
+        }
+        std::sort(segments.begin(), segments.end(), [](const SealedSegment* lhs, const SealedSegment* rhs) {
+            return lhs->segment->GetSlotCount() - lhs->deleted_count < rhs->segment->GetSlotCount() - rhs->deleted_count;
         });
-        
-        for_each(policy, 
-                 it_to_words.begin(), 
-                 it_to_words.end(), 
-                 [&](auto word) {
-            word_to_document_freqs_[*word].erase(document_id);
+        segments.resize(SEGMENT_MERGE_FACTOR);
+        std::sort(segments.begin(), segments.end(), [](const SealedSegment* lhs, const SealedSegment* rhs) {
+            return lhs->number < rhs->number;
         });
-        
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
-        ids_word_freqs_.erase(document_id);
+        std::vector<SealedSegment> sources;
+        for (const SealedSegment* sealed : segments) {
+            sources.push_back(*sealed);
+        }
+        return sources;
+    }
+    return {};
+}
+
+void SearchServer::CommitMerge(Index& index, const std::vector<SealedSegment>& sources,
+                               const std::shared_ptr<const Segment>& merged) {
+    const uint32_t number = index.next_segment_number++;
+    Bitmap deleted;
+    deleted.Resize(merged->GetSlotCount());
+    size_t deleted_count = 0;
+    int merged_slot = 0;
+    for (const SealedSegment& source : sources) {
+        for (int slot = 0; slot < source.segment->GetSlotCount(); ++slot) {
+            if (source.deleted.Test(slot)) {
+                continue;
+            }
+            // merges move every document they keep, saved ones into the map as well
+            const int document_id = merged->GetDocument(merged_slot).id;
+            const std::optional<DocumentLocation> location = index.documents.Find(document_id);
+            if (location && location->segment == source.number && location->slot == slot) {
+                index.documents.Update(document_id, {number, merged_slot});
+            } else {
+                deleted.Set(merged_slot);
+                ++deleted_count;
+            }
+            ++merged_slot;
+        }
+    }
+    
+    index.segments.erase(std::remove_if(index.segments.begin(), index.segments.end(),
+        [&sources](const SealedSegment& sealed) {
+            return std::any_of(sources.begin(), sources.end(), [&sealed](const SealedSegment& source) {
+                return source.number == sealed.number;
+            });
+        }), index.segments.end());
+    if (deleted_count < static_cast<size_t>(merged->GetSlotCount())) {
+        index.segments.push_back({number, merged, std::move(deleted), deleted_count});
     }
 }
 
 
-std::set<int>::iterator SearchServer::begin(){
-    return document_ids_.begin();
+SearchServer SearchServer::Open(const std::string& path) {
+    return SearchServer(std::make_shared<const MappedFile>(path));
 }
 
-std::set<int>::iterator SearchServer::end(){
-    return document_ids_.end();
+void SearchServer::Verify() const {
+    index_.Read([](const Index& index) {
+        index.terms.Verify();
+        for (const SealedSegment& sealed : index.segments) {
+            sealed.segment->Verify();
+        }
+        std::optional<int> previous_id;
+        for (const int document_id : index.documents) {
+            // the saved locations have to be sorted for the binary search to find them
+            if ((previous_id && document_id <= *previous_id) || !FindLocation(index, document_id)) {
+                throw std::invalid_argument("Index file is damaged"s);
+            }
+            previous_id = document_id;
+        }
+    });
 }
+
+void SearchServer::Save(const std::string& path) const {
+    // Sealed segments are immutable, so only their list and the words are
+    // taken under the read lock; the open segment is sealed into a copy
+    std::vector<SealedSegment> segments;
+    std::vector<std::string_view> terms;
+    std::vector<uint32_t> document_freqs;
+    uint32_t next_segment_number = 0;
+    bool has_word_positions = false;
+    index_.Read([&](const Index& index) {
+        segments = index.segments;
+        next_segment_number = index.next_segment_number;
+        has_word_positions = index.has_word_positions;
+        if (index.active_segment.GetSlotCount() > 0) {
+            auto active = std::make_shared<Segment>(Segment::Merge({{&index.active_segment, &index.active_deleted}}));
+            if (active->GetSlotCount() > 0) {
+                Bitmap deleted;
+                deleted.Resize(active->GetSlotCount());
+                segments.push_back({next_segment_number++, std::move(active), std::move(deleted), 0});
+            }
+        }
+        // words are never moved or freed, the views outlive the lock
+        terms.reserve(index.terms.size());
+        for (size_t term_id = 0; term_id < index.terms.size(); ++term_id) {
+            terms.push_back(index.terms.GetTerm(static_cast<int>(term_id)));
+        }
+        document_freqs = index.document_freqs;
+    });
+    document_freqs.resize(terms.size());
+    
+    IndexFileWriter writer(path);
+    IndexFileHeader header{};
+    std::copy(std::begin(IndexFileHeader::MAGIC), std::end(IndexFileHeader::MAGIC), header.magic);
+    header.version = IndexFileHeader::VERSION;
+    header.byte_order = IndexFileHeader::BYTE_ORDER_MARK;
+    writer.WriteWords(std::vector<std::string_view>(stop_words_.begin(), stop_words_.end()),
+                      header.stop_word_offsets, header.stop_word_chars);
+    TermDictionary::Save(terms, writer, header);
+    header.document_freqs = writer.Write(ArrayView<uint32_t>(document_freqs.data(), document_freqs.size()));
+    
+    std::vector<SegmentFileHeader> segment_headers;
+    std::vector<IndexFileLocation> locations;
+    for (const SealedSegment& sealed : segments) {
+        segment_headers.push_back(sealed.segment->Save(writer, sealed.number, sealed.deleted));
+        for (int slot = 0; slot < sealed.segment->GetSlotCount(); ++slot) {
+            if (!sealed.deleted.Test(slot)) {
+                locations.push_back({sealed.segment->GetDocument(slot).id, sealed.number, slot});
+            }
+        }
+    }
+    std::sort(locations.begin(), locations.end(), [](const IndexFileLocation& lhs, const IndexFileLocation& rhs) {
+        return lhs.document_id < rhs.document_id;
+    });
+    header.locations = writer.Write(ArrayView<IndexFileLocation>(locations.data(), locations.size()));
+    header.segments = writer.Write(ArrayView<SegmentFileHeader>(segment_headers.data(), segment_headers.size()));
+    header.next_segment_number = next_segment_number;
+    header.flags = has_word_positions ? IndexFileHeader::WORD_POSITIONS : 0;
+    if (tokenizer_.IsFoldingCase()) {
+        header.flags |= IndexFileHeader::FOLDING_CASE;
+    }
+    for (const char delimiter : tokenizer_.GetDelimiters()) {
+        header.delimiters[delimiter / 64] |= uint64_t{1} << (delimiter % 64);
+    }
+    writer.Finish(header);
+}
+
+// Postings, document data, words, document locations and tombstones stay
+// in the mapping, only the sizes of the arrays are checked here. Records
+// are checked when they are first read, FindLocation checks a location and
+// its document. Only the document frequencies are read in, for their logs.
+SearchServer::SearchServer(std::shared_ptr<const MappedFile> file)
+    : stop_words_(ReadStopWords(*file))
+    , tokenizer_(ReadTokenizer(GetFileHeader(*file))) {
+    const IndexFileHeader& header = GetFileHeader(*file);
+    const ArrayView<uint32_t> document_freqs = GetArray<uint32_t>(*file, header.document_freqs);
+    std::vector<SealedSegment> segments;
+    for (const SegmentFileHeader& segment_header : GetArray<SegmentFileHeader>(*file, header.segments)) {
+        // FindSegment searches the numbers in order
+        if ((!segments.empty() && segment_header.number <= segments.back().number)
+            || segment_header.number >= header.next_segment_number) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        // every term has a document frequency
+        auto segment = std::make_shared<const Segment>(Segment::Open(file, segment_header, document_freqs.size()));
+        const size_t slot_count = segment->GetSlotCount();
+        const ArrayView<uint64_t> deleted_words = GetArray<uint64_t>(*file, segment_header.deleted);
+        if (deleted_words.size() < (slot_count + 63) / 64 || segment_header.deleted_count > slot_count) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        segments.push_back({segment_header.number, std::move(segment), Bitmap(deleted_words, slot_count),
+                            segment_header.deleted_count});
+    }
+    const ArrayView<IndexFileLocation> locations = GetArray<IndexFileLocation>(*file, header.locations);
+    
+    index_.Modify([&](Index& index) {
+        TermDictionary terms = TermDictionary::Open(file, header);
+        if (terms.size() != document_freqs.size()) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        index.terms = std::move(terms);
+        ResizeDocumentFreqs(index);
+        for (size_t term_id = 0; term_id < document_freqs.size(); ++term_id) {
+            AddDocumentFreq(index, static_cast<int>(term_id), document_freqs[term_id]);
+        }
+        index.segments = segments;
+        index.next_segment_number = header.next_segment_number;
+        index.has_word_positions = (header.flags & IndexFileHeader::WORD_POSITIONS) != 0;
+        index.documents = DocumentMap(locations);
+    });
+    if (segments.size() >= SEGMENT_MERGE_FACTOR) {
+        RequestMerge();
+    }
+}
+
+const IndexFileHeader& SearchServer::GetFileHeader(const MappedFile& file) {
+    if (file.size() < sizeof(IndexFileHeader)) {
+        throw std::invalid_argument("Not an index file"s);
+    }
+    const auto& header = *reinterpret_cast<const IndexFileHeader*>(file.data());
+    if (!std::equal(std::begin(header.magic), std::end(header.magic), std::begin(IndexFileHeader::MAGIC))) {
+        throw std::invalid_argument("Not an index file"s);
+    }
+    if (header.version != IndexFileHeader::VERSION || header.byte_order != IndexFileHeader::BYTE_ORDER_MARK) {
+        throw std::invalid_argument("Unsupported index file version"s);
+    }
+    return header;
+}
+
+Tokenizer SearchServer::ReadTokenizer(const IndexFileHeader& header) {
+    std::string delimiters;
+    for (int c = 0; c < 128; ++c) {
+        if ((header.delimiters[c / 64] >> (c % 64)) & 1) {
+            delimiters += static_cast<char>(c);
+        }
+    }
+    if (delimiters.empty()) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    return Tokenizer(delimiters, (header.flags & IndexFileHeader::FOLDING_CASE) != 0);
+}
+
+FlatStringSet SearchServer::ReadStopWords(const MappedFile& file) {
+    const IndexFileHeader& header = GetFileHeader(file);
+    const ArrayView<uint64_t> offsets = GetArray<uint64_t>(file, header.stop_word_offsets);
+    const ArrayView<char> chars = GetArray<char>(file, header.stop_word_chars);
+    std::vector<std::string> stop_words;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        stop_words.emplace_back(GetWord(offsets, chars, i));
+    }
+    return FlatStringSet(std::move(stop_words));
+}
+
+DocumentMap::Iterator SearchServer::begin() const {
+    return index_.GetUnsynchronized().documents.begin();
+}
+
+DocumentMap::Iterator SearchServer::end() const {
+    return index_.GetUnsynchronized().documents.end();
+}
\ No newline at end of file
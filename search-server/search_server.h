@@ -13,60 +13,146 @@
 #include <iterator>
 #include <execution>
 #include <future>
+#include <thread>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <exception>
 
 #include "document.h"
+#include "flat_string_set.h"
 #include "read_input_functions.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "score_accumulator.h"
+#include "top_documents.h"
+#include "small_vector.h"
+#include "left_right.h"
+#include "segment.h"
+#include "bitmap.h"
+#include "document_map.h"
+#include "index_file.h"
+#include "word_set_fingerprint.h"
+#include "result_cache.h"
+#include "boolean_query.h"
+#include "plain_query.h"
+#include "metrics.h"
+#include "query_iterator.h"
+#include "tokenizer.h"
 
 using namespace std::string_literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+// documents of the open segment before it is sealed
+const int SEGMENT_DOCUMENT_COUNT = 4096;
+// sealed segments of a similar size that are merged into one
+const size_t SEGMENT_MERGE_FACTOR = 8;
 
+// How plain queries score their plus words. AUTO prunes with MaxScore
+// when several words compete for a top much smaller than their postings,
+// the others force one way for every query, which gives the same results.
+enum class ScoringStrategy {
+    AUTO,
+    TERM_AT_A_TIME,
+    MAX_SCORE,
+};
+
+// A page of search results in ranking order
+struct DocumentPage {
+    std::vector<Document> documents;
+    // search_after of the next page, empty when this page is not full
+    std::string next_cursor;
+};
+
+// Searches, matching and GetWordFrequencies may run concurrently with
+// AddDocument and RemoveDocument and never wait for them. Writers are
+// serialized and see the index as of the previous write. Iterating the
+// document ids is not synchronized with writers.
+//
+// New documents are appended to a small open segment. A full segment is
+// sealed and never changes again; a background thread merges sealed
+// segments of similar size. Removed documents are marked in a bitmap and
+// skipped by searches until a merge drops them.
+//
+// Save writes the index to a file that Open maps and searches in place.
+//
+// Documents and queries are split into words by the tokenizer given at
+// construction, which by default splits on spaces and keeps case. Stop
+// words are folded the same way as the words they are compared with.
 class SearchServer {
 public:
     template <typename StringContainer>
-    SearchServer(const StringContainer& stop_words);
+    SearchServer(const StringContainer& stop_words, const Tokenizer& tokenizer = Tokenizer());
+    
+    // The stop words of the text are split by the tokenizer, like documents
+    explicit SearchServer(const std::string& stop_words_text, const Tokenizer& tokenizer = Tokenizer());
+    explicit SearchServer(const std::string_view stop_words_text, const Tokenizer& tokenizer = Tokenizer());
+    
+    ~SearchServer();
+    
+    // Server that searches the index saved at path without reading it in,
+    // pages of the file are loaded as queries touch them. Only the sizes of
+    // the saved arrays are checked: throws std::invalid_argument if they do
+    // not fit the file. Words, documents and posting blocks are checked when
+    // they are first read, so searches, matches and removals throw
+    // std::invalid_argument as well when they reach a damaged record.
+    static SearchServer Open(const std::string& path);
     
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(const std::string_view stop_words_text);
+    // Reads every record that Open leaves to its first use and throws
+    // std::invalid_argument if one is damaged. Servers that were not opened
+    // from a file always pass.
+    void Verify() const;
+    
+    // Writes a snapshot of the index, concurrent writers are not blocked
+    void Save(const std::string& path) const;
     
  
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings);
     
+    // Adds all of the documents or none of them: ids are checked before
+    // anything is indexed. The parallel version tokenizes the documents and
+    // builds their segments concurrently. The segments are built without the
+    // writer lock, which is taken to intern the words and to publish them.
+    // Throws std::logic_error, adding none of the documents, if
+    // EnableWordPositions succeeds while the segments are built.
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+    
+    void AddDocuments(std::execution::sequenced_policy policy, const std::vector<DocumentInput>& documents);
+    
+    void AddDocuments(std::execution::parallel_policy policy, const std::vector<DocumentInput>& documents);
+    
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query,
-        DocumentPredicate document_predicate) const ;
+        DocumentPredicate document_predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const ;
     
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query,
-        DocumentPredicate document_predicate) const ;
+        DocumentPredicate document_predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const ;
     
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query,
-        DocumentPredicate document_predicate) const ;
+        DocumentPredicate document_predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const ;
  
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-        return FindTopDocuments(std::execution::seq, 
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocuments(std::execution::seq, raw_query, status, top_k);
     }
     
-    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentStatus status) const {
-        return FindTopDocuments(policy, 
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentStatus status,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindCachedTopDocuments(policy, raw_query, status, TopDocuments(top_k));
     }
     
-    std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentStatus status) const {
-        return FindTopDocuments(policy, 
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentStatus status,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindCachedTopDocuments(policy, raw_query, status, TopDocuments(top_k));
     }
  
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const {
@@ -81,7 +167,58 @@ public:
         return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
     }
     
+    // Results page by page: search_after is the next_cursor of the previous
+    // page, empty for the first one. A page ranks only the documents after
+    // the cursor into a heap of page_size, so a deep page costs a scan of
+    // the postings like the first one and no sort of the pages before it.
+    // Pages by status are kept in the result cache when it is on. Throws
+    // std::invalid_argument for a cursor that no page returned.
+    DocumentPage FindDocumentPage(const std::string_view raw_query, DocumentStatus status, size_t page_size,
+        const std::string_view search_after = {}) const;
+    
+    DocumentPage FindDocumentPage(std::execution::sequenced_policy policy, const std::string_view raw_query,
+        DocumentStatus status, size_t page_size, const std::string_view search_after = {}) const;
+    
+    DocumentPage FindDocumentPage(std::execution::parallel_policy policy, const std::string_view raw_query,
+        DocumentStatus status, size_t page_size, const std::string_view search_after = {}) const;
+    
+    template <typename DocumentPredicate>
+    DocumentPage FindDocumentPage(const std::string_view raw_query, DocumentPredicate document_predicate,
+        size_t page_size, const std::string_view search_after = {}) const;
+    
     int GetDocumentCount() const;
+    
+    // Segments sealed and not merged away yet, the open segment not included
+    size_t GetSealedSegmentCount() const;
+    
+    // Blocks until the background thread has done every merge requested so
+    // far and no segments need merging
+    void WaitForMerges();
+    
+    // Caches the results of searches by status, searches with a predicate
+    // bypass the cache. Adding or removing a document invalidates it.
+    // A zero limit, the default, turns the cache off.
+    void SetResultCacheLimit(size_t memory_bytes);
+    
+    ResultCacheStats GetResultCacheStats() const;
+    
+    // Keeps the position of every word, so queries can use phrases and
+    // NEAR. It costs four bytes per word, so it is off by default and can
+    // only be turned on before the first document is added.
+    void EnableWordPositions();
+    
+    bool HasWordPositions() const;
+    
+    // Lets queries use the syntax of boolean_query.h: a query with quotes,
+    // parentheses or an operator is parsed as a boolean query. Until then
+    // every query is plus and minus words, whatever characters it has.
+    void EnableBooleanQueries();
+    
+    bool HasBooleanQueries() const;
+    
+    void SetScoringStrategy(ScoringStrategy strategy);
+    
+    ScoringStrategy GetScoringStrategy() const;
  
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
     
@@ -91,194 +228,827 @@ public:
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument
         (std::execution::parallel_policy policy, const std::string_view raw_query, int document_id) const;
     
+    // Matches the query against every listed document, results follow the
+    // order of document_ids. The query is parsed and looked up once, which
+    // makes highlighting a page of results cheaper than a call per document.
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        const std::string_view raw_query, const std::vector<int>& document_ids) const;
+    
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        std::execution::sequenced_policy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const;
+    
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        std::execution::parallel_policy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const;
+    
     const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
     
+    // Fingerprint of the set of distinct words of the document, documents
+    // with equal fingerprints have the same words
+    WordSetFingerprint GetWordSetFingerprint(int document_id) const;
+    
+    // Calls function(word) for every distinct word of the document without
+    // building a map, the views stay valid as long as the server
+    template <typename Function>
+    void ForEachDocumentWord(int document_id, Function function) const;
+    
     void RemoveDocument(int document_id);
     
     void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
     
     void RemoveDocument(std::execution::parallel_policy policy, int document_id);
     
-    std::set<int>::iterator begin();
+    DocumentMap::Iterator begin() const;
     
-    std::set<int>::iterator end();
+    DocumentMap::Iterator end() const;
     
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    using TermFreq = Segment::TermFreq;
+    using DocumentData = Segment::DocumentData;
+    
+    // Segment number of the documents in the open segment
+    static constexpr uint32_t ACTIVE_SEGMENT = std::numeric_limits<uint32_t>::max();
+    
+    using DocumentLocation = DocumentMap::Location;
+    
+    struct SealedSegment {
+        uint32_t number;
+        std::shared_ptr<const Segment> segment;
+        // removed documents, they are dropped when the segment is merged
+        Bitmap deleted;
+        size_t deleted_count;
+    };
+    
+    // Everything AddDocument, RemoveDocument and merges change. The copies
+    // share sealed segments, only the open segment exists twice.
+    struct Index {
+        TermDictionary terms;
+        // number of live documents containing the term, indexed by term id
+        std::vector<uint32_t> document_freqs;
+        // log of document_freqs, updated together with them, so a query takes
+        // one log of the document count instead of one per term
+        std::vector<double> log_document_freqs;
+        // sorted by number
+        std::vector<SealedSegment> segments;
+        uint32_t next_segment_number = 0;
+        Segment active_segment;
+        Bitmap active_deleted;
+        DocumentMap documents;
+        // changes whenever the set of documents does, cached results of
+        // other generations are stale
+        uint64_t generation = 0;
+        // segments keep the positions of words, which phrase and NEAR queries need
+        bool has_word_positions = false;
     };
     
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string, double>> ids_word_freqs_;
+    // Slots [first_slot, last_slot) of a segment
+    struct SegmentRange {
+        const Segment* segment;
+        const Bitmap* deleted;
+        int first_slot;
+        int last_slot;
+    };
+    
+    // A parallel algorithm terminates when its function throws, so the
+    // function runs its work through Catch and the first exception, such as
+    // a damaged record of an opened index, is rethrown after the algorithm
+    class ParallelError {
+    public:
+        template <typename Function>
+        void Catch(Function function) {
+            try {
+                function();
+            } catch (...) {
+                std::lock_guard guard(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+        
+        void Rethrow() const {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+        
+    private:
+        std::mutex mutex_;
+        std::exception_ptr error_;
+    };
+    
+    const FlatStringSet stop_words_;
+    const Tokenizer tokenizer_;
+    // readers use one copy of the index while writers update the other
+    LeftRight<Index> index_;
     std::map<std::string_view, double> empty_word_freqs_ = {};
+    mutable ResultCache result_cache_;
+    std::atomic<bool> has_boolean_queries_ = false;
+    std::atomic<ScoringStrategy> scoring_strategy_ = ScoringStrategy::AUTO;
+    
+    std::mutex merge_mutex_;
+    std::condition_variable merge_condition_;
+    bool is_merge_requested_ = false;
+    bool is_merging_ = false;
+    // signaled when the merge thread runs out of merges
+    std::condition_variable merges_done_condition_;
+    bool is_stopping_ = false;
+    // started by the first sealed segment
+    std::thread merge_thread_;
     
     bool IsStopWord(const std::string_view word) const;
     
+    bool IsBooleanSyntax(const std::string_view raw_query) const;
+    
     static bool IsValidWord(const std::string_view word);
     
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // positions gets the position of every word returned, counting stop
+    // words. The words are views into text or, when case is folded, into folded.
+    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text, std::string& folded,
+                                                       std::vector<uint32_t>& positions) const;
+    
+    template <typename StringContainer>
+    static FlatStringSet MakeStopWords(const StringContainer& stop_words, const Tokenizer& tokenizer);
     
     static int ComputeAverageRating(const std::vector<int>& ratings);
     
-    struct QueryWord {
-        std::string_view data;
-        bool is_minus;
-        bool is_stop;
+    using Query = PlainQuery;
+    
+    // Query buffer of the calling thread, reusing it keeps the heap storage
+    // of long queries between calls
+    static Query& GetThreadQuery();
+    
+    static double ComputeWordInverseDocumentFreq(const Index& index, double log_document_count, int term_id);
+    
+    // Grows the document frequency tables to the size of the dictionary
+    static void ResizeDocumentFreqs(Index& index);
+    
+    static void AddDocumentFreq(Index& index, int term_id, int64_t delta);
+    
+    static double ComputeTermFreq(const Segment& segment, const PostingListView::Cursor& cursor);
+    
+    static bool HasTerm(ArrayView<TermFreq> term_freqs, int term_id);
+    
+    // Returns TermDictionary::NO_TERM for words no live document contains
+    static int FindIndexedTerm(const Index& index, const std::string_view word);
+    
+    using TermIds = SmallVector<int, 16>;
+    
+    template <typename StringContainer>
+    static TermIds FindIndexedTerms(const Index& index, const StringContainer& words);
+    
+    // Plus and minus words of a query resolved to indexed term ids
+    struct QueryTerms {
+        TermIds plus_terms;
+        TermIds minus_terms;
+        // inverse document frequency of every plus term
+        SmallVector<double, 16> inverse_document_freqs;
     };
     
-    QueryWord ParseQueryWord(const std::string_view text) const;
+    static QueryTerms ResolveQueryTerms(const Index& index, const Query& query);
+    
+    template <typename StringContainer>
+    static QueryTerms ResolveQueryTerms(const Index& index, const StringContainer& plus_words,
+                                        const StringContainer& minus_words);
     
-    struct Query {
-        std::set<std::string, std::less<>> plus_words;
-        std::set<std::string, std::less<>> minus_words;
+    // A boolean query resolved against the index. Documents are selected by
+    // the plan and scored like a plain query of all its plus words.
+    struct BooleanQueryPlan {
+        // nullopt when no document can match
+        std::optional<QueryPlanNode> root;
+        QueryTerms terms;
     };
-    struct ParQuery {
-        std::vector<std::string> plus_words;
-        std::vector<std::string> minus_words;
+    
+    // Throws std::invalid_argument for phrases and NEAR when the index has no word positions
+    static BooleanQueryPlan CompileBooleanQuery(const Index& index, const BooleanQuery& query);
+    
+    // nullopt when some word of an AND, phrase or NEAR is in no live document
+    static std::optional<QueryPlanNode> CompileQueryNode(const Index& index, const QueryNode& node);
+    
+    // Runs find_in_range(range, top) over the ranges of the index and merges the tops.
+    // Every range gets a copy of empty_top, with its capacity and search_after bound.
+    template <typename RangeFunction>
+    static std::vector<Document> FindTopInRanges(std::execution::sequenced_policy policy, const Index& index,
+        const TopDocuments& empty_top, RangeFunction find_in_range);
+    
+    template <typename RangeFunction>
+    static std::vector<Document> FindTopInRanges(std::execution::parallel_policy policy, const Index& index,
+        const TopDocuments& empty_top, RangeFunction find_in_range);
+    
+    template <typename DocumentPredicate>
+    static std::vector<Document> FindTopInIndex(std::execution::sequenced_policy policy, const Index& index,
+        const Query& query, ScoringStrategy strategy, DocumentPredicate& document_predicate,
+        const TopDocuments& empty_top);
+    
+    template <typename DocumentPredicate>
+    static std::vector<Document> FindTopInIndex(std::execution::parallel_policy policy, const Index& index,
+        const Query& query, ScoringStrategy strategy, DocumentPredicate& document_predicate,
+        const TopDocuments& empty_top);
+    
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    static std::vector<Document> FindTopInIndex(ExecutionPolicy policy, const Index& index,
+        const BooleanQuery& query, DocumentPredicate& document_predicate, const TopDocuments& empty_top);
+    
+    // Predicate of the searches by status. Scoring recognizes it and tests
+    // the status bitmap of the segment instead of reading the document.
+    struct StatusPredicate {
+        DocumentStatus status;
+        
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
     };
     
-    Query ParseQuery(const std::string_view text) const;
+    template <typename DocumentPredicate>
+    static constexpr bool IS_STATUS_PREDICATE = std::is_same_v<std::remove_const_t<DocumentPredicate>, StatusPredicate>;
     
-    ParQuery ParParseQuery(const std::string_view text) const;
+    // The best documents that fit into empty_top
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindBoundedTop(ExecutionPolicy policy, const std::string_view raw_query,
+        DocumentPredicate& document_predicate, const TopDocuments& empty_top) const;
     
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
- 
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindCachedTopDocuments(ExecutionPolicy policy, const std::string_view raw_query,
+        DocumentStatus status, const TopDocuments& empty_top) const;
+    
+    // Parsed query words are sorted and unique, so equivalent queries get the same key
+    static std::string MakeResultCacheKey(const Query& query, DocumentStatus status, const TopDocuments& empty_top);
+    
+    // Throws std::invalid_argument when search_after is not a cursor of a page
+    static TopDocuments MakePageTop(size_t page_size, const std::string_view search_after);
+    
+    static DocumentPage MakeDocumentPage(std::vector<Document> documents, size_t page_size);
+    
+    struct SegmentTerm {
+        PostingListView postings;
+        double inverse_document_freq;
+        // position in the query, term scores are summed in this order
+        size_t term_index;
+    };
+    
+    // Posting lists of the query terms that occur in one segment
+    struct SegmentTerms {
+        SmallVector<SegmentTerm, 16> plus_terms;
+        SmallVector<PostingListView, 16> minus_terms;
+    };
+    
+    // Index position of the sealed segment with the given number
+    static size_t FindSegment(const Index& index, uint32_t number);
+    
+    struct StoredDocument {
+        const Segment* segment;
+        int slot;
+    };
+    
+    // Empty for unknown and removed documents. Locations read from an index
+    // file are checked here, throws std::invalid_argument if one is damaged.
+    static std::optional<DocumentLocation> FindLocation(const Index& index, int document_id);
+    
+    // segment is nullptr for unknown and removed documents
+    static StoredDocument FindDocument(const Index& index, int document_id);
+    
+    // Throws std::out_of_range for unknown and removed documents
+    static StoredDocument FindExistingDocument(const Index& index, int document_id);
+    
+    // Plus terms of the query the document contains, none if it contains a
+    // minus term. Membership is checked in the forward index of the document.
+    static std::tuple<std::vector<std::string_view>, DocumentStatus> MatchInIndex(const Index& index,
+        const TermIds& plus_terms, const TermIds& minus_terms, StoredDocument document);
+    
+    // Plus words of the query the document contains if it matches the
+    // query, none otherwise
+    static std::tuple<std::vector<std::string_view>, DocumentStatus> MatchInIndex(const Index& index,
+        const BooleanQueryPlan& plan, StoredDocument document);
+    
+    template <typename ExecutionPolicy>
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocumentBatch(
+        ExecutionPolicy policy, const std::string_view raw_query, const std::vector<int>& document_ids) const;
+    
+    // Splits the slots of all segments into about chunk_count ranges,
+    // every non-empty segment gets at least one
+    static std::vector<SegmentRange> SplitIntoRanges(const Index& index, int chunk_count);
+    
+    // Adds the best documents of the range to top
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::sequenced_policy policy, Query& query, DocumentPredicate document_predicate) const;
+    static void FindTopInRange(const SegmentRange& range, const QueryTerms& terms, ScoringStrategy strategy,
+                               DocumentPredicate& document_predicate, TopDocuments& top);
     
+    // Adds the best documents of the range that match the plan to top
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::parallel_policy policy, ParQuery& query, DocumentPredicate document_predicate) const;
+    static void FindBooleanTopInRange(const SegmentRange& range, const BooleanQueryPlan& plan,
+                                      DocumentPredicate& document_predicate, TopDocuments& top);
+    
+    // Term at a time: scores every posting of every plus word
+    template <typename DocumentPredicate>
+    static void ScoreTermsAtATime(const SegmentRange& range, const SegmentTerms& terms, size_t expected_count,
+                                  DocumentPredicate& document_predicate, TopDocuments& top);
+    
+    // Document at a time with MaxScore pruning: documents whose score bound
+    // cannot reach the current top are skipped without reading all their terms
+    template <typename DocumentPredicate>
+    static void ScoreMaxScore(const SegmentRange& range, const SegmentTerms& terms,
+                              DocumentPredicate& document_predicate, TopDocuments& top);
+    
+    // Whether the document in the slot is live and passes the predicate
+    template <typename DocumentPredicate>
+    static bool IsAccepted(const SegmentRange& range, int slot, DocumentPredicate& document_predicate);
+    
+    // Moves every minus word cursor to slot and reports whether one lands on it
+    static bool IsExcluded(std::vector<PostingListView::Cursor>& minus_cursors, int slot);
+    
+    // Marks the document deleted, returns whether its segment wants a merge
+    static bool RemoveFromIndex(Index& index, int document_id);
+    
+    // Moves the full open segment, already sealed as segment, to the sealed ones
+    static void SealActiveSegment(Index& index, std::shared_ptr<const Segment> segment);
+    
+    // Adds a sealed segment of new documents
+    static void AddSealedSegment(Index& index, std::shared_ptr<const Segment> segment);
+    
+    template <typename ExecutionPolicy>
+    void AddDocumentBatch(ExecutionPolicy policy, const std::vector<DocumentInput>& documents);
+    
+    void RequestMerge();
+    
+    void RunMerges();
+    
+    // Performs one merge, returns false when no segments need merging
+    bool MergeSegments();
     
+    // Tiered policy: a tier holds segments of similar size, SEGMENT_MERGE_FACTOR
+    // segments of a tier are merged into one of the next tier. A segment with
+    // more than half of its documents deleted is rewritten alone.
+    static std::vector<SealedSegment> SelectMerge(const Index& index);
+    
+    // Replaces the merged sources with the result. Documents removed while
+    // the merge ran are marked deleted in the result.
+    static void CommitMerge(Index& index, const std::vector<SealedSegment>& sources,
+                            const std::shared_ptr<const Segment>& merged);
+    
+    // Server over the index in the mapped file, see Open
+    explicit SearchServer(std::shared_ptr<const MappedFile> file);
+    
+    // Header of a saved index, checked to be one this version can read
+    static const IndexFileHeader& GetFileHeader(const MappedFile& file);
+    
+    static FlatStringSet ReadStopWords(const MappedFile& file);
+    
+    static Tokenizer ReadTokenizer(const IndexFileHeader& header);
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+SearchServer::SearchServer(const StringContainer& stop_words, const Tokenizer& tokenizer)
+    : stop_words_(MakeStopWords(stop_words, tokenizer))  // Extract non-empty stop words
+    , tokenizer_(tokenizer)
 {
     if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
 }
 
+template <typename StringContainer>
+FlatStringSet SearchServer::MakeStopWords(const StringContainer& stop_words, const Tokenizer& tokenizer) {
+    std::vector<std::string> words;
+    for (const std::string& word : MakeUniqueNonEmptyStrings(stop_words)) {
+        words.push_back(word);
+        tokenizer.FoldCase(words.back().data(), words.back().size());
+    }
+    return FlatStringSet(std::move(words));
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query,
-        DocumentPredicate document_predicate) const {
+        DocumentPredicate document_predicate, size_t top_k) const {
     return FindTopDocuments(std::execution::seq, raw_query,
-    document_predicate);
+    document_predicate, top_k);
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query,
-    DocumentPredicate document_predicate) const {
-    auto query = ParseQuery(raw_query);
+    DocumentPredicate document_predicate, size_t top_k) const {
+    return FindBoundedTop(policy, raw_query, document_predicate, TopDocuments(top_k));
+}
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t top_k) const {
+    return FindBoundedTop(policy, raw_query, document_predicate, TopDocuments(top_k));
+}
 
-    std::sort(policy, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            return lhs.relevance > rhs.relevance
-                || (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindDocumentPage(const std::string_view raw_query, DocumentPredicate document_predicate,
+    size_t page_size, const std::string_view search_after) const {
+    return MakeDocumentPage(FindBoundedTop(std::execution::seq, raw_query, document_predicate,
+                                           MakePageTop(page_size, search_after)), page_size);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindBoundedTop(ExecutionPolicy policy, const std::string_view raw_query,
+    DocumentPredicate& document_predicate, const TopDocuments& empty_top) const {
+    METRICS_ADD(QUERIES, 1);
+    if (IsBooleanSyntax(raw_query)) {
+        const BooleanQuery query = ParseBooleanQuery(raw_query, stop_words_, tokenizer_);
+        return index_.Read([&](const Index& index) {
+            return FindTopInIndex(policy, index, query, document_predicate, empty_top);
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
-    return matched_documents;
+    Query& query = GetThreadQuery();
+    ParsePlainQuery(raw_query, stop_words_, tokenizer_, query);
+    const ScoringStrategy strategy = GetScoringStrategy();
+    return index_.Read([&](const Index& index) {
+        return FindTopInIndex(policy, index, query, strategy, document_predicate, empty_top);
+    });
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query,
-    DocumentPredicate document_predicate) const {
-    auto query = ParParseQuery(raw_query);
+std::vector<Document> SearchServer::FindTopInIndex(std::execution::sequenced_policy policy, const Index& index,
+    const Query& query, ScoringStrategy strategy, DocumentPredicate& document_predicate,
+    const TopDocuments& empty_top) {
+    const QueryTerms terms = ResolveQueryTerms(index, query);
+    return FindTopInRanges(policy, index, empty_top, [&](const SegmentRange& range, TopDocuments& top) {
+        FindTopInRange(range, terms, strategy, document_predicate, top);
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopInIndex(std::execution::parallel_policy policy, const Index& index,
+    const Query& query, ScoringStrategy strategy, DocumentPredicate& document_predicate,
+    const TopDocuments& empty_top) {
+    const QueryTerms terms = ResolveQueryTerms(index, query);
+    return FindTopInRanges(policy, index, empty_top, [&](const SegmentRange& range, TopDocuments& top) {
+        FindTopInRange(range, terms, strategy, document_predicate, top);
+    });
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopInIndex(ExecutionPolicy policy, const Index& index,
+    const BooleanQuery& query, DocumentPredicate& document_predicate, const TopDocuments& empty_top) {
+    const BooleanQueryPlan plan = CompileBooleanQuery(index, query);
+    return FindTopInRanges(policy, index, empty_top, [&](const SegmentRange& range, TopDocuments& top) {
+        FindBooleanTopInRange(range, plan, document_predicate, top);
+    });
+}
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename RangeFunction>
+std::vector<Document> SearchServer::FindTopInRanges(std::execution::sequenced_policy, const Index& index,
+    const TopDocuments& empty_top, RangeFunction find_in_range) {
+    TopDocuments top = empty_top;
+    for (const SegmentRange& range : SplitIntoRanges(index, 1)) {
+        find_in_range(range, top);
+    }
+    METRICS_SCOPED_TIMER(TOP_K_SELECTION);
+    return top.Extract();
+}
 
-    std::sort(policy, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            return lhs.relevance > rhs.relevance
-                || (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
+template <typename RangeFunction>
+std::vector<Document> SearchServer::FindTopInRanges(std::execution::parallel_policy policy, const Index& index,
+    const TopDocuments& empty_top, RangeFunction find_in_range) {
+    // Every range selects its own top, the partial tops are merged at the end
+    const auto ranges = SplitIntoRanges(index, static_cast<int>(std::thread::hardware_concurrency()) * 4);
+    std::vector<TopDocuments> range_tops(ranges.size(), empty_top);
+    std::vector<size_t> range_indexes(ranges.size());
+    std::iota(range_indexes.begin(), range_indexes.end(), 0);
+    ParallelError error;
+    for_each (policy, range_indexes.begin(), range_indexes.end(), [&](size_t range_index) {
+        error.Catch([&] {
+            find_in_range(ranges[range_index], range_tops[range_index]);
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    });
+    error.Rethrow();
+    
+    METRICS_SCOPED_TIMER(TOP_K_SELECTION);
+    TopDocuments top = empty_top;
+    for (const TopDocuments& range_top : range_tops) {
+        top.Merge(range_top);
+    }
+    return top.Extract();
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindCachedTopDocuments(ExecutionPolicy policy, const std::string_view raw_query,
+    DocumentStatus status, const TopDocuments& empty_top) const {
+    StatusPredicate document_predicate{status};
+    // boolean queries are not cached, their keys would need the whole tree
+    if (!result_cache_.IsEnabled() || IsBooleanSyntax(raw_query)) {
+        return FindBoundedTop(policy, raw_query, document_predicate, empty_top);
     }
-    return matched_documents;
+    METRICS_ADD(QUERIES, 1);
+    Query& query = GetThreadQuery();
+    ParsePlainQuery(raw_query, stop_words_, tokenizer_, query);
+    const std::string key = MakeResultCacheKey(query, status, empty_top);
+    const ScoringStrategy strategy = GetScoringStrategy();
+    return index_.Read([&](const Index& index) {
+        if (auto documents = result_cache_.Find(key, index.generation)) {
+            return std::move(*documents);
+        }
+        auto documents = FindTopInIndex(policy, index, query, strategy, document_predicate, empty_top);
+        result_cache_.Insert(key, index.generation, documents);
+        return documents;
+    });
+}
+
+template <typename Function>
+void SearchServer::ForEachDocumentWord(int document_id, Function function) const {
+    index_.Read([&](const Index& index) {
+        const auto [segment, slot] = FindDocument(index, document_id);
+        if (segment == nullptr) {
+            return;
+        }
+        for (const TermFreq& term_freq : segment->GetTermFreqs(slot)) {
+            function(index.terms.GetTerm(term_freq.term_id));
+        }
+    });
+}
+
+inline double SearchServer::ComputeTermFreq(const Segment& segment, const PostingListView::Cursor& cursor) {
+    return cursor.GetCount() * segment.GetDocument(cursor.GetSlot()).inv_word_count;
+}
+
+template <typename StringContainer>
+SearchServer::TermIds SearchServer::FindIndexedTerms(const Index& index, const StringContainer& words) {
+    TermIds term_ids;
+    for (const std::string_view word : words) {
+        const int term_id = FindIndexedTerm(index, word);
+        if (term_id != TermDictionary::NO_TERM) {
+            term_ids.push_back(term_id);
+        }
+    }
+    return term_ids;
+}
+
+template <typename StringContainer>
+SearchServer::QueryTerms SearchServer::ResolveQueryTerms(const Index& index, const StringContainer& plus_words,
+                                                         const StringContainer& minus_words) {
+    QueryTerms terms{FindIndexedTerms(index, plus_words), FindIndexedTerms(index, minus_words), {}};
+    const double log_document_count = std::log(index.documents.size());
+    for (const int term_id : terms.plus_terms) {
+        terms.inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(index, log_document_count, term_id));
+    }
+    return terms;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy policy, Query& query,
-    DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+void SearchServer::FindTopInRange(const SegmentRange& range, const QueryTerms& terms, ScoringStrategy strategy,
+                                  DocumentPredicate& document_predicate, TopDocuments& top) {
+    if (top.GetCapacity() == 0) {
+        return;
+    }
+    METRICS_SCOPED_TIMER(POSTINGS_SCAN);
+    SegmentTerms segment_terms;
+    size_t expected_count = 0;
+    for (size_t i = 0; i < terms.plus_terms.size(); ++i) {
+        const PostingListView postings = range.segment->FindPostings(terms.plus_terms[i]);
+        if (!postings.empty()) {
+            segment_terms.plus_terms.push_back({postings, terms.inverse_document_freqs[i], i});
+            expected_count += postings.CountInRange(range.first_slot, range.last_slot);
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
+    }
+    if (segment_terms.plus_terms.empty()) {
+        return;
+    }
+    for (const int term_id : terms.minus_terms) {
+        const PostingListView postings = range.segment->FindPostings(term_id);
+        if (!postings.empty()) {
+            segment_terms.minus_terms.push_back(postings);
         }
     }
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    // Pruning needs several lists competing for far fewer results than they hold
+    const bool is_max_score = strategy == ScoringStrategy::AUTO
+        ? segment_terms.plus_terms.size() > 1 && top.GetCapacity() * 8 < expected_count
+        : strategy == ScoringStrategy::MAX_SCORE;
+    if (is_max_score) {
+        ScoreMaxScore(range, segment_terms, document_predicate, top);
+    } else {
+        ScoreTermsAtATime(range, segment_terms, expected_count, document_predicate, top);
+    }
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindBooleanTopInRange(const SegmentRange& range, const BooleanQueryPlan& plan,
+                                         DocumentPredicate& document_predicate, TopDocuments& top) {
+    if (top.GetCapacity() == 0 || !plan.root) {
+        return;
+    }
+    METRICS_SCOPED_TIMER(POSTINGS_SCAN);
+    const Segment& segment = *range.segment;
+    std::vector<PostingListView::Cursor> minus_cursors;
+    for (const int term_id : plan.terms.minus_terms) {
+        minus_cursors.push_back(segment.FindPostings(term_id).GetCursor(range.first_slot, range.last_slot));
+    }
+    size_t matched_count = 0;
+    size_t rejected_count = 0;
+    size_t excluded_count = 0;
+    for (QueryIterator it(*plan.root, segment, range.first_slot, range.last_slot); !it.IsEnd(); it.Next()) {
+        const int slot = it.GetSlot();
+        ++matched_count;
+        if (!IsAccepted(range, slot, document_predicate)) {
+            ++rejected_count;
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            document_to_relevance.erase(document_id);
+        if (IsExcluded(minus_cursors, slot)) {
+            ++excluded_count;
+            continue;
         }
+        const auto& document_data = segment.GetDocument(slot);
+        // summed in query word order, like the relevance of plain queries
+        const ArrayView<TermFreq> term_freqs = segment.GetTermFreqs(slot);
+        double relevance = 0.0;
+        for (size_t i = 0; i < plan.terms.plus_terms.size(); ++i) {
+            const auto term_freq = std::lower_bound(term_freqs.begin(), term_freqs.end(), plan.terms.plus_terms[i],
+                [](const TermFreq& term_freq, int term_id) {
+                    return term_freq.term_id < term_id;
+                });
+            if (term_freq != term_freqs.end() && term_freq->term_id == plan.terms.plus_terms[i]) {
+                relevance += term_freq->count * document_data.inv_word_count * plan.terms.inverse_document_freqs[i];
+            }
+        }
+        top.Add({ document_data.id, relevance, document_data.rating });
     }
+    METRICS_ADD(POSTINGS_SCANNED, matched_count);
+    METRICS_ADD(PREDICATE_REJECTED, rejected_count);
+    METRICS_ADD(MINUS_EXCLUDED, excluded_count);
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+template <typename DocumentPredicate>
+bool SearchServer::IsAccepted(const SegmentRange& range, int slot, DocumentPredicate& document_predicate) {
+    if (range.deleted->Test(slot)) {
+        return false;
+    }
+    if constexpr (IS_STATUS_PREDICATE<DocumentPredicate>) {
+        return range.segment->HasStatus(slot, document_predicate.status);
+    } else {
+        const auto& document_data = range.segment->GetDocument(slot);
+        return document_predicate(document_data.id, document_data.status, document_data.rating);
     }
-    return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy policy, ParQuery& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(100);
-    
-    std::sort(query.plus_words.begin(), query.plus_words.end());
-    std::sort(query.minus_words.begin(), query.minus_words.end());
-    
-    query.plus_words.erase(std::unique(query.plus_words.begin(), query.plus_words.end()), query.plus_words.end());    
-    query.minus_words.erase(std::unique(query.minus_words.begin(), query.minus_words.end()), query.minus_words.end());
+void SearchServer::ScoreTermsAtATime(const SegmentRange& range, const SegmentTerms& terms, size_t expected_count,
+                                     DocumentPredicate& document_predicate, TopDocuments& top) {
+    const Segment& segment = *range.segment;
+    ScoreAccumulator slot_to_relevance(range.first_slot, range.last_slot, expected_count);
     
-    for_each (policy, query.plus_words.begin(), query.plus_words.end(), [&](const std::string_view word) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            return;
+    size_t accepted_count = 0;
+    size_t rejected_count = 0;
+    for (const SegmentTerm& term : terms.plus_terms) {
+        for (auto cursor = term.postings.GetCursor(range.first_slot, range.last_slot); !cursor.IsEnd(); cursor.Next()) {
+            if (IsAccepted(range, cursor.GetSlot(), document_predicate)) {
+                slot_to_relevance.Add(cursor.GetSlot(), ComputeTermFreq(segment, cursor) * term.inverse_document_freq);
+                ++accepted_count;
+            } else {
+                ++rejected_count;
+            }
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+    }
+    // expected_count only sizes the accumulator: it counts whole blocks that
+    // overlap the range, so blocks on range edges would be counted twice
+    METRICS_ADD(POSTINGS_SCANNED, accepted_count + rejected_count);
+    METRICS_ADD(PREDICATE_REJECTED, rejected_count);
+    if (!terms.minus_terms.empty()) {
+        METRICS_SCOPED_TIMER(MINUS_EXCLUSION);
+        size_t excluded_count = 0;
+        for (const PostingListView& postings : terms.minus_terms) {
+            for (auto cursor = postings.GetCursor(range.first_slot, range.last_slot); !cursor.IsEnd(); cursor.Next()) {
+                slot_to_relevance.Erase(cursor.GetSlot());
+                ++excluded_count;
             }
         }
+        METRICS_ADD(MINUS_EXCLUDED, excluded_count);
+    }
+    
+    slot_to_relevance.ForEach([&](int slot, double relevance) {
+        const auto& document_data = segment.GetDocument(slot);
+        top.Add({ document_data.id, relevance, document_data.rating });
+    });
+}
+
+template <typename DocumentPredicate>
+void SearchServer::ScoreMaxScore(const SegmentRange& range, const SegmentTerms& terms,
+                                 DocumentPredicate& document_predicate, TopDocuments& top) {
+    const Segment& segment = *range.segment;
+    struct ScoredCursor {
+        PostingListView::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+        size_t term_index;
+    };
+    std::vector<ScoredCursor> cursors;
+    cursors.reserve(terms.plus_terms.size());
+    for (const SegmentTerm& term : terms.plus_terms) {
+        cursors.push_back({term.postings.GetCursor(range.first_slot, range.last_slot), term.inverse_document_freq,
+                           term.postings.GetMaxTermFreq() * term.inverse_document_freq, term.term_index});
+    }
+    std::sort(cursors.begin(), cursors.end(), [](const ScoredCursor& lhs, const ScoredCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
     });
+    // bound_sums[i] is the most the i lowest-bounded terms can add together
+    std::vector<double> bound_sums(cursors.size() + 1, 0.0);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        bound_sums[i + 1] = bound_sums[i] + cursors[i].max_score;
+    }
+    std::vector<PostingListView::Cursor> minus_cursors;
+    for (const PostingListView& postings : terms.minus_terms) {
+        minus_cursors.push_back(postings.GetCursor(range.first_slot, range.last_slot));
+    }
     
-    auto ordinary_map = document_to_relevance.BuildOrdinaryMap();
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    // (term index, score) of the current document, summed in query word
+    // order so that the relevance is the same as the term-at-a-time one
+    std::vector<std::pair<size_t, double>> term_scores;
+    term_scores.reserve(cursors.size());
+    double threshold = -std::numeric_limits<double>::infinity();
+    // Documents found only in terms below first_essential cannot reach the top
+    size_t first_essential = 0;
+    const auto raise_threshold = [&] {
+        // leave room for documents within EPSILON of the worst one,
+        // they can still outrank it by rating
+        threshold = top.GetWorst().relevance - 2 * EPSILON;
+        while (first_essential < cursors.size() && bound_sums[first_essential + 1] < threshold) {
+            ++first_essential;
+        }
+    };
+    // the top may already be full from other segments
+    if (top.IsFull()) {
+        raise_threshold();
+    }
+    // documents reached, whether scored or pruned
+    size_t visited_count = 0;
+    size_t rejected_count = 0;
+    size_t excluded_count = 0;
+    while (first_essential < cursors.size()) {
+        int slot = range.last_slot;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (!cursors[i].cursor.IsEnd()) {
+                slot = std::min(slot, cursors[i].cursor.GetSlot());
+            }
+        }
+        if (slot == range.last_slot) {
+            break;
+        }
+        ++visited_count;
+        
+        // a status bit is cheaper to test than the terms are to score, other
+        // predicates wait until the bound has ruled the document out
+        if constexpr (IS_STATUS_PREDICATE<DocumentPredicate>) {
+            if (!IsAccepted(range, slot, document_predicate)) {
+                ++rejected_count;
+                for (size_t i = first_essential; i < cursors.size(); ++i) {
+                    auto& cursor = cursors[i].cursor;
+                    if (!cursor.IsEnd() && cursor.GetSlot() == slot) {
+                        cursor.Next();
+                    }
+                }
+                continue;
+            }
+        }
+        term_scores.clear();
+        double score = 0.0;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            auto& cursor = cursors[i].cursor;
+            if (!cursor.IsEnd() && cursor.GetSlot() == slot) {
+                term_scores.emplace_back(cursors[i].term_index, ComputeTermFreq(segment, cursor) * cursors[i].inverse_document_freq);
+                score += term_scores.back().second;
+                cursor.Next();
+            }
+        }
+        if (score + bound_sums[first_essential] < threshold) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(static_cast<std::string>(word))) {
-            ordinary_map.erase(document_id);
+        if (!IsAccepted(range, slot, document_predicate)) {
+            ++rejected_count;
+            continue;
+        }
+        if (IsExcluded(minus_cursors, slot)) {
+            ++excluded_count;
+            continue;
+        }
+        bool is_pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (score + bound_sums[i + 1] < threshold) {
+                is_pruned = true;
+                break;
+            }
+            auto& cursor = cursors[i].cursor;
+            cursor.SkipTo(slot);
+            if (!cursor.IsEnd() && cursor.GetSlot() == slot) {
+                term_scores.emplace_back(cursors[i].term_index, ComputeTermFreq(segment, cursor) * cursors[i].inverse_document_freq);
+                score += term_scores.back().second;
+            }
+        }
+        if (is_pruned) {
+            continue;
+        }
+        
+        std::sort(term_scores.begin(), term_scores.end());
+        const auto& document_data = segment.GetDocument(slot);
+        double relevance = 0.0;
+        for (const auto& [_, term_score] : term_scores) {
+            relevance += term_score;
+        }
+        top.Add({ document_data.id, relevance, document_data.rating });
+        if (top.IsFull()) {
+            raise_threshold();
         }
     }
-    
-    
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(ordinary_map.size());
-    for_each (ordinary_map.begin(), ordinary_map.end(), [&](const auto& doc_map) {
-        matched_documents.push_back(
-            { doc_map.first, doc_map.second, documents_.at(doc_map.first).rating });
-    });
-    return matched_documents;
+    METRICS_ADD(POSTINGS_SCANNED, visited_count);
+    METRICS_ADD(PREDICATE_REJECTED, rejected_count);
+    METRICS_ADD(MINUS_EXCLUDED, excluded_count);
 }
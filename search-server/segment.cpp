@@ -0,0 +1,322 @@
+#include "segment.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+int Segment::AddDocument(int document_id, int rating, DocumentStatus status, double inv_word_count,
+                         WordSetFingerprint fingerprint, const std::vector<TermFreq>& term_freqs,
+                         const std::vector<uint32_t>& word_positions) {
+    assert(!is_sealed_);
+    const int slot = static_cast<int>(documents_.size());
+    for (const TermFreq& term_freq : term_freqs) {
+        if (static_cast<size_t>(term_freq.term_id) >= term_positions_.size()) {
+            term_positions_.resize(term_freq.term_id + 1, NO_POSITION);
+        }
+        uint32_t& position = term_positions_[term_freq.term_id];
+        if (position == NO_POSITION) {
+            position = static_cast<uint32_t>(term_ids_.size());
+            term_ids_.push_back(term_freq.term_id);
+            postings_.emplace_back();
+        }
+        postings_[position].Add(slot, term_freq.count, term_freq.term_freq);
+    }
+    documents_.push_back({document_id, rating, status, static_cast<uint32_t>(term_freqs.size()),
+                          term_freqs_.size(), inv_word_count, fingerprint, word_positions_.size()});
+    for (const TermFreq& term_freq : term_freqs) {
+        term_freqs_.push_back(term_freq);
+    }
+    for (const uint32_t position : word_positions) {
+        word_positions_.push_back(position);
+    }
+    if (slot % 64 == 0) {
+        for (size_t i = 0; i < STATUS_COUNT; ++i) {
+            status_words_.push_back(0);
+        }
+    }
+    status_words_.GetMutable(slot / 64 * STATUS_COUNT + static_cast<size_t>(status)) |= uint64_t{1} << (slot % 64);
+    return slot;
+}
+
+void Segment::Seal() {
+    std::vector<uint32_t> order(term_ids_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return term_ids_[lhs] < term_ids_[rhs];
+    });
+    SealedPostings sealed;
+    for (const uint32_t position : order) {
+        sealed.Append(term_ids_[position], postings_[position]);
+    }
+    SetPostings(std::move(sealed));
+}
+
+Segment Segment::Merge(const std::vector<MergeSource>& sources) {
+    std::vector<DocumentData> documents;
+    std::vector<TermFreq> term_freqs;
+    std::vector<uint32_t> word_positions;
+    // new slot of every source slot, -1 for deleted documents
+    std::vector<std::vector<int>> new_slots(sources.size());
+    std::vector<int> term_ids;
+    for (size_t source = 0; source < sources.size(); ++source) {
+        const Segment& segment = *sources[source].segment;
+        new_slots[source].resize(segment.documents_.size(), -1);
+        for (int slot = 0; slot < segment.GetSlotCount(); ++slot) {
+            if (sources[source].deleted->Test(slot)) {
+                continue;
+            }
+            // a damaged document of an opened segment must not spread into the merged one
+            segment.CheckDocument(slot);
+            new_slots[source][slot] = static_cast<int>(documents.size());
+            DocumentData document = segment.documents_[slot];
+            document.first_term_freq = term_freqs.size();
+            document.first_word_position = word_positions.size();
+            documents.push_back(document);
+            const ArrayView<TermFreq> document_term_freqs = segment.GetTermFreqs(slot);
+            term_freqs.insert(term_freqs.end(), document_term_freqs.begin(), document_term_freqs.end());
+            const ArrayView<uint32_t> document_positions = segment.GetDocumentWordPositions(slot);
+            word_positions.insert(word_positions.end(), document_positions.begin(), document_positions.end());
+        }
+        term_ids.insert(term_ids.end(), segment.term_ids_.begin(), segment.term_ids_.end());
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    // Sources follow each other in slot order, so every merged list is built by appending
+    SealedPostings sealed;
+    for (const int term_id : term_ids) {
+        PostingList postings;
+        for (size_t source = 0; source < sources.size(); ++source) {
+            const Segment& segment = *sources[source].segment;
+            const PostingListView source_postings = segment.FindPostings(term_id);
+            for (auto cursor = source_postings.GetCursor(0, segment.GetSlotCount()); !cursor.IsEnd(); cursor.Next()) {
+                const int slot = new_slots[source][cursor.GetSlot()];
+                if (slot >= 0) {
+                    postings.Add(slot, cursor.GetCount(), cursor.GetCount() * documents[slot].inv_word_count);
+                }
+            }
+        }
+        if (!postings.empty()) {
+            sealed.Append(term_id, postings);
+        }
+    }
+
+    Segment merged;
+    merged.status_words_ = FlatArray<uint64_t>(BuildStatusWords(documents));
+    merged.documents_ = FlatArray<DocumentData>(std::move(documents));
+    merged.term_freqs_ = FlatArray<TermFreq>(std::move(term_freqs));
+    merged.word_positions_ = FlatArray<uint32_t>(std::move(word_positions));
+    merged.SetPostings(std::move(sealed));
+    return merged;
+}
+
+SegmentFileHeader Segment::Save(IndexFileWriter& writer, uint32_t number, const Bitmap& deleted) const {
+    assert(is_sealed_);
+    SegmentFileHeader header{};
+    header.number = number;
+    header.documents = writer.Write(documents_.GetView());
+    header.term_freqs = writer.Write(term_freqs_.GetView());
+    header.word_positions = writer.Write(word_positions_.GetView());
+    header.status_words = writer.Write(status_words_.GetView());
+    header.term_ids = writer.Write(term_ids_.GetView());
+    header.term_postings = writer.Write(term_postings_.GetView());
+    header.blocks = writer.Write(blocks_.GetView());
+    header.bytes = writer.Write(bytes_.GetView());
+    header.deleted = writer.Write(deleted.GetWords());
+    header.deleted_count = deleted.Count();
+    return header;
+}
+
+Segment Segment::Open(std::shared_ptr<const MappedFile> file, const SegmentFileHeader& header, size_t term_count) {
+    Segment segment;
+    segment.documents_ = FlatArray(GetArray<DocumentData>(*file, header.documents));
+    segment.term_freqs_ = FlatArray(GetArray<TermFreq>(*file, header.term_freqs));
+    segment.word_positions_ = FlatArray(GetArray<uint32_t>(*file, header.word_positions));
+    segment.status_words_ = FlatArray(GetArray<uint64_t>(*file, header.status_words));
+    segment.term_ids_ = FlatArray(GetArray<int>(*file, header.term_ids));
+    segment.term_postings_ = FlatArray(GetArray<TermPostings>(*file, header.term_postings));
+    segment.blocks_ = FlatArray(GetArray<PostingBlock>(*file, header.blocks));
+    segment.bytes_ = FlatArray(GetArray<uint8_t>(*file, header.bytes));
+    // HasStatus and FindPostings index these arrays by slot and position without checks
+    if (segment.documents_.size() > static_cast<size_t>(std::numeric_limits<int>::max())
+        || segment.status_words_.size() != (segment.documents_.size() + 63) / 64 * STATUS_COUNT
+        || segment.term_ids_.size() != segment.term_postings_.size()) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    segment.file_ = std::move(file);
+    segment.term_count_ = term_count;
+    segment.is_sealed_ = true;
+    return segment;
+}
+
+void Segment::Verify() const {
+    uint64_t last_word_position = 0;
+    for (int slot = 0; slot < GetSlotCount(); ++slot) {
+        // GetDocumentWordPositions reads up to the first position of the next document
+        if (!IsDocumentConsistent(slot) || documents_[slot].first_word_position < last_word_position) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        last_word_position = documents_[slot].first_word_position;
+    }
+    if (!ArePostingsConsistent()) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+}
+
+void Segment::CheckDocument(int slot) const {
+    if (!IsDocumentConsistent(slot)) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+}
+
+bool Segment::IsDocumentConsistent(int slot) const {
+    const DocumentData& document = documents_[slot];
+    if (static_cast<size_t>(document.status) >= STATUS_COUNT
+        || document.first_term_freq > term_freqs_.size()
+        || document.term_freq_count > term_freqs_.size() - document.first_term_freq
+        || document.first_word_position > word_positions_.size()) {
+        return false;
+    }
+    uint64_t word_count = 0;
+    for (const TermFreq& term_freq : GetTermFreqs(slot)) {
+        if (term_freq.term_id < 0 || static_cast<size_t>(term_freq.term_id) >= term_count_) {
+            return false;
+        }
+        word_count += term_freq.count;
+    }
+    // GetWordPositions reads the positions of the terms one after another
+    return document.first_word_position == word_positions_.size()
+        || word_count <= word_positions_.size() - document.first_word_position;
+}
+
+bool Segment::ArePostingsConsistent() const {
+    for (size_t i = 0; i < term_ids_.size(); ++i) {
+        // FindPostings searches the term ids in order
+        if (term_ids_[i] < 0 || static_cast<size_t>(term_ids_[i]) >= term_count_
+            || (i > 0 && term_ids_[i] <= term_ids_[i - 1])) {
+            return false;
+        }
+        const TermPostings& postings = term_postings_[i];
+        if (postings.first_block > blocks_.size() || postings.block_count > blocks_.size() - postings.first_block
+            || postings.bytes_offset > bytes_.size()) {
+            return false;
+        }
+        uint64_t posting_count = 0;
+        for (uint32_t block = 0; block < postings.block_count; ++block) {
+            // cursors search the blocks by their slots
+            const PostingBlock& info = blocks_[postings.first_block + block];
+            if (info.last_slot >= documents_.size()
+                || (block > 0 && info.first_slot <= blocks_[postings.first_block + block - 1].last_slot)) {
+                return false;
+            }
+            posting_count += info.size;
+        }
+        // sealed lists have no tail
+        if (posting_count != postings.size) {
+            return false;
+        }
+        // decoding checks every block against the bytes and its slots
+        auto cursor = FindPostings(term_ids_[i]).GetCursor(0, GetSlotCount());
+        while (!cursor.IsEnd()) {
+            cursor.Next();
+        }
+    }
+    return true;
+}
+
+PostingListView Segment::FindPostings(int term_id) const {
+    if (!is_sealed_) {
+        if (static_cast<size_t>(term_id) >= term_positions_.size() || term_positions_[term_id] == NO_POSITION) {
+            return {};
+        }
+        return postings_[term_positions_[term_id]].GetView();
+    }
+    const auto it = std::lower_bound(term_ids_.begin(), term_ids_.end(), term_id);
+    if (it == term_ids_.end() || *it != term_id) {
+        return {};
+    }
+    const TermPostings& postings = term_postings_[it - term_ids_.begin()];
+    // the blocks themselves are checked when they are decoded
+    if (postings.first_block > blocks_.size() || postings.block_count > blocks_.size() - postings.first_block
+        || postings.bytes_offset > bytes_.size()) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    return PostingListView({blocks_.data() + postings.first_block, postings.block_count},
+                           {bytes_.data() + postings.bytes_offset, bytes_.size() - postings.bytes_offset},
+                           {}, postings.size, postings.max_term_freq);
+}
+
+ArrayView<Segment::TermFreq> Segment::GetTermFreqs(int slot) const {
+    const DocumentData& document = documents_[slot];
+    if (document.first_term_freq > term_freqs_.size()
+        || document.term_freq_count > term_freqs_.size() - document.first_term_freq) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    return {term_freqs_.data() + document.first_term_freq, document.term_freq_count};
+}
+
+ArrayView<uint32_t> Segment::GetWordPositions(int slot, int term_id) const {
+    const DocumentData& document = documents_[slot];
+    if (document.first_word_position >= word_positions_.size()) {
+        return {};
+    }
+    uint64_t first_position = document.first_word_position;
+    for (const TermFreq& term_freq : GetTermFreqs(slot)) {
+        if (term_freq.term_id == term_id) {
+            if (first_position > word_positions_.size() || term_freq.count > word_positions_.size() - first_position) {
+                throw std::invalid_argument("Index file is damaged"s);
+            }
+            return {word_positions_.data() + first_position, term_freq.count};
+        }
+        if (term_freq.term_id > term_id) {
+            break;
+        }
+        first_position += term_freq.count;
+    }
+    return {};
+}
+
+ArrayView<uint32_t> Segment::GetDocumentWordPositions(int slot) const {
+    const DocumentData& document = documents_[slot];
+    const uint64_t first_position = document.first_word_position;
+    const uint64_t last_position = static_cast<size_t>(slot + 1) < documents_.size()
+        ? documents_[slot + 1].first_word_position : word_positions_.size();
+    if (first_position > last_position || last_position > word_positions_.size()) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    return {word_positions_.data() + first_position, static_cast<size_t>(last_position - first_position)};
+}
+
+std::vector<uint64_t> Segment::BuildStatusWords(const std::vector<DocumentData>& documents) {
+    std::vector<uint64_t> status_words((documents.size() + 63) / 64 * STATUS_COUNT, 0);
+    for (size_t slot = 0; slot < documents.size(); ++slot) {
+        status_words[slot / 64 * STATUS_COUNT + static_cast<size_t>(documents[slot].status)] |= uint64_t{1} << (slot % 64);
+    }
+    return status_words;
+}
+
+void Segment::SealedPostings::Append(int term_id, PostingList& postings) {
+    postings.Flush();
+    const ArrayView<PostingBlock> list_blocks = postings.GetBlocks();
+    const ArrayView<uint8_t> list_bytes = postings.GetBytes();
+    term_ids.push_back(term_id);
+    term_postings.push_back({bytes.size(), static_cast<uint32_t>(blocks.size()),
+                             static_cast<uint32_t>(list_blocks.size()), postings.size(), postings.GetMaxTermFreq()});
+    blocks.insert(blocks.end(), list_blocks.begin(), list_blocks.end());
+    bytes.insert(bytes.end(), list_bytes.begin(), list_bytes.end());
+}
+
+void Segment::SetPostings(SealedPostings postings) {
+    term_ids_ = FlatArray<int>(std::move(postings.term_ids));
+    term_postings_ = FlatArray<TermPostings>(std::move(postings.term_postings));
+    blocks_ = FlatArray<PostingBlock>(std::move(postings.blocks));
+    bytes_ = FlatArray<uint8_t>(std::move(postings.bytes));
+    std::vector<PostingList>().swap(postings_);
+    std::vector<uint32_t>().swap(term_positions_);
+    is_sealed_ = true;
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "bitmap.h"
+#include "document.h"
+#include "flat_array.h"
+#include "index_file.h"
+#include "posting_list.h"
+#include "word_set_fingerprint.h"
+
+// A slice of the index with its own document slots. An open segment takes
+// new documents; once sealed it is never changed again, so it can be
+// shared between threads and index copies. Removals are not stored here,
+// the owner keeps them as a bitmap of deleted slots.
+//
+// A sealed segment keeps everything in flat arrays of plain records, the
+// layout it is saved in, so an opened one reads them from the mapped file.
+class Segment {
+public:
+    static constexpr size_t STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+
+    struct TermFreq {
+        int term_id;
+        // occurrences of the term in the document
+        uint32_t count;
+        double term_freq;
+    };
+
+    struct DocumentData {
+        int id;
+        int rating;
+        DocumentStatus status;
+        // forward index: term_freqs[first_term_freq, first_term_freq + term_freq_count)
+        // of the segment, sorted by term id
+        uint32_t term_freq_count;
+        uint64_t first_term_freq;
+        // postings keep occurrence counts, the term frequency is count / word count
+        double inv_word_count;
+        // of the distinct words, for duplicate detection
+        WordSetFingerprint fingerprint;
+        // positions of the words of term_freqs[i] follow those of term_freqs[i - 1]
+        // in word_positions starting here, when the index keeps positions
+        uint64_t first_word_position;
+    };
+
+    // Where the postings of a term are in the arrays of a sealed segment
+    struct TermPostings {
+        uint64_t bytes_offset;
+        uint32_t first_block;
+        uint32_t block_count;
+        uint64_t size;
+        double max_term_freq;
+    };
+
+    struct MergeSource {
+        const Segment* segment;
+        const Bitmap* deleted;
+    };
+
+    // Appends a document to an open segment and returns its slot,
+    // term_freqs are sorted by term id. word_positions is empty or holds the
+    // increasing positions of the count words of every term_freqs[i] in turn.
+    int AddDocument(int document_id, int rating, DocumentStatus status, double inv_word_count,
+                    WordSetFingerprint fingerprint, const std::vector<TermFreq>& term_freqs,
+                    const std::vector<uint32_t>& word_positions);
+
+    // Moves the postings into the flat sealed layout, documents cannot be added afterwards
+    void Seal();
+
+    // Sealed segment with the documents of the sources that are not deleted,
+    // in source order. Deleted documents are dropped from the postings.
+    // Throws std::invalid_argument if a record of an opened source is damaged.
+    static Segment Merge(const std::vector<MergeSource>& sources);
+
+    // Writes the arrays of a sealed segment, deleted are its removed slots
+    SegmentFileHeader Save(IndexFileWriter& writer, uint32_t number, const Bitmap& deleted) const;
+
+    // Sealed segment that reads its arrays from the mapped file. Only the
+    // arrays are checked against the file, a record is checked when it is
+    // first read. Throws std::invalid_argument if the file is damaged.
+    static Segment Open(std::shared_ptr<const MappedFile> file, const SegmentFileHeader& header, size_t term_count);
+
+    // Reads every record of an opened segment: term ids have to be below
+    // term_count, offsets within the arrays they point into and postings
+    // have to decode. Throws std::invalid_argument if one is damaged.
+    void Verify() const;
+
+    // Checks the record of the document and the term frequencies and word
+    // positions it points to, throws std::invalid_argument if they are
+    // damaged. Afterwards GetTermFreqs and GetWordPositions of the slot
+    // do not throw.
+    void CheckDocument(int slot) const;
+
+    // Empty when no document of the segment contains the term. Throws
+    // std::invalid_argument if the record of the postings is damaged.
+    PostingListView FindPostings(int term_id) const;
+
+    const DocumentData& GetDocument(int slot) const;
+
+    // Answers status filters from a bitmap, without reading the document
+    bool HasStatus(int slot, DocumentStatus status) const;
+
+    // Throws std::invalid_argument if the range of the document is damaged
+    ArrayView<TermFreq> GetTermFreqs(int slot) const;
+
+    // Increasing positions of the term in the document, counting stop words.
+    // Empty when the document lacks the term or positions are not kept.
+    // Throws std::invalid_argument if the range of the document is damaged.
+    ArrayView<uint32_t> GetWordPositions(int slot, int term_id) const;
+
+    int GetSlotCount() const;
+
+private:
+    static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+    FlatArray<DocumentData> documents_;
+    FlatArray<TermFreq> term_freqs_;
+    FlatArray<uint32_t> word_positions_;
+    // a bitmap of the slots of every status, interleaved: word i of status s
+    // is status_words_[i * STATUS_COUNT + s], so one cache line covers all of
+    // them for 64 slots
+    FlatArray<uint64_t> status_words_;
+    // sorted once the segment is sealed
+    FlatArray<int> term_ids_;
+    // postings of term_ids_[i] while the segment is open
+    std::vector<PostingList> postings_;
+    // position in term_ids_ by term id while the segment is open
+    std::vector<uint32_t> term_positions_;
+    // postings of term_ids_[i] once the segment is sealed
+    FlatArray<TermPostings> term_postings_;
+    FlatArray<PostingBlock> blocks_;
+    FlatArray<uint8_t> bytes_;
+    // keeps the arrays of an opened segment mapped
+    std::shared_ptr<const MappedFile> file_;
+    // term ids of an opened segment are below it
+    size_t term_count_ = std::numeric_limits<size_t>::max();
+    bool is_sealed_ = false;
+
+    // Sealed arrays built from posting lists in term id order
+    struct SealedPostings {
+        std::vector<int> term_ids;
+        std::vector<TermPostings> term_postings;
+        std::vector<PostingBlock> blocks;
+        std::vector<uint8_t> bytes;
+
+        void Append(int term_id, PostingList& postings);
+    };
+
+    void SetPostings(SealedPostings postings);
+
+    static std::vector<uint64_t> BuildStatusWords(const std::vector<DocumentData>& documents);
+
+    // Whether the records of an opened segment refer only to each other and
+    // to term ids below term_count_
+    bool IsDocumentConsistent(int slot) const;
+
+    bool ArePostingsConsistent() const;
+
+    // Positions of all the words of the document, in term_freqs order
+    ArrayView<uint32_t> GetDocumentWordPositions(int slot) const;
+};
+
+// Called once per posting while scoring
+
+inline const Segment::DocumentData& Segment::GetDocument(int slot) const {
+    return documents_[slot];
+}
+
+inline bool Segment::HasStatus(int slot, DocumentStatus status) const {
+    return (status_words_[slot / 64 * STATUS_COUNT + static_cast<size_t>(status)] >> (slot % 64)) & 1;
+}
+
+inline int Segment::GetSlotCount() const {
+    return static_cast<int>(documents_.size());
+}
\ No newline at end of file
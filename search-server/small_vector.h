@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Vector of trivially copyable values that keeps up to N of them inline
+// and only goes to the heap when it grows past that. clear() keeps the
+// heap buffer, so a reused instance stops allocating once it is warm.
+template <typename T, size_t N>
+class SmallVector {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector supports only trivially copyable values");
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector& other) {
+        Assign(other);
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            Assign(other);
+        }
+        return *this;
+    }
+
+    SmallVector(SmallVector&& other) noexcept {
+        Steal(other);
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            heap_.reset();
+            Steal(other);
+        }
+        return *this;
+    }
+
+    void push_back(const T& value) {
+        if (size_ == capacity_) {
+            Reserve(capacity_ * 2);
+        }
+        data()[size_++] = value;
+    }
+
+    // Removes [first, last) keeping the order of the rest
+    iterator erase(const_iterator first, const_iterator last) {
+        T* const target = begin() + (first - begin());
+        T* const tail_end = std::copy(last, static_cast<const_iterator>(end()), target);
+        size_ = static_cast<size_t>(tail_end - begin());
+        return target;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    T& operator[](size_t index) {
+        return data()[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return data()[index];
+    }
+
+    T* data() {
+        return heap_ ? heap_.get() : inline_.data();
+    }
+
+    const T* data() const {
+        return heap_ ? heap_.get() : inline_.data();
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    iterator end() {
+        return data() + size_;
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + size_;
+    }
+
+private:
+    std::array<T, N> inline_;
+    std::unique_ptr<T[]> heap_;
+    size_t capacity_ = N;
+    size_t size_ = 0;
+
+    void Reserve(size_t capacity) {
+        auto buffer = std::make_unique<T[]>(capacity);
+        std::copy(begin(), end(), buffer.get());
+        heap_ = std::move(buffer);
+        capacity_ = capacity;
+    }
+
+    void Assign(const SmallVector& other) {
+        size_ = 0;
+        if (other.size_ > capacity_) {
+            Reserve(other.size_);
+        }
+        std::copy(other.begin(), other.end(), data());
+        size_ = other.size_;
+    }
+
+    void Steal(SmallVector& other) {
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            capacity_ = other.capacity_;
+        } else {
+            std::copy(other.begin(), other.end(), inline_.begin());
+            capacity_ = N;
+        }
+        size_ = other.size_;
+        other.capacity_ = N;
+        other.size_ = 0;
+    }
+};
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <vector>
 #include <set>
+#include <string>
+#include <string_view>
 #include <algorithm>
 
 #include "document.h"
@@ -12,9 +14,21 @@ std::vector<std::string> SplitIntoWords(const std::string_view text);
 
 std::vector<std::string_view> SplitIntoWordsView(std::string_view text);
 
+// Calls function with every space separated word of text, the words are
+// views into text, so nothing is copied or allocated
+template <typename Function>
+void ForEachWord(std::string_view text, Function function) {
+    size_t pos = text.find_first_not_of(' ');
+    while (pos != text.npos) {
+        const size_t space = text.find(' ', pos);
+        function(text.substr(pos, space - pos));
+        pos = text.find_first_not_of(' ', space);
+    }
+}
+
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.insert(str);
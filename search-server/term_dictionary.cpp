@@ -0,0 +1,129 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+int TermDictionary::Intern(std::string_view term) {
+    const int saved_id = FindSaved(term);
+    if (saved_id != NO_TERM) {
+        return saved_id;
+    }
+    const auto it = term_ids_.find(term);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    const int term_id = static_cast<int>(size());
+    // deque never relocates its elements, so the key view stays valid
+    const std::string& stored = terms_.emplace_back(term);
+    term_ids_.emplace(stored, term_id);
+    return term_id;
+}
+
+int TermDictionary::Find(std::string_view term) const {
+    const int saved_id = FindSaved(term);
+    if (saved_id != NO_TERM) {
+        return saved_id;
+    }
+    const auto it = term_ids_.find(term);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+std::string_view TermDictionary::GetTerm(int term_id) const {
+    const size_t index = static_cast<size_t>(term_id);
+    if (index < saved_count_) {
+        const uint64_t first = saved_offsets_[index];
+        const uint64_t last = saved_offsets_[index + 1];
+        if (first > last || last > saved_chars_.size()) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        return {saved_chars_.data() + first, last - first};
+    }
+    return terms_[index - saved_count_];
+}
+
+size_t TermDictionary::size() const {
+    return saved_count_ + terms_.size();
+}
+
+void TermDictionary::Save(const std::vector<std::string_view>& terms, IndexFileWriter& writer, IndexFileHeader& header) {
+    // at most half full, so probe sequences stay short
+    size_t slot_count = 1;
+    while (slot_count < terms.size() * 2) {
+        slot_count *= 2;
+    }
+    std::vector<uint32_t> slots(slot_count, EMPTY_SLOT);
+    for (size_t term_id = 0; term_id < terms.size(); ++term_id) {
+        size_t slot = Hash(terms[term_id]) & (slot_count - 1);
+        while (slots[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = static_cast<uint32_t>(term_id);
+    }
+    writer.WriteWords(terms, header.term_offsets, header.term_chars);
+    header.term_slots = writer.Write(ArrayView<uint32_t>(slots.data(), slots.size()));
+}
+
+TermDictionary TermDictionary::Open(std::shared_ptr<const MappedFile> file, const IndexFileHeader& header) {
+    TermDictionary dictionary;
+    dictionary.saved_offsets_ = GetArray<uint64_t>(*file, header.term_offsets);
+    dictionary.saved_chars_ = GetArray<char>(*file, header.term_chars);
+    dictionary.saved_slots_ = GetArray<uint32_t>(*file, header.term_slots);
+    const size_t slot_count = dictionary.saved_slots_.size();
+    if (dictionary.saved_offsets_.empty() || slot_count == 0 || (slot_count & (slot_count - 1)) != 0) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    dictionary.saved_count_ = dictionary.saved_offsets_.size() - 1;
+    dictionary.file_ = std::move(file);
+    return dictionary;
+}
+
+void TermDictionary::Verify() const {
+    if (!std::is_sorted(saved_offsets_.begin(), saved_offsets_.end())
+        || (!saved_offsets_.empty() && saved_offsets_[saved_offsets_.size() - 1] > saved_chars_.size())) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+    // Save leaves at least half of the slots empty
+    bool has_empty_slot = false;
+    for (const uint32_t term_id : saved_slots_) {
+        if (term_id == EMPTY_SLOT) {
+            has_empty_slot = true;
+        } else if (term_id >= saved_count_) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+    }
+    if (!has_empty_slot) {
+        throw std::invalid_argument("Index file is damaged"s);
+    }
+}
+
+int TermDictionary::FindSaved(std::string_view term) const {
+    if (saved_count_ == 0) {
+        return NO_TERM;
+    }
+    const size_t mask = saved_slots_.size() - 1;
+    size_t slot = Hash(term) & mask;
+    // a damaged table may have no empty slot, so every slot is probed at most once
+    for (size_t probe = 0; probe < saved_slots_.size() && saved_slots_[slot] != EMPTY_SLOT; ++probe) {
+        if (saved_slots_[slot] >= saved_count_) {
+            throw std::invalid_argument("Index file is damaged"s);
+        }
+        const int term_id = static_cast<int>(saved_slots_[slot]);
+        if (GetTerm(term_id) == term) {
+            return term_id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NO_TERM;
+}
+
+// FNV-1a, it is part of the file format and must not change
+uint64_t TermDictionary::Hash(std::string_view term) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : term) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_array.h"
+#include "index_file.h"
+
+// Stores every indexed word once and maps it to a dense term id.
+// Views returned by GetTerm stay valid for the lifetime of the dictionary.
+//
+// An opened dictionary looks the saved words up in the mapped file through
+// a hash table stored with them; words interned later are kept in memory
+// and get the ids after the saved ones.
+class TermDictionary {
+public:
+    static constexpr int NO_TERM = -1;
+
+    // Intern, Find and GetTerm throw std::invalid_argument when a saved word
+    // or slot they read is damaged
+    int Intern(std::string_view term);
+
+    int Find(std::string_view term) const;
+
+    std::string_view GetTerm(int term_id) const;
+
+    size_t size() const;
+
+    // Writes the words, terms[i] has term id i, and fills the term arrays of header
+    static void Save(const std::vector<std::string_view>& terms, IndexFileWriter& writer, IndexFileHeader& header);
+
+    // Checks only the sizes of the arrays, the words and slots are checked
+    // when they are read. Throws std::invalid_argument if the sizes are damaged.
+    static TermDictionary Open(std::shared_ptr<const MappedFile> file, const IndexFileHeader& header);
+
+    // Reads every saved word and slot, throws std::invalid_argument if one is damaged
+    void Verify() const;
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    // saved words: term i is chars[offsets[i], offsets[i + 1])
+    ArrayView<uint64_t> saved_offsets_;
+    ArrayView<char> saved_chars_;
+    // term ids by hash, the size is a power of two
+    ArrayView<uint32_t> saved_slots_;
+    size_t saved_count_ = 0;
+    std::shared_ptr<const MappedFile> file_;
+
+    std::deque<std::string> terms_;
+    std::unordered_map<std::string_view, int> term_ids_;
+
+    int FindSaved(std::string_view term) const;
+
+    static uint64_t Hash(std::string_view term);
+};
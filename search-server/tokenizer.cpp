@@ -0,0 +1,226 @@
+#include "tokenizer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+// Lowercase of the two byte UTF-8 letter lead, next, written back in place
+void FoldUtf8Letter(unsigned char& lead, unsigned char& next) {
+    if (lead == 0xC3 && next >= 0x80 && next <= 0x9E && next != 0x97) {
+        // À-Þ without ×
+        next += 0x20;
+    } else if (lead == 0xD0 && next >= 0x90 && next <= 0x9F) {
+        // А-П
+        next += 0x20;
+    } else if (lead == 0xD0 && next >= 0xA0 && next <= 0xAF) {
+        // Р-Я
+        lead = 0xD1;
+        next -= 0x20;
+    } else if (lead == 0xD0 && next >= 0x80 && next <= 0x8F) {
+        // Ѐ-Џ, Ё among them
+        lead = 0xD1;
+        next += 0x10;
+    }
+}
+
+}  // namespace
+
+Tokenizer::Tokenizer()
+    : Tokenizer(" ", false) {
+}
+
+Tokenizer::Tokenizer(std::string_view delimiters, bool is_folding_case)
+    : is_folding_case_(is_folding_case) {
+    if (delimiters.empty()) {
+        throw std::invalid_argument("Tokenizer needs delimiters"s);
+    }
+    for (const char c : delimiters) {
+        const auto code = static_cast<unsigned char>(c);
+        if (code >= 128 || c == '-') {
+            throw std::invalid_argument("Delimiter "s + std::to_string(code) + " is not allowed"s);
+        }
+        delimiters_[code / 64] |= uint64_t{1} << (code % 64);
+    }
+    const std::string sorted = GetDelimiters();
+    for (size_t first = 0; first < sorted.size();) {
+        size_t last = first;
+        while (last + 1 < sorted.size() && sorted[last + 1] == sorted[last] + 1) {
+            ++last;
+        }
+        if (range_count_ < MAX_SCANNED_RANGES) {
+            ranges_[range_count_] = {sorted[first], sorted[last]};
+        }
+        ++range_count_;
+        first = last + 1;
+    }
+}
+
+Tokenizer Tokenizer::MakeTextTokenizer() {
+    std::string delimiters;
+    for (int c = 0; c < 128; ++c) {
+        const bool is_letter_or_digit = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        if (!is_letter_or_digit && c != '-') {
+            delimiters += static_cast<char>(c);
+        }
+    }
+    return Tokenizer(delimiters, true);
+}
+
+std::string Tokenizer::GetDelimiters() const {
+    std::string delimiters;
+    for (int c = 0; c < 128; ++c) {
+        if (IsDelimiter(static_cast<char>(c))) {
+            delimiters += static_cast<char>(c);
+        }
+    }
+    return delimiters;
+}
+
+void Tokenizer::Split(std::string_view text, std::string& folded, std::vector<std::string_view>& words) const {
+    if (is_folding_case_) {
+        folded.assign(text.data(), text.size());
+        FoldCase(folded.data(), folded.size());
+        text = folded;
+    }
+    const char* data = text.data();
+    // bit 63 of the previous mask, the first byte starts a word unless it is a delimiter
+    uint64_t previous_in_word = 0;
+    size_t word_start = 0;
+    for (size_t block = 0; block < text.size(); block += 64) {
+        const size_t block_size = std::min<size_t>(64, text.size() - block);
+        const uint64_t in_word = ~(block_size == 64 ? FindDelimiters(data + block)
+                                                    : FindTailDelimiters(data + block, block_size));
+        // set where a word starts or the byte after one ends
+        uint64_t transitions = in_word ^ ((in_word << 1) | previous_in_word);
+        while (transitions != 0) {
+            const size_t position = block + __builtin_ctzll(transitions);
+            if ((in_word >> (position - block)) & 1) {
+                word_start = position;
+            } else {
+                words.emplace_back(data + word_start, position - word_start);
+            }
+            transitions &= transitions - 1;
+        }
+        previous_in_word = in_word >> 63;
+    }
+    // the tail mask marks bytes past the end as delimiters, so only a word
+    // filling the last full block is still open
+    if (previous_in_word != 0) {
+        words.emplace_back(data + word_start, text.size() - word_start);
+    }
+}
+
+std::string_view Tokenizer::Normalize(std::string_view text, std::string_view kept, std::string& buffer,
+                                      bool fold) const {
+    buffer.assign(text.data(), text.size());
+    for (size_t block = 0; block < buffer.size(); block += 64) {
+        const size_t block_size = std::min<size_t>(64, buffer.size() - block);
+        uint64_t delimiters = block_size == 64 ? FindDelimiters(buffer.data() + block)
+                                               : FindTailDelimiters(buffer.data() + block, block_size);
+        if (block_size < 64) {
+            delimiters &= (uint64_t{1} << block_size) - 1;
+        }
+        while (delimiters != 0) {
+            char& c = buffer[block + __builtin_ctzll(delimiters)];
+            if (kept.find(c) == std::string_view::npos) {
+                c = ' ';
+            }
+            delimiters &= delimiters - 1;
+        }
+    }
+    if (fold) {
+        FoldCase(buffer.data(), buffer.size());
+    }
+    return buffer;
+}
+
+void Tokenizer::FoldCase(char* data, size_t size) const {
+    if (!is_folding_case_) {
+        return;
+    }
+    size_t i = 0;
+    bool has_non_ascii = false;
+#if defined(__SSE2__) || defined(__AVX2__)
+    const __m128i before_upper = _mm_set1_epi8('A' - 1);
+    const __m128i after_upper = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // bytes above 127 are negative, so they are never between the bounds
+        const __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, before_upper), _mm_cmplt_epi8(bytes, after_upper));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_or_si128(bytes, _mm_and_si128(is_upper, case_bit)));
+        has_non_ascii |= _mm_movemask_epi8(bytes) != 0;
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] >= 'A' && data[i] <= 'Z') {
+            data[i] += 'a' - 'A';
+        }
+        has_non_ascii |= static_cast<unsigned char>(data[i]) >= 128;
+    }
+    if (!has_non_ascii) {
+        return;
+    }
+    for (size_t j = 0; j + 1 < size; ++j) {
+        auto& lead = reinterpret_cast<unsigned char&>(data[j]);
+        if (lead == 0xC3 || lead == 0xD0) {
+            FoldUtf8Letter(lead, reinterpret_cast<unsigned char&>(data[j + 1]));
+            ++j;
+        }
+    }
+}
+
+uint64_t Tokenizer::FindDelimiters(const char* data) const {
+    if (range_count_ > MAX_SCANNED_RANGES) {
+        return FindTailDelimiters(data, 64);
+    }
+#if defined(__AVX2__)
+    uint64_t mask = 0;
+    for (size_t half = 0; half < 2; ++half) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + half * 32));
+        __m256i is_delimiter = _mm256_setzero_si256();
+        for (size_t r = 0; r < range_count_; ++r) {
+            // signed compares: bytes above 127 are below every range
+            const __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(ranges_[r].first), bytes);
+            const __m256i above = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(ranges_[r].second));
+            is_delimiter = _mm256_or_si256(is_delimiter, _mm256_andnot_si256(_mm256_or_si256(below, above),
+                                                                             _mm256_set1_epi8(-1)));
+        }
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_delimiter))) << (half * 32);
+    }
+    return mask;
+#elif defined(__SSE2__)
+    uint64_t mask = 0;
+    for (size_t quarter = 0; quarter < 4; ++quarter) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + quarter * 16));
+        __m128i is_delimiter = _mm_setzero_si128();
+        for (size_t r = 0; r < range_count_; ++r) {
+            // signed compares: bytes above 127 are below every range
+            const __m128i below = _mm_cmplt_epi8(bytes, _mm_set1_epi8(ranges_[r].first));
+            const __m128i above = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(ranges_[r].second));
+            is_delimiter = _mm_or_si128(is_delimiter, _mm_andnot_si128(_mm_or_si128(below, above), _mm_set1_epi8(-1)));
+        }
+        mask |= static_cast<uint64_t>(_mm_movemask_epi8(is_delimiter)) << (quarter * 16);
+    }
+    return mask;
+#else
+    return FindTailDelimiters(data, 64);
+#endif
+}
+
+uint64_t Tokenizer::FindTailDelimiters(const char* data, size_t size) const {
+    uint64_t mask = size < 64 ? ~uint64_t{0} << size : 0;
+    for (size_t i = 0; i < size; ++i) {
+        mask |= static_cast<uint64_t>(IsDelimiter(data[i])) << i;
+    }
+    return mask;
+}
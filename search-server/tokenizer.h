@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Splits text into words on a table of delimiter characters and can fold
+// case: ASCII letters and the two byte UTF-8 capitals of Latin-1 and
+// Cyrillic become lowercase. Folding keeps the length of the text, so the
+// words of folded text are at the same offsets as in the original.
+//
+// Delimiters are ASCII characters other than '-', which marks minus words
+// in queries. The text is classified 16 bytes at a time with SSE2, 32 with
+// AVX2 when the build enables it, and words are cut at the transitions of
+// the resulting bit masks.
+class Tokenizer {
+public:
+    // Splits on spaces and keeps case, like SplitIntoWords
+    Tokenizer();
+
+    // Throws std::invalid_argument when delimiters is empty or has a
+    // character that is not ASCII or is '-'
+    Tokenizer(std::string_view delimiters, bool is_folding_case);
+
+    // Control characters, spaces and ASCII punctuation except '-', with
+    // case folding
+    static Tokenizer MakeTextTokenizer();
+
+    bool IsDelimiter(char c) const;
+
+    bool IsFoldingCase() const;
+
+    // In increasing order
+    std::string GetDelimiters() const;
+
+    // Appends the words of text to words. They are views into text, or into
+    // folded when the tokenizer folds case; folded is overwritten and has to
+    // outlive the words. A word's index in words minus the initial size is
+    // its position in the text.
+    void Split(std::string_view text, std::string& folded, std::vector<std::string_view>& words) const;
+
+    // Copy of text in buffer with every delimiter that is not in kept
+    // replaced by a space, case folded unless fold is false. Parsers that
+    // split on spaces themselves read it instead of text.
+    std::string_view Normalize(std::string_view text, std::string_view kept, std::string& buffer,
+                               bool fold = true) const;
+
+    // Folds the case of size characters in place, nothing happens if the
+    // tokenizer does not fold case
+    void FoldCase(char* data, size_t size) const;
+
+private:
+    static constexpr size_t MAX_SCANNED_RANGES = 8;
+
+    // bit c is set for delimiter c
+    std::array<uint64_t, 2> delimiters_{};
+    // delimiters as ranges [first, last] of consecutive characters, which
+    // SIMD compares classify; tables with more ranges are looked up per byte
+    std::array<std::pair<char, char>, MAX_SCANNED_RANGES> ranges_{};
+    size_t range_count_ = 0;
+    bool is_folding_case_ = false;
+
+    // Bit i is set when data[i] is a delimiter, for 64 bytes of data
+    uint64_t FindDelimiters(const char* data) const;
+
+    // The same for the size < 64 bytes at the end of a text, bits past
+    // the end are set
+    uint64_t FindTailDelimiters(const char* data, size_t size) const;
+};
+
+inline bool Tokenizer::IsDelimiter(char c) const {
+    const auto code = static_cast<unsigned char>(c);
+    return code < 128 && ((delimiters_[code / 64] >> (code % 64)) & 1);
+}
+
+inline bool Tokenizer::IsFoldingCase() const {
+    return is_folding_case_;
+}
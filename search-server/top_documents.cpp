@@ -0,0 +1,70 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool IsRankedHigher(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocuments::TopDocuments(size_t capacity)
+    : capacity_(capacity) {
+}
+
+TopDocuments::TopDocuments(size_t capacity, const Document& search_after)
+    : capacity_(capacity)
+    , search_after_(search_after) {
+}
+
+void TopDocuments::Add(const Document& document) {
+    if (search_after_ && !IsRankedHigher(*search_after_, document)) {
+        return;
+    }
+    if (heap_.size() < capacity_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsRankedHigher);
+    } else if (capacity_ > 0 && IsRankedHigher(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsRankedHigher);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsRankedHigher);
+    }
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+bool TopDocuments::IsFull() const {
+    return heap_.size() == capacity_;
+}
+
+size_t TopDocuments::GetCapacity() const {
+    return capacity_;
+}
+
+const std::optional<Document>& TopDocuments::GetSearchAfter() const {
+    return search_after_;
+}
+
+const Document& TopDocuments::GetWorst() const {
+    return heap_.front();
+}
+
+size_t TopDocuments::size() const {
+    return heap_.size();
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsRankedHigher);
+    std::vector<Document> result;
+    result.swap(heap_);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+const double EPSILON = 1e-6;
+
+// Relevances closer than EPSILON are equal, then the higher rating wins,
+// then the lower id so that the order is total
+bool IsRankedHigher(const Document& lhs, const Document& rhs);
+
+// Bounded heap that keeps the best `capacity` documents added to it
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t capacity);
+
+    // Keeps only documents ranked lower than search_after, the last one of
+    // the previous page
+    TopDocuments(size_t capacity, const Document& search_after);
+
+    void Add(const Document& document);
+
+    void Merge(const TopDocuments& other);
+
+    bool IsFull() const;
+
+    size_t GetCapacity() const;
+
+    const std::optional<Document>& GetSearchAfter() const;
+
+    // The document that the next one has to outrank, requires a non-empty heap
+    const Document& GetWorst() const;
+
+    size_t size() const;
+
+    // Returns the kept documents best first and leaves the heap empty
+    std::vector<Document> Extract();
+
+private:
+    size_t capacity_;
+    std::optional<Document> search_after_;
+    // the worst kept document is on top
+    std::vector<Document> heap_;
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "word_set_fingerprint.h"
+
+namespace {
+
+// splitmix64 finalizer, spreads the FNV-1a bits over the whole word
+uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+}
+
+uint64_t HashWord(std::string_view word, uint64_t seed) {
+    uint64_t hash = 14695981039346656037ull ^ Mix(seed);
+    for (const char c : word) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return Mix(hash);
+}
+
+void WordSetFingerprint::AddWord(std::string_view word) {
+    low += HashWord(word, 1);
+    high += HashWord(word, 2);
+}
+
+bool operator==(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs) {
+    return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+bool operator!=(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs) {
+    return !(lhs == rhs);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-bit hash of a word, the same on every run and machine: fingerprints
+// are saved with the index
+uint64_t HashWord(std::string_view word, uint64_t seed = 0);
+
+// 128-bit hash of a set of words. Word hashes are summed, so the order of
+// the words does not matter; every word of the set is added once.
+struct WordSetFingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    void AddWord(std::string_view word);
+};
+
+bool operator==(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs);
+
+bool operator!=(const WordSetFingerprint& lhs, const WordSetFingerprint& rhs);
+
+struct WordSetFingerprintHasher {
+    size_t operator()(const WordSetFingerprint& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};